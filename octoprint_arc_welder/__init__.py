@@ -82,6 +82,7 @@ class ArcWelderPlugin(
         self.preprocessing_job_source_file_name = ""
         self.preprocessing_job_target_file_name = ""
         self.is_cancelled = False
+        self.conversion_handle = None
         self.settings_default = dict(
             use_octoprint_settings=True,
             g90_g91_influences_extruder=False,
@@ -142,6 +143,10 @@ class ArcWelderPlugin(
             logger.info("Cancelling Preprocessing for /cancelPreprocessing.")
             self.preprocessing_job_guid = None
             self.is_cancelled = True
+            # stop the native conversion right away rather than at the next progress callback
+            conversion_handle = self.conversion_handle
+            if conversion_handle is not None:
+                conversion_handle.cancel()
 
             self.send_pre_processing_progress_message(100, 0, 0, 0, 0, 0, 0)
             return jsonify({"success": True})
@@ -219,8 +224,7 @@ class ArcWelderPlugin(
             "target_filename": self.preprocessing_job_target_file_name,
         }
         self._plugin_manager.send_plugin_message(self._identifier, data)
-        # sleep for just a bit to allow the plugin message time to be sent and for cancel messages to arrive
-        # the real answer for this is to figure out how to allow threading in the C++ code
+        # the conversion handle is cancelled directly, but returning False also stops the conversion
         return not self.is_cancelled
 
     # ~~ AssetPlugin mixin
@@ -383,10 +387,12 @@ class ArcWelderPlugin(
                     arc_converter_args["resolution_mm"], arc_converter_args["g90_g91_influences_extruder"],
                     arc_converter_args["log_level"])
 
-        # this will contain metadata results from the ConvertFile call
+        # this will contain metadata results from the conversion
         result = None
         try:
-            result = converter.ConvertFile(arc_converter_args)
+            # the conversion runs on a native thread without the GIL, and can be cancelled through the handle
+            self.conversion_handle = converter.start_conversion(arc_converter_args)
+            result = self.conversion_handle.result()
         except Exception as e:
             self.send_notification_toast(
                 "error",
@@ -396,9 +402,30 @@ class ArcWelderPlugin(
             )
             logger.exception("Unable to convert the gcode file.")
             raise e
-        #finally:
+        finally:
+            self.conversion_handle = None
             #self.send_pre_processing_progress_message(200, 0, 0, 0, 0, 0, 0)
 
+        if result["cancelled"]:
+            # the output is incomplete, so leave the source file alone
+            logger.info("Arc compression was cancelled, the source file was not changed.")
+            return file_object
+
+        logger.info(
+            "Arc compression finished in %.2f seconds (%.2f cpu seconds).  Source size: %d, target size: %d, "
+            "compression ratio: %.2f, arcs created: %d, peak memory: %d bytes.",
+            result["seconds_elapsed"], result["cpu_seconds"], result["source_file_size"],
+            result["target_file_size"], result["compression_ratio"], result["arcs_created"],
+            result["peak_memory_bytes"]
+        )
+        logger.debug(
+            "Arc compression stage times (wall/cpu seconds): %s",
+            ", ".join(
+                "{0}: {1:.3f}/{2:.3f}".format(name, stage["seconds"], stage["cpu_seconds"])
+                for name, stage in sorted(result["stages"].items())
+            )
+        )
+
         if self._overwrite_source_file:
             logger.info("Arc compression complete, overwriting source file.")
             # return the modified file
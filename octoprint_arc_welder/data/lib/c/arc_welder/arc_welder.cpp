@@ -25,14 +25,20 @@
 
 #include "arc_welder.h"
 #include <time.h>
+#include <chrono>
+#include <thread>
 #include <vector>
+#include <string.h>
+#include <math.h>
 #include <sstream>
 #include "utilities.h"
+#include "probes.h"
+#include "number_formatter.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
-arc_welder::arc_welder(std::string source_path, std::string target_path, logger * log, double resolution_mm, gcode_position_args args) : current_arc_(gcode_position_args_.position_buffer_size - 5, resolution_mm)
+arc_welder::arc_welder(std::string source_path, std::string target_path, logger * log, double resolution_mm, gcode_position_args args) : current_arc_(args.position_buffer_size - 5, resolution_mm)
 {
 	p_logger_ = log;
 	debug_logging_enabled_ = false;
@@ -42,6 +48,28 @@ arc_welder::arc_welder(std::string source_path, std::string target_path, logger
 
 	logger_type_ = 0;
 	progress_callback_ = NULL;
+	pipelined_ = false;
+	threaded_min_file_size_ = ARC_WELDER_THREADED_MIN_FILE_SIZE;
+	p_read_batches_ = NULL;
+	p_parsed_batches_ = NULL;
+	p_free_source_batches_ = NULL;
+	p_output_batches_ = NULL;
+	p_free_output_batches_ = NULL;
+	p_output_batch_ = NULL;
+	p_source_data_ = NULL;
+	verbatim_start_ = 0;
+	verbatim_end_ = 0;
+	line_ending_ = "\n";
+	stop_pipeline_.store(false);
+	cancel_requested_.store(false);
+	is_cancelled_ = false;
+	parallel_threads_ = 0;
+	parallel_min_chunk_size_ = ARC_WELDER_PARALLEL_MIN_CHUNK_SIZE;
+	arc_e_mode_ = arc_e_mode_offset;
+	compact_output_ = false;
+	radius_arcs_ = false;
+	helical_arcs_ = false;
+	p_chunk_ = NULL;
 	verbose_output_ = false;
 	absolute_e_offset_total_ = 0;
 	source_path_ = source_path;
@@ -68,20 +96,7 @@ arc_welder::arc_welder(std::string source_path, std::string target_path, logger
 	}
 
 	// We don't care about the printer settings, except for g91 influences extruder.
-	p_source_position_ = new gcode_position(gcode_position_args_); 
-	
-	// Create a list of commands that will need rewritten absolute e values
-	std::vector<std::string> absolute_e_rewrite_command_names;
-	absolute_e_rewrite_command_names.push_back("G0");
-	absolute_e_rewrite_command_names.push_back("G1");
-	absolute_e_rewrite_command_names.push_back("G2");
-	absolute_e_rewrite_command_names.push_back("G3");
-	//absolute_e_rewrite_command_names.push_back("G92");
-	
-	for (unsigned int index = 0; index < absolute_e_rewrite_command_names.size(); index++)
-	{
-		absolute_e_rewrite_commands_.insert(absolute_e_rewrite_command_names[index]);
-	}
+	p_source_position_ = new gcode_position(gcode_position_args_);
 }
 
 arc_welder::arc_welder(std::string source_path, std::string target_path, logger* log, double resolution_mm, bool g90_g91_influences_extruder, int buffer_size)
@@ -139,6 +154,12 @@ void arc_welder::set_logger_type(int logger_type)
 	logger_type_ = logger_type;
 }
 
+void arc_welder::set_paths(std::string source_path, std::string target_path)
+{
+	source_path_ = source_path;
+	target_path_ = target_path;
+}
+
 void arc_welder::reset()
 {
 	lines_processed_ = 0;
@@ -150,130 +171,1004 @@ void arc_welder::reset()
 	waiting_for_line_ = false;
 	waiting_for_arc_ = false;
 	absolute_e_offset_ = 0;
+	absolute_e_offset_total_ = 0;
+	is_cancelled_ = false;
+	current_arc_.clear();
+	unwritten_commands_.clear();
+	undo_commands_.clear();
+	verbatim_start_ = 0;
+	verbatim_end_ = 0;
+	p_source_position_->reset();
 }
 
-long arc_welder::get_file_size(const std::string& file_path)
+double arc_welder::get_next_update_time() const
 {
-	// Todo:  Fix this function.  This is a pretty weak implementation :(
-	std::ifstream file(file_path.c_str(), std::ios::in | std::ios::binary);
-	const long l = (long)file.tellg();
-	file.seekg(0, std::ios::end);
-	const long m = (long)file.tellg();
-	file.close();
-	return (m - l);
+	return get_clock_seconds() + notification_period_seconds;
 }
 
-double arc_welder::get_next_update_time() const
+double arc_welder::get_time_elapsed(double start_clock, double end_clock)
 {
-	return clock() + (notification_period_seconds * CLOCKS_PER_SEC);
+	return end_clock - start_clock;
 }
 
-double arc_welder::get_time_elapsed(double start_clock, double end_clock)
+double arc_welder::get_clock_seconds()
+{
+	// Use wall time rather than clock(), which adds up the cpu time of every thread.
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void arc_welder::set_pipelined(bool pipelined)
+{
+	pipelined_ = pipelined;
+}
+
+void arc_welder::set_threaded_min_file_size(long long file_size)
+{
+	threaded_min_file_size_ = file_size;
+}
+
+bool arc_welder::can_use_threads() const
 {
-	return static_cast<double>(end_clock - start_clock) / CLOCKS_PER_SEC;
+	if (threaded_min_file_size_ <= 0)
+		return true;
+	// hardware_concurrency returns 0 when the number of cores is unknown
+	return file_size_ >= threaded_min_file_size_ && std::thread::hardware_concurrency() != 1;
 }
 
-void arc_welder::process()
+void arc_welder::set_parallel_threads(int num_threads)
 {
+	parallel_threads_ = num_threads;
+}
+
+void arc_welder::set_parallel_min_chunk_size(long long chunk_size)
+{
+	parallel_min_chunk_size_ = chunk_size;
+}
+
+void arc_welder::set_arc_e_mode(arc_e_mode mode)
+{
+	arc_e_mode_ = mode;
+	current_arc_.set_preserve_extrusion(mode == arc_e_mode_preserve);
+}
+
+void arc_welder::set_compact_output(bool compact_output)
+{
+	compact_output_ = compact_output;
+	current_arc_.set_compact_output(compact_output);
+}
+
+void arc_welder::set_radius_arcs(bool radius_arcs)
+{
+	radius_arcs_ = radius_arcs;
+	current_arc_.set_radius_arcs(radius_arcs);
+}
+
+void arc_welder::set_helical_arcs(bool helical_arcs)
+{
+	helical_arcs_ = helical_arcs;
+	current_arc_.set_helical_arcs(helical_arcs);
+}
+
+bool arc_welder::try_get_arc_e_mode(const std::string& name, arc_e_mode& mode)
+{
+	for (int index = 0; index < NUM_ARC_E_MODES; index++)
+	{
+		if (arc_e_mode_name[index] == name)
+		{
+			mode = static_cast<arc_e_mode>(index);
+			return true;
+		}
+	}
+	return false;
+}
+
+void arc_welder::cancel()
+{
+	cancel_requested_.store(true);
+}
+
+bool arc_welder::is_cancelled() const
+{
+	return is_cancelled_;
+}
+
+arc_welder_results arc_welder::process()
+{
+	arc_welder_results results;
 	verbose_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, VERBOSE);
 	debug_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, DEBUG);
 	info_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, INFO);
 	error_logging_enabled_ = p_logger_->is_log_level_enabled(logger_type_, ERROR);
 	// reset tracking variables
 	reset();
-	// local variable to hold the progress update return.  If it's false, we will exit.
-	bool continue_processing = true;
-	
+	stage_times_ = conversion_stage_times();
+#ifdef GCODE_PROBES
+	probes::reset();
+#endif
+	stage_timer_ = stage_timer(ARC_WELDER_STAGE_SAMPLE_LINES);
+	stage_timer_.start();
+
 	// Create a stringstream we can use for messaging.
 	std::stringstream stream;
-	
-	int read_lines_before_clock_check = 5000;
-	double next_update_time = get_next_update_time();
-	const clock_t start_clock = clock();
-	file_size_ = get_file_size(source_path_);
-	// Create the source file read stream and target write stream
-	std::ifstream gcodeFile;
-	gcodeFile.open(source_path_.c_str());
-	output_file_.open(target_path_.c_str());
-	std::string line;
-	int lines_with_no_commands = 0;
-	gcodeFile.sync_with_stdio(false);
-	output_file_.sync_with_stdio(false);
-	if (gcodeFile.is_open())
+
+	const double start_clock = get_clock_seconds();
+	// Create the source file reader and target writer
+	line_reader gcode_file;
+	gcode_file.open(source_path_);
+	file_size_ = gcode_file.get_file_size();
+	// The output is rarely larger than the source, so use the source size to preallocate the target.
+	output_file_.open(target_path_, file_size_);
+	if (gcode_file.is_open())
 	{
 		if (output_file_.is_open())
 		{
-			if (info_logging_enabled_)
+			const bool use_threads = can_use_threads();
+			if (debug_logging_enabled_)
 			{
 				stream.clear();
 				stream.str("");
-				stream << "Opened file for reading.  File Size: " << file_size_;
+				stream << "Opened file for reading.  File Size: " << file_size_ << ", Memory Mapped: " << (gcode_file.is_memory_mapped() ? "True" : "False") << ", Pipelined: " << (pipelined_ ? "True" : "False") << ", Parallel Threads: " << parallel_threads_ << ", Threads Used: " << (use_threads ? "True" : "False");
 				p_logger_->log(logger_type_, DEBUG, stream.str());
 			}
-			parsed_command cmd;
-			// Communicate every second
-			while (std::getline(gcodeFile, line) && continue_processing)
+			p_source_data_ = gcode_file.get_mapped_data();
+			line_ending_ = gcode_file.get_line_ending();
+			output_file_.set_line_ending(line_ending_);
+			if (parallel_threads_ > 1 && use_threads)
+			{
+				process_parallel(gcode_file, start_clock);
+			}
+			else if (pipelined_ && use_threads)
+			{
+				process_pipelined(gcode_file, start_clock);
+			}
+			else
 			{
-				lines_processed_++;
+				process_serial(gcode_file, start_clock);
+			}
 
-				cmd.clear();
-				parser_.try_parse_gcode(line.c_str(), cmd);
-				bool has_gcode = false;
-				if (cmd.gcode.length() > 0)
-				{
-					has_gcode = true;
-					gcodes_processed_++;
-				}
-				else
+			if (output_file_.close())
+			{
+				results.success = !is_cancelled_;
+			}
+			else
+			{
+				results.message = "An error occurred while writing to the output file.";
+				p_logger_->log_exception(logger_type_, results.message);
+			}
+		}
+		else
+		{
+			results.message = "Unable to open the output file for writing.";
+			p_logger_->log_exception(logger_type_, results.message);
+		}
+		p_source_data_ = NULL;
+		gcode_file.close();
+	}
+	else
+	{
+		results.message = "Unable to open the gcode file for processing.";
+		p_logger_->log_exception(logger_type_, results.message);
+	}
+
+	const double total_seconds = get_time_elapsed(start_clock, get_clock_seconds());
+	stage_timer_.stop();
+	stage_timer_.add_to(stage_times_);
+	on_progress_(100, total_seconds, 0, gcodes_processed_, lines_processed_, points_compressed_, arcs_created_);
+
+	results.cancelled = is_cancelled_;
+	results.source_file_size = file_size_;
+	results.target_file_size = output_file_.get_bytes_written();
+	results.lines_processed = lines_processed_;
+	results.gcodes_processed = gcodes_processed_;
+	results.points_compressed = points_compressed_;
+	results.arcs_created = arcs_created_;
+	if (results.target_file_size > 0)
+	{
+		results.compression_ratio = static_cast<double>(results.source_file_size) / static_cast<double>(results.target_file_size);
+	}
+	results.seconds_elapsed = total_seconds;
+	results.stage_times = stage_times_;
+	results.peak_memory_bytes = utilities::get_peak_memory_bytes();
+#ifdef GCODE_PROBES
+	write_probe_report();
+#endif
+	return results;
+}
+
+#ifdef GCODE_PROBES
+void arc_welder::write_probe_report()
+{
+	std::string report_path = target_path_ + ARC_WELDER_PROBE_REPORT_SUFFIX;
+	if (probes::write_json_report(report_path))
+	{
+		if (info_logging_enabled_)
+		{
+			p_logger_->log(logger_type_, INFO, "Wrote the probe report to " + report_path + ".");
+		}
+	}
+	else if (error_logging_enabled_)
+	{
+		p_logger_->log(logger_type_, ERROR, "Unable to write the probe report to " + report_path + ".");
+	}
+}
+
+#endif
+void arc_welder::process_serial(line_reader& gcode_file, double start_clock)
+{
+	// local variable to hold the progress update return.  If it's false, we will exit.
+	bool continue_processing = true;
+	double next_update_time = get_next_update_time();
+	const char * line;
+	int line_length;
+	parsed_command cmd;
+	while (continue_processing)
+	{
+		stage_timer_.begin_unit();
+		stage_timer_.enter(conversion_stage_read);
+		long long line_position = gcode_file.get_position();
+		if (!gcode_file.get_line(&line, &line_length))
+			break;
+		stage_timer_.enter(conversion_stage_parse);
+		cmd.clear();
+		parser_.try_parse_gcode(line, cmd);
+		cmd.source_position = line_position;
+		cmd.source_length = static_cast<int>(gcode_file.get_position() - line_position);
+		continue_processing = process_parsed_command(cmd, gcode_file.get_position(), start_clock, next_update_time);
+	}
+	stage_timer_.enter(conversion_stage_none);
+	is_cancelled_ = !continue_processing;
+
+	if (current_arc_.is_shape() && waiting_for_arc_)
+	{
+		process_gcode(cmd, true);
+	}
+	write_unwritten_gcodes_to_file();
+	stage_timer_.enter(conversion_stage_write);
+	flush_verbatim_block(NULL);
+	stage_timer_.enter(conversion_stage_none);
+}
+
+bool arc_welder::process_parsed_command(parsed_command& cmd, long long file_position, double start_clock, double& next_update_time)
+{
+	lines_processed_++;
+	bool has_gcode = false;
+	if (cmd.has_gcode())
+	{
+		has_gcode = true;
+		gcodes_processed_++;
+	}
+
+	// Always process the command through the printer, even if no command is found
+	// This is important so that comments can be analyzed
+	process_gcode(cmd, false);
+	stage_timer_.enter(conversion_stage_none);
+
+	if ((lines_processed_ % ARC_WELDER_CANCEL_CHECK_LINES) == 0 && cancel_requested_.load(std::memory_order_relaxed))
+	{
+		return false;
+	}
+
+	// Only check the progress if we've found a command.
+	if (has_gcode && (lines_processed_ % ARC_WELDER_PROGRESS_CHECK_LINES) == 0 && next_update_time < get_clock_seconds())
+	{
+		return report_progress(file_position, start_clock, next_update_time);
+	}
+	return true;
+}
+
+bool arc_welder::report_progress(long long file_position, double start_clock, double& next_update_time)
+{
+	long long bytesRemaining = file_size_ - file_position;
+	double percentProgress = static_cast<double>(file_position) / static_cast<double>(file_size_) * 100.0;
+	double secondsElapsed = get_time_elapsed(start_clock, get_clock_seconds());
+	double bytesPerSecond = static_cast<double>(file_position) / secondsElapsed;
+	double secondsToComplete = bytesRemaining / bytesPerSecond;
+	next_update_time = get_next_update_time();
+	return on_progress_(percentProgress, secondsElapsed, secondsToComplete, gcodes_processed_, lines_processed_, points_compressed_, arcs_created_);
+}
+
+void arc_welder::process_pipelined(line_reader& gcode_file, double start_clock)
+{
+	// The welding core runs on this thread, so progress callbacks and logging happen here as they do in serial mode.
+	// Only the reader, parser and writer run on their own threads, and they never call back or log.
+	const int num_source_batches = ARC_WELDER_PIPELINE_QUEUE_SIZE * 2 + 2;
+	const int num_output_batches = ARC_WELDER_PIPELINE_QUEUE_SIZE + 2;
+	std::vector<source_line_batch> source_batches(num_source_batches);
+	std::vector<output_command_batch> output_batches(num_output_batches);
+	spsc_ring<source_line_batch*> read_batches(ARC_WELDER_PIPELINE_QUEUE_SIZE);
+	spsc_ring<source_line_batch*> parsed_batches(ARC_WELDER_PIPELINE_QUEUE_SIZE);
+	spsc_ring<source_line_batch*> free_source_batches(num_source_batches);
+	spsc_ring<output_command_batch*> output_ready_batches(ARC_WELDER_PIPELINE_QUEUE_SIZE);
+	spsc_ring<output_command_batch*> free_output_batches(num_output_batches);
+	for (int index = 0; index < num_source_batches; index++)
+	{
+		free_source_batches.try_push(&source_batches[index]);
+	}
+	// The first output batch is filled right away, the rest are free
+	for (int index = 1; index < num_output_batches; index++)
+	{
+		free_output_batches.try_push(&output_batches[index]);
+	}
+	p_read_batches_ = &read_batches;
+	p_parsed_batches_ = &parsed_batches;
+	p_free_source_batches_ = &free_source_batches;
+	p_output_batches_ = &output_ready_batches;
+	p_free_output_batches_ = &free_output_batches;
+	p_output_batch_ = &output_batches[0];
+	p_output_batch_->count = 0;
+	stop_pipeline_.store(false);
+
+	stage_timer reader_timer(ARC_WELDER_STAGE_SAMPLE_LINES);
+	stage_timer parser_timer(ARC_WELDER_STAGE_SAMPLE_LINES);
+	stage_timer writer_timer(ARC_WELDER_STAGE_SAMPLE_LINES);
+	std::thread reader_thread(&arc_welder::read_source_lines, this, &gcode_file, &reader_timer);
+	std::thread parser_thread(&arc_welder::parse_source_lines, this, &parser_timer);
+	std::thread writer_thread(&arc_welder::write_output_commands, this, &writer_timer);
+
+	// Stops every stage and waits for the threads to exit.  The writer exits once it has written the final batch.
+	auto finish_pipeline = [&]() {
+		stop_pipeline_.store(true);
+		reader_thread.join();
+		parser_thread.join();
+		send_output_batch(true);
+		writer_thread.join();
+		reader_timer.add_to(stage_times_);
+		parser_timer.add_to(stage_times_);
+		writer_timer.add_to(stage_times_);
+	};
+
+	try
+	{
+		// local variable to hold the progress update return.  If it's false, we will exit.
+		bool continue_processing = true;
+		double next_update_time = get_next_update_time();
+		// The final command is needed after the last batch has been recycled
+		parsed_command last_cmd;
+		source_line_batch* p_batch;
+		while (continue_processing && parsed_batches.pop(p_batch, stop_pipeline_))
+		{
+			int index = 0;
+			while (continue_processing && index < p_batch->count)
+			{
+				stage_timer_.begin_unit();
+				continue_processing = process_parsed_command(p_batch->commands[index++], p_batch->file_position, start_clock, next_update_time);
+			}
+			if (index > 0)
+			{
+				last_cmd = p_batch->commands[index - 1];
+			}
+			bool is_last = p_batch->is_last;
+			free_source_batches.push(p_batch, stop_pipeline_);
+			if (is_last)
+				break;
+		}
+		is_cancelled_ = !continue_processing;
+
+		if (current_arc_.is_shape() && waiting_for_arc_)
+		{
+			process_gcode(last_cmd, true);
+		}
+		write_unwritten_gcodes_to_file();
+	}
+	catch (...)
+	{
+		finish_pipeline();
+		throw;
+	}
+	finish_pipeline();
+
+	p_read_batches_ = NULL;
+	p_parsed_batches_ = NULL;
+	p_free_source_batches_ = NULL;
+	p_output_batches_ = NULL;
+	p_free_output_batches_ = NULL;
+	p_output_batch_ = NULL;
+}
+
+void arc_welder::read_source_lines(line_reader* p_gcode_file, stage_timer* p_timer)
+{
+	p_timer->start();
+	const char * line;
+	int line_length;
+	bool is_last = false;
+	source_line_batch* p_batch;
+	while (!is_last && p_free_source_batches_->pop(p_batch, stop_pipeline_))
+	{
+		p_batch->text.clear();
+		p_batch->line_offsets.clear();
+		p_batch->line_positions.clear();
+		p_batch->count = 0;
+		while (p_batch->count < ARC_WELDER_PIPELINE_BATCH_SIZE)
+		{
+			p_timer->begin_unit();
+			p_timer->enter(conversion_stage_read);
+			long long line_position = p_gcode_file->get_position();
+			if (!p_gcode_file->get_line(&line, &line_length))
+			{
+				is_last = true;
+				break;
+			}
+			p_batch->line_positions.push_back(line_position);
+			// Copy the line, since it is only valid until the next call to get_line
+			p_batch->line_offsets.push_back(static_cast<int>(p_batch->text.length()));
+			p_batch->text.append(line, line_length);
+			p_batch->text.push_back('\0');
+			p_batch->count++;
+			p_timer->enter(conversion_stage_none);
+		}
+		p_batch->file_position = p_gcode_file->get_position();
+		p_batch->is_last = is_last;
+		if (!p_read_batches_->push(p_batch, stop_pipeline_))
+			break;
+	}
+	p_timer->stop();
+}
+
+void arc_welder::parse_source_lines(stage_timer* p_timer)
+{
+	p_timer->start();
+	bool is_last = false;
+	source_line_batch* p_batch;
+	while (!is_last && p_read_batches_->pop(p_batch, stop_pipeline_))
+	{
+		if (static_cast<int>(p_batch->commands.size()) < p_batch->count)
+		{
+			p_batch->commands.resize(p_batch->count);
+		}
+		const char* text = p_batch->text.c_str();
+		for (int index = 0; index < p_batch->count; index++)
+		{
+			p_timer->begin_unit();
+			p_timer->enter(conversion_stage_parse);
+			parsed_command& cmd = p_batch->commands[index];
+			cmd.clear();
+			parser_.try_parse_gcode(text + p_batch->line_offsets[index], cmd);
+			// Each line ends where the next one starts
+			long long line_end = index + 1 < p_batch->count ? p_batch->line_positions[index + 1] : p_batch->file_position;
+			cmd.source_position = p_batch->line_positions[index];
+			cmd.source_length = static_cast<int>(line_end - cmd.source_position);
+			p_timer->enter(conversion_stage_none);
+		}
+		is_last = p_batch->is_last;
+		if (!p_parsed_batches_->push(p_batch, stop_pipeline_))
+			break;
+	}
+	p_timer->stop();
+}
+
+void arc_welder::write_output_commands(stage_timer* p_timer)
+{
+	p_timer->start();
+	// The writer is stopped only by the final batch, so that nothing the welder produced is lost.
+	std::atomic<bool> never_stop(false);
+	bool is_last = false;
+	output_command_batch* p_batch;
+	while (!is_last && p_output_batches_->pop(p_batch, never_stop))
+	{
+		for (int index = 0; index < p_batch->count; index++)
+		{
+			p_timer->begin_unit();
+			unwritten_command& p = p_batch->commands[index];
+			if (p.is_verbatim(p_batch->rewrite[index]))
+			{
+				p_timer->enter(conversion_stage_write);
+				write_verbatim_command(p.command, NULL);
+			}
+			else
+			{
+				p_timer->enter(conversion_stage_format);
+				std::string gcode = p.to_string(p_batch->rewrite[index], compact_output_, "");
+				p_timer->enter(conversion_stage_write);
+				flush_verbatim_block(NULL);
+				write_gcode_to_file(gcode);
+			}
+			p_timer->enter(conversion_stage_none);
+		}
+		is_last = p_batch->is_last;
+		p_free_output_batches_->push(p_batch, never_stop);
+	}
+	flush_verbatim_block(NULL);
+	p_timer->stop();
+}
+
+void arc_welder::process_parallel(line_reader& gcode_file, double start_clock)
+{
+	// This thread writes the finished chunks in order, and makes every progress callback.  The scanner and the
+	// workers never call back or log.
+	parallel_conversion state;
+	state.max_chunks_ahead = parallel_threads_ * ARC_WELDER_PARALLEL_CHUNKS_AHEAD_PER_THREAD;
+	std::vector<arc_welder*> workers;
+	for (int index = 0; index < parallel_threads_; index++)
+	{
+		workers.push_back(new arc_welder(source_path_, target_path_, p_logger_, resolution_mm_, gcode_position_args_));
+		workers[index]->set_arc_e_mode(arc_e_mode_);
+		workers[index]->set_compact_output(compact_output_);
+		workers[index]->set_radius_arcs(radius_arcs_);
+		workers[index]->set_helical_arcs(helical_arcs_);
+	}
+
+	std::thread scanner_thread(&arc_welder::scan_source_chunks, this, &gcode_file, &state);
+	std::vector<std::thread> worker_threads;
+	for (int index = 0; index < parallel_threads_; index++)
+	{
+		worker_threads.push_back(std::thread(&arc_welder::weld_source_chunks, workers[index], &state));
+	}
+
+	// local variable to hold the progress update return.  If it's false, we will exit.
+	bool continue_processing = true;
+	double next_update_time = get_next_update_time();
+	long long file_position = 0;
+	// Every chunk is timed, since there are few of them
+	stage_timer write_timer(1);
+	write_timer.start();
+	while (continue_processing)
+	{
+		source_chunk* p_chunk = NULL;
+		{
+			std::unique_lock<std::mutex> lock(state.mutex);
+			// Wake up now and then, so that progress is reported even when a chunk takes a while
+			state.changed.wait_for(lock, std::chrono::milliseconds(100), [&state]() {
+				return state.has_failed ||
+					(state.next_chunk_to_write < static_cast<int>(state.chunks.size()) && state.chunks[state.next_chunk_to_write]->is_formatted) ||
+					(state.is_scan_complete && state.next_chunk_to_write == static_cast<int>(state.chunks.size()));
+			});
+			if (state.has_failed)
+				break;
+			if (state.next_chunk_to_write < static_cast<int>(state.chunks.size()))
+			{
+				if (state.chunks[state.next_chunk_to_write]->is_formatted)
+					p_chunk = state.chunks[state.next_chunk_to_write];
+			}
+			else if (state.is_scan_complete)
+			{
+				break;
+			}
+		}
+
+		if (p_chunk != NULL)
+		{
+			write_timer.begin_unit();
+			write_timer.enter(conversion_stage_write);
+			output_file_.write(p_chunk->output.c_str(), static_cast<int>(p_chunk->output.length()));
+			write_timer.enter(conversion_stage_none);
+			lines_processed_ += p_chunk->lines_processed;
+			gcodes_processed_ += p_chunk->gcodes_processed;
+			points_compressed_ += p_chunk->points_compressed;
+			arcs_created_ += p_chunk->arcs_created;
+			file_position = p_chunk->end_position;
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.chunks[state.next_chunk_to_write] = NULL;
+				state.next_chunk_to_write++;
+			}
+			delete p_chunk;
+			state.changed.notify_all();
+		}
+
+		// Nothing can be estimated until the first chunk is written
+		if (file_position > 0 && next_update_time < get_clock_seconds())
+		{
+			continue_processing = report_progress(file_position, start_clock, next_update_time);
+		}
+		if (cancel_requested_.load())
+		{
+			continue_processing = false;
+		}
+	}
+	is_cancelled_ = !continue_processing;
+	write_timer.stop();
+	write_timer.add_to(stage_times_);
+
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.stop.store(true);
+	}
+	state.changed.notify_all();
+	scanner_thread.join();
+	state.scan_timer.add_to(stage_times_);
+	for (unsigned int index = 0; index < worker_threads.size(); index++)
+	{
+		worker_threads[index].join();
+		workers[index]->stage_timer_.add_to(stage_times_);
+		delete workers[index];
+	}
+	for (unsigned int index = 0; index < state.chunks.size(); index++)
+	{
+		delete state.chunks[index];
+	}
+
+	if (state.has_failed)
+	{
+		if (error_logging_enabled_)
+		{
+			p_logger_->log_exception(logger_type_, "An error occurred while welding the file in parallel.");
+		}
+		throw std::exception();
+	}
+}
+
+void arc_welder::scan_source_chunks(line_reader* p_gcode_file, parallel_conversion* p_state)
+{
+	// Track the position through the whole file, and start a new chunk after the first G0/G1 that changes the
+	// Z height once the current chunk is large enough.  The welder can never carry an arc past such a command.
+	// Helical arcs can change height, so they are split after the first line that isn't a G0/G1 instead.
+	stage_timer& timer = p_state->scan_timer;
+	timer.start();
+	try
+	{
+		long long target_chunk_size = file_size_ / (parallel_threads_ * ARC_WELDER_PARALLEL_CHUNKS_PER_THREAD);
+		if (target_chunk_size < parallel_min_chunk_size_)
+		{
+			target_chunk_size = parallel_min_chunk_size_;
+		}
+		int lines = 0;
+		int gcodes = 0;
+		const char * line;
+		int line_length;
+		parsed_command cmd;
+		source_chunk* p_chunk = new source_chunk();
+		p_chunk->start_state = p_source_position_->get_current_position();
+		p_chunk->start_comment_processor = *p_source_position_->get_gcode_comment_processor();
+		while (!p_state->stop.load(std::memory_order_relaxed))
+		{
+			timer.begin_unit();
+			timer.enter(conversion_stage_read);
+			if (!p_gcode_file->get_line(&line, &line_length))
+				break;
+			timer.enter(conversion_stage_parse);
+			cmd.clear();
+			parser_.try_parse_gcode(line, cmd);
+			lines++;
+			if (cmd.has_gcode())
+			{
+				gcodes++;
+			}
+			timer.enter(conversion_stage_position);
+			p_source_position_->update(cmd, lines, gcodes, -1);
+			timer.enter(conversion_stage_none);
+
+			if (p_gcode_file->get_position() - p_chunk->start_position < target_chunk_size)
+			{
+				continue;
+			}
+			position* p_cur_pos = p_source_position_->get_current_position_ptr();
+			const bool is_move = cmd.is_known_command && !cmd.is_empty && (cmd.id == command_id_g0 || cmd.id == command_id_g1);
+			if (helical_arcs_ ? is_move : !is_move || utilities::is_equal(p_cur_pos->z, p_source_position_->get_previous_position_ptr()->z))
+			{
+				continue;
+			}
+
+			p_chunk->end_position = p_gcode_file->get_position();
+			source_chunk* p_next_chunk = new source_chunk();
+			p_next_chunk->index = p_chunk->index + 1;
+			p_next_chunk->start_position = p_chunk->end_position;
+			p_next_chunk->start_line = lines;
+			p_next_chunk->start_gcode = gcodes;
+			p_next_chunk->start_state = *p_cur_pos;
+			p_next_chunk->start_comment_processor = *p_source_position_->get_gcode_comment_processor();
+			{
+				std::lock_guard<std::mutex> lock(p_state->mutex);
+				p_state->chunks.push_back(p_chunk);
+			}
+			p_state->changed.notify_all();
+			p_chunk = p_next_chunk;
+		}
+		p_chunk->end_position = p_gcode_file->get_position();
+		p_chunk->is_last = true;
+		{
+			std::lock_guard<std::mutex> lock(p_state->mutex);
+			p_state->chunks.push_back(p_chunk);
+			p_state->is_scan_complete = true;
+		}
+		p_state->changed.notify_all();
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(p_state->mutex);
+			p_state->has_failed = true;
+		}
+		p_state->changed.notify_all();
+	}
+	timer.stop();
+}
+
+void arc_welder::weld_source_chunks(parallel_conversion* p_state)
+{
+	// Runs on a worker thread, with this welder as the worker's core.  Chunks are claimed in order.
+	stage_timer_ = stage_timer(ARC_WELDER_STAGE_SAMPLE_LINES);
+	stage_timer_.start();
+	try
+	{
+		line_reader gcode_file;
+		if (!gcode_file.open(source_path_))
+		{
+			throw std::exception();
+		}
+		p_source_data_ = gcode_file.get_mapped_data();
+		line_ending_ = gcode_file.get_line_ending();
+		while (true)
+		{
+			source_chunk* p_chunk;
+			{
+				std::unique_lock<std::mutex> lock(p_state->mutex);
+				p_state->changed.wait(lock, [p_state]() {
+					return p_state->stop.load() || p_state->has_failed ||
+						(p_state->is_scan_complete && p_state->next_chunk_to_weld == static_cast<int>(p_state->chunks.size())) ||
+						(
+							p_state->next_chunk_to_weld < static_cast<int>(p_state->chunks.size()) &&
+							p_state->next_chunk_to_weld < p_state->next_chunk_to_write + p_state->max_chunks_ahead
+						);
+				});
+				if (p_state->stop.load() || p_state->has_failed || p_state->next_chunk_to_weld == static_cast<int>(p_state->chunks.size()))
 				{
-					lines_with_no_commands++;
+					break;
 				}
+				p_chunk = p_state->chunks[p_state->next_chunk_to_weld++];
+			}
 
-				// Always process the command through the printer, even if no command is found
-				// This is important so that comments can be analyzed
-				//std::cout << "stabilization::process_file - updating position...";
-				process_gcode(cmd, false);
+			weld_source_chunk(gcode_file, *p_chunk, p_state->stop);
 
-				// Only continue to process if we've found a command.
-				if (has_gcode)
+			// The previous chunk's final offset is the starting offset of this one.
+			{
+				std::unique_lock<std::mutex> lock(p_state->mutex);
+				p_state->changed.wait(lock, [p_state, p_chunk]() {
+					return p_state->stop.load() || p_state->has_failed || p_state->num_e_offsets_resolved == p_chunk->index;
+				});
+				if (p_state->stop.load() || p_state->has_failed)
 				{
-					if ((lines_processed_ % read_lines_before_clock_check) == 0 && next_update_time < clock())
-					{
-						long file_position = static_cast<long>(gcodeFile.tellg());
-						// ToDo: tellg does not do what I think it does, but why?
-						long bytesRemaining = file_size_ - file_position;
-						double percentProgress = static_cast<double>(file_position) / static_cast<double>(file_size_) * 100.0;
-						double secondsElapsed = get_time_elapsed(start_clock, clock());
-						double bytesPerSecond = static_cast<double>(file_position) / secondsElapsed;
-						double secondsToComplete = bytesRemaining / bytesPerSecond;
-						continue_processing = on_progress_(percentProgress, secondsElapsed, secondsToComplete, gcodes_processed_, lines_processed_, points_compressed_, arcs_created_);
-						next_update_time = get_next_update_time();
-					}
+					break;
 				}
+				p_chunk->start_e_offset = p_state->next_start_e_offset;
+				p_state->next_start_e_offset = get_end_e_offset(*p_chunk);
+				p_state->num_e_offsets_resolved++;
 			}
+			p_state->changed.notify_all();
 
-			if (current_arc_.is_shape() && waiting_for_arc_)
+			format_source_chunk(*p_chunk);
 			{
-				process_gcode(cmd, true);
+				std::lock_guard<std::mutex> lock(p_state->mutex);
+				p_chunk->is_formatted = true;
 			}
-			write_unwritten_gcodes_to_file();
+			p_state->changed.notify_all();
+		}
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(p_state->mutex);
+			p_state->has_failed = true;
+		}
+		p_state->changed.notify_all();
+	}
+	stage_timer_.stop();
+}
+
+void arc_welder::weld_source_chunk(line_reader& gcode_file, source_chunk& chunk, const std::atomic<bool>& stop)
+{
+	// Continue from the state the source was in just before the chunk.  The welder is always idle at a chunk boundary.
+	lines_processed_ = chunk.start_line;
+	gcodes_processed_ = chunk.start_gcode;
+	points_compressed_ = 0;
+	arcs_created_ = 0;
+	waiting_for_line_ = false;
+	waiting_for_arc_ = false;
+	absolute_e_offset_ = 0;
+	current_arc_.clear();
+	unwritten_commands_.clear();
+	undo_commands_.clear();
+	p_source_position_->reset_to(chunk.start_state, chunk.start_comment_processor);
+	if (!gcode_file.seek(chunk.start_position))
+	{
+		throw std::exception();
+	}
 
-			output_file_.close();
+	p_chunk_ = &chunk;
+	const char * line;
+	int line_length;
+	parsed_command cmd;
+	while (gcode_file.get_position() < chunk.end_position && !stop.load(std::memory_order_relaxed))
+	{
+		stage_timer_.begin_unit();
+		stage_timer_.enter(conversion_stage_read);
+		long long line_position = gcode_file.get_position();
+		if (!gcode_file.get_line(&line, &line_length))
+			break;
+		stage_timer_.enter(conversion_stage_parse);
+		cmd.clear();
+		parser_.try_parse_gcode(line, cmd);
+		cmd.source_position = line_position;
+		cmd.source_length = static_cast<int>(gcode_file.get_position() - line_position);
+		lines_processed_++;
+		if (cmd.has_gcode())
+		{
+			gcodes_processed_++;
+		}
+		process_gcode(cmd, false);
+		stage_timer_.enter(conversion_stage_none);
+	}
+
+	if (chunk.is_last && current_arc_.is_shape() && waiting_for_arc_)
+	{
+		process_gcode(cmd, true);
+	}
+	write_unwritten_gcodes_to_file();
+	p_chunk_ = NULL;
+
+	chunk.lines_processed = lines_processed_ - chunk.start_line;
+	chunk.gcodes_processed = gcodes_processed_ - chunk.start_gcode;
+	chunk.points_compressed = points_compressed_;
+	chunk.arcs_created = arcs_created_;
+}
+
+double arc_welder::get_end_e_offset(const source_chunk& chunk)
+{
+	double absolute_e_offset = chunk.start_e_offset;
+	for (unsigned int index = 0; index < chunk.e_offset_changes.size(); index++)
+	{
+		if (chunk.e_offset_changes[index].is_reset)
+			absolute_e_offset = 0;
+		else
+			absolute_e_offset += chunk.e_offset_changes[index].difference;
+	}
+	return absolute_e_offset;
+}
+
+void arc_welder::format_source_chunk(source_chunk& chunk)
+{
+	// Replay the offset changes exactly as the serial welder makes them, so that the output is identical.
+	double absolute_e_offset = chunk.start_e_offset;
+	unsigned int change_index = 0;
+	chunk.output.clear();
+	for (unsigned int index = 0; index < chunk.commands.size(); index++)
+	{
+		while (change_index < chunk.e_offset_changes.size() && chunk.e_offset_changes[change_index].command_count <= static_cast<int>(index))
+		{
+			if (chunk.e_offset_changes[change_index].is_reset)
+				absolute_e_offset = 0;
+			else
+				absolute_e_offset += chunk.e_offset_changes[change_index].difference;
+			change_index++;
+		}
+		stage_timer_.begin_unit();
+		stage_timer_.enter(conversion_stage_format);
+		unwritten_command& p = chunk.commands[index];
+		bool rewrite = apply_absolute_e_offset(p, absolute_e_offset);
+		if (p.is_verbatim(rewrite))
+		{
+			write_verbatim_command(p.command, &chunk.output);
+			stage_timer_.enter(conversion_stage_none);
+			continue;
+		}
+		flush_verbatim_block(&chunk.output);
+		std::string gcode = p.to_string(rewrite, compact_output_, "");
+
+		// Trim the line, as write_gcode_to_file does
+		int start = 0;
+		int end = static_cast<int>(gcode.length());
+		while (start < end && utilities::is_whitespace(gcode[start]))
+		{
+			start++;
+		}
+		while (end > start && utilities::is_whitespace(gcode[end - 1]))
+		{
+			end--;
+		}
+		chunk.output.append(gcode, start, end - start);
+		chunk.output.append(line_ending_);
+		stage_timer_.enter(conversion_stage_none);
+	}
+	flush_verbatim_block(&chunk.output);
+	// The commands are no longer needed
+	std::vector<unwritten_command>().swap(chunk.commands);
+}
+
+void arc_welder::write_unwritten_command(unwritten_command& p, bool rewrite)
+{
+	if (p_output_batch_ == NULL)
+	{
+		if (p.is_verbatim(rewrite))
+		{
+			stage_timer_.enter(conversion_stage_write);
+			write_verbatim_command(p.command, NULL);
+		}
+		else
+		{
+			std::string gcode = p.to_string(rewrite, compact_output_, "");
+			stage_timer_.enter(conversion_stage_write);
+			flush_verbatim_block(NULL);
+			write_gcode_to_file(gcode);
+		}
+		stage_timer_.enter(conversion_stage_format);
+		return;
+	}
+	// Pipelined, hand the command to the writer to format.  Assigning into an existing slot reuses its storage.
+	output_command_batch* p_batch = p_output_batch_;
+	if (static_cast<int>(p_batch->commands.size()) == p_batch->count)
+	{
+		p_batch->commands.push_back(p);
+		p_batch->rewrite.push_back(rewrite);
+	}
+	else
+	{
+		p_batch->commands[p_batch->count] = p;
+		p_batch->rewrite[p_batch->count] = rewrite;
+	}
+	p_batch->count++;
+	if (p_batch->count == ARC_WELDER_PIPELINE_BATCH_SIZE)
+	{
+		send_output_batch(false);
+	}
+}
+
+void arc_welder::write_verbatim_command(const parsed_command& cmd, std::string* p_output)
+{
+	if (p_source_data_ == NULL)
+	{
+		// The command holds the whole source line, except for the line feed
+		if (p_output == NULL)
+		{
+			output_file_.write(cmd.line.c_str(), static_cast<int>(cmd.line.length()));
 		}
 		else
 		{
-			p_logger_->log_exception(logger_type_, "Unable to open the output file for writing.");
+			p_output->append(cmd.line);
 		}
-		gcodeFile.close();
+		write_line_ending(cmd.line.empty() ? '\0' : cmd.line[cmd.line.length() - 1], p_output);
+		return;
+	}
+	if (cmd.source_position != verbatim_end_ || verbatim_end_ - verbatim_start_ >= ARC_WELDER_VERBATIM_BLOCK_SIZE)
+	{
+		flush_verbatim_block(p_output);
+		verbatim_start_ = cmd.source_position;
+	}
+	verbatim_end_ = cmd.source_position + cmd.source_length;
+}
+
+void arc_welder::flush_verbatim_block(std::string* p_output)
+{
+	const int length = static_cast<int>(verbatim_end_ - verbatim_start_);
+	if (length == 0)
+		return;
+	const char* p_block = p_source_data_ + verbatim_start_;
+	if (p_output == NULL)
+	{
+		output_file_.write(p_block, length);
 	}
 	else
 	{
-		p_logger_->log_exception(logger_type_, "Unable to open the gcode file for processing.");
+		p_output->append(p_block, length);
+	}
+	// The final line of the source may not end with a line feed
+	if (p_block[length - 1] != '\n')
+	{
+		write_line_ending(p_block[length - 1], p_output);
 	}
+	verbatim_start_ = verbatim_end_;
+}
 
-	const clock_t end_clock = clock();
-	const double total_seconds = static_cast<double>(end_clock - start_clock) / CLOCKS_PER_SEC;
-	on_progress_(100, total_seconds, 0, gcodes_processed_, lines_processed_, points_compressed_, arcs_created_);
+void arc_welder::write_line_ending(char last_char, std::string* p_output)
+{
+	// A line that already ends with a carriage return only needs the line feed
+	const char* p_line_ending = last_char == '\r' ? "\n" : line_ending_.c_str();
+	if (p_output == NULL)
+		output_file_.write(p_line_ending, static_cast<int>(strlen(p_line_ending)));
+	else
+		p_output->append(p_line_ending);
+}
+
+void arc_welder::send_output_batch(bool is_last)
+{
+	std::atomic<bool> never_stop(false);
+	p_output_batch_->is_last = is_last;
+	p_output_batches_->push(p_output_batch_, never_stop);
+	if (is_last)
+	{
+		p_output_batch_ = NULL;
+		return;
+	}
+	p_free_output_batches_->pop(p_output_batch_, never_stop);
+	p_output_batch_->count = 0;
 }
 
 bool arc_welder::on_progress_(double percentComplete, double seconds_elapsed, double estimatedSecondsRemaining, int gcodesProcessed, int linesProcessed, int points_compressed, int arcs_created)
@@ -292,10 +1187,12 @@ bool arc_welder::on_progress_(double percentComplete, double seconds_elapsed, do
 	return true;
 }
 
-int arc_welder::process_gcode(parsed_command cmd, bool is_end)
+int arc_welder::process_gcode(parsed_command& cmd, bool is_end)
 {
 	// Update the position for the source gcode file
+	stage_timer_.enter(conversion_stage_position);
 	p_source_position_->update(cmd, lines_processed_, gcodes_processed_, -1);
+	stage_timer_.enter(conversion_stage_arc_fit);
 
 	position* p_cur_pos = p_source_position_->get_current_position_ptr();
 	position* p_pre_pos = p_source_position_->get_previous_position_ptr();
@@ -310,13 +1207,14 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 	extruder extruder_current = p_cur_pos->get_current_extruder();
 	point p(p_cur_pos->x, p_cur_pos->y, p_cur_pos->z, extruder_current.e_relative);
 
-	// We need to make sure the printer is using absolute xyz, is extruding, and the extruder axis mode is the same as that of the previous position
-	// TODO: Handle relative XYZ axis.  This is possible, but maybe not so important.
+	// We need to make sure the printer is extruding, and the xyz and extruder axis modes are the same as those of the previous position.
+	// Relative xyz arcs are fitted on the tracked positions and written as offsets, so the position must be known.
 	if (
 		!is_end && cmd.is_known_command && !cmd.is_empty && (
-			(cmd.command == "G0" || cmd.command == "G1") &&
-			utilities::is_equal(p_cur_pos->z, p_pre_pos->z) &&
-			!p_cur_pos->is_relative &&
+			(cmd.id == command_id_g0 || cmd.id == command_id_g1) &&
+			(helical_arcs_ || utilities::is_equal(p_cur_pos->z, p_pre_pos->z)) &&
+			p_cur_pos->is_relative == p_pre_pos->is_relative &&
+			(!p_cur_pos->is_relative || (!p_cur_pos->x_null && !p_cur_pos->y_null)) &&
 			(
 				!waiting_for_arc_ ||
 				(p_pre_pos->get_current_extruder().is_extruding && extruder_current.is_extruding) ||
@@ -332,7 +1230,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 		{
 			if (debug_logging_enabled_)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Starting new arc from Gcode:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Starting new arc from Gcode:" + cmd.get_gcode());
 			}
 			write_unwritten_gcodes_to_file();
 			// add the previous point as the starting point for the current arc
@@ -357,10 +1255,10 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 				{
 					if (num_points+1 == current_arc_.get_num_segments())
 					{
-						p_logger_->log(logger_type_, DEBUG, "Adding point to arc from Gcode:" + cmd.gcode);
+						p_logger_->log(logger_type_, DEBUG, "Adding point to arc from Gcode:" + cmd.get_gcode());
 					}
 					{
-						p_logger_->log(logger_type_, DEBUG, "Removed start point from arc and added a new point from Gcode:" + cmd.gcode);
+						p_logger_->log(logger_type_, DEBUG, "Removed start point from arc and added a new point from Gcode:" + cmd.get_gcode());
 					}
 				}
 			}
@@ -375,19 +1273,23 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 		{
 			if (!cmd.is_known_command)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Command '" + cmd.command + "' is Unknown.  Gcode:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Command '" + cmd.get_command() + "' is Unknown.  Gcode:" + cmd.get_gcode());
+			}
+			else if (cmd.id != command_id_g0 && cmd.id != command_id_g1)
+			{
+				p_logger_->log(logger_type_, DEBUG, "Command '"+ cmd.get_command() + "' is not G0/G1, skipping.  Gcode:" + cmd.get_gcode());
 			}
-			else if (cmd.command != "G0" && cmd.command != "G1")
+			else if (!helical_arcs_ && !utilities::is_equal(p_cur_pos->z, p_pre_pos->z))
 			{
-				p_logger_->log(logger_type_, DEBUG, "Command '"+ cmd.command + "' is not G0/G1, skipping.  Gcode:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Z axis position changed, cannot convert:" + cmd.get_gcode());
 			}
-			else if (!utilities::is_equal(p_cur_pos->z, p_pre_pos->z))
+			else if (p_cur_pos->is_relative != p_pre_pos->is_relative)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Z axis position changed, cannot convert:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "XYZ axis mode changed, cannot convert:" + cmd.get_gcode());
 			}
-			else if (p_cur_pos->is_relative)
+			else if (p_cur_pos->is_relative && (p_cur_pos->x_null || p_cur_pos->y_null))
 			{
-				p_logger_->log(logger_type_, DEBUG, "XYZ Axis is in relative mode, cannot convert:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "XYZ axis is in relative mode from an unknown position, cannot convert:" + cmd.get_gcode());
 			}
 			else if (
 				waiting_for_arc_ && !( 
@@ -396,7 +1298,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 				)
 			)
 			{
-				std::string message = "Extruding or retracting state changed, cannot add point to current arc: " + cmd.gcode;
+				std::string message = "Extruding or retracting state changed, cannot add point to current arc: " + cmd.get_gcode();
 				if (verbose_logging_enabled_)
 				{
 					extruder previous_extruder = p_pre_pos->get_current_extruder();
@@ -428,20 +1330,20 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 			}
 			else if (p_cur_pos->is_extruder_relative != p_pre_pos->is_extruder_relative)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Extruder axis mode changed, cannot add point to current arc: " + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Extruder axis mode changed, cannot add point to current arc: " + cmd.get_gcode());
 			}
 			else if (waiting_for_arc_ && p_pre_pos->f != p_cur_pos->f)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Feedrate changed, cannot add point to current arc: " + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Feedrate changed, cannot add point to current arc: " + cmd.get_gcode());
 			}
 			else if (waiting_for_arc_ && p_pre_pos->feature_type_tag != p_cur_pos->feature_type_tag)
 			{
-				p_logger_->log(logger_type_, DEBUG, "Feature type changed, cannot add point to current arc: " + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Feature type changed, cannot add point to current arc: " + cmd.get_gcode());
 			}
 			else
 			{
 				// Todo:  Add all the relevant values
-				p_logger_->log(logger_type_, DEBUG, "There was an unknown issue preventing the current point from being added to the arc: " + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "There was an unknown issue preventing the current point from being added to the arc: " + cmd.get_gcode());
 			}
 		}
 	}
@@ -452,7 +1354,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 			{
 				if (current_arc_.get_num_segments() != 0)
 				{
-					p_logger_->log(logger_type_, DEBUG, "Not enough segments, resetting. Gcode:" + cmd.gcode);
+					p_logger_->log(logger_type_, DEBUG, "Not enough segments, resetting. Gcode:" + cmd.get_gcode());
 				}
 				
 			}
@@ -473,9 +1375,12 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 				// remove the same number of unwritten gcodes as there are arc segments, minus 1 for the start point
 				// Which isn't a movement
 				// note, skip the first point, it is the starting point
+				// Save the commands so that they can be reprocessed after the arc is created, newest first.
+				// Positions don't store their commands, but the unwritten commands match the arc's positions.
+				undo_commands_.push_back(cmd);
 				for (int index = 0; index < current_arc_.get_num_segments() - 1; index++)
 				{
-					unwritten_commands_.pop_back();
+					undo_commands_.push_back(unwritten_commands_.pop_back().command);
 				}
 				// get the current absolute e coordinate of the previous position (the current position is not included in 
 				// the arc) so we can make any adjustments that are necessary.
@@ -487,7 +1392,6 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 				// Undo the previous updates that will be turned into the arc, including the current position
 				for (int index = 0; index < current_arc_.get_num_segments(); index++)
 				{
-					undo_commands_.push_back(p_source_position_->get_current_position_ptr()->command);
 					p_source_position_->undo_update();
 				}
 				//position * p_undo_positions = p_source_position_->undo_update(current_arc_.get_num_segments());
@@ -519,7 +1423,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 				}
 				// update the position processor and add the command to the unwritten commands list
 				p_source_position_->update(new_command, lines_processed_, gcodes_processed_, -1);
-				unwritten_commands_.push_back(unwritten_command(p_source_position_->get_current_position_ptr()));
+				unwritten_commands_.push_back(unwritten_command(p_source_position_->get_current_position_ptr(), new_command));
 				
 				// write all unwritten commands (if we don't do this we'll mess up absolute e by adding an offset to the arc)
 				// including the most recent arc command BEFORE updating the absolute e offset
@@ -527,12 +1431,13 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 
 				// If the e values are not equal, use G91 to adjust the current absolute e position
 				double difference = 0;
-				double new_e_rel_relative = p_source_position_->get_current_position().get_current_extruder().e_relative;
+				double new_e_rel_relative = p_source_position_->get_current_position_ptr()->get_current_extruder().e_relative;
 				double old_e_relative = current_arc_.get_shape_e_relative();
 
-				// See if any offset needs to be applied for absolute E coordinates
+				// See if any offset needs to be applied for absolute E coordinates.  Every following absolute E is
+				// unchanged in the other modes, so a rounding difference can't build up.
 				if (
-					!utilities::is_equal(new_e_rel_relative, old_e_relative))
+					arc_e_mode_ == arc_e_mode_offset && !utilities::is_equal(new_e_rel_relative, old_e_relative))
 				{
 					// Calculate the difference between the original absolute e and 
 					// change made by G2/G3
@@ -541,6 +1446,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 					// We need to do this AFTER writing the modified gcode(arc), since the 
 					// difference is based on that.
 					absolute_e_offset_ += difference;
+					record_e_offset_change(false, difference);
 					if (debug_logging_enabled_)
 					{
 						p_logger_->log(logger_type_, DEBUG, "Adjusting absolute extrusion by " + utilities::to_string(difference) + "mm.  New Offset: " + utilities::to_string(difference));
@@ -559,6 +1465,19 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 					p_source_position_->update(undo_commands_[index], lines_processed_, gcodes_processed_, -1);
 				}
 				undo_commands_.clear();
+
+				// Tell the printer where the original segments left the extruder
+				position* p_end_pos = p_source_position_->get_current_position_ptr();
+				if (arc_e_mode_ == arc_e_mode_g92 && !p_end_pos->is_extruder_relative && !utilities::is_equal(new_e_rel_relative, old_e_relative))
+				{
+					parsed_command g92_command;
+					if (!parser_.try_parse_gcode(create_g92_e(p_end_pos->get_current_extruder().get_offset_e()).c_str(), g92_command))
+					{
+						throw std::exception();
+					}
+					unwritten_commands_.push_back(unwritten_command(p_end_pos, g92_command));
+					write_unwritten_gcodes_to_file();
+				}
 				// Now clear the arc and flag the processor as not waiting for an arc
 				waiting_for_arc_ = false;
 				current_arc_.clear();
@@ -591,7 +1510,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 		}
 		else if (debug_logging_enabled_)
 		{
-			p_logger_->log(logger_type_, DEBUG, "Could not add point to arc from gcode:" + cmd.gcode);
+			p_logger_->log(logger_type_, DEBUG, "Could not add point to arc from gcode:" + cmd.get_gcode());
 		}
 
 	}
@@ -600,27 +1519,28 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end)
 		waiting_for_arc_ = false;
 		current_arc_.clear();
 		// The current command is unwritten, add it.
-		unwritten_commands_.push_back(unwritten_command(p_source_position_->get_current_position_ptr()));
+		unwritten_commands_.push_back(unwritten_command(p_source_position_->get_current_position_ptr(), cmd));
 	}
 	else if (waiting_for_arc_ || !arc_added)
 	{
 
-		unwritten_commands_.push_back(unwritten_command(p_source_position_->get_current_position_ptr()));
+		unwritten_commands_.push_back(unwritten_command(p_source_position_->get_current_position_ptr(), cmd));
 		
 	}
 	if (!waiting_for_arc_)
 	{
 		write_unwritten_gcodes_to_file();
 	}
-	if (cmd.command == "G92")
+	if (cmd.id == command_id_g92)
 	{
 		// See if there is an E parameter
 		for (unsigned int parameter_index = 0; parameter_index < cmd.parameters.size(); parameter_index++)
 		{
 			parsed_command_parameter param = cmd.parameters[parameter_index];
-			if (param.name == "E")
+			if (param.name == 'E')
 			{
 				absolute_e_offset_ = 0;
+				record_e_offset_change(true, 0);
 				if (debug_logging_enabled_)
 				{
 					p_logger_->log(logger_type_, DEBUG, "G92 found that set E axis, resetting absolute offset.");
@@ -640,7 +1560,7 @@ std::string arc_welder::get_comment_for_arc()
 	std::string comment;
 	for (; comment_index < unwritten_commands_.count(); comment_index++)
 	{
-		std::string old_comment = unwritten_commands_[comment_index].command.comment;
+		std::string old_comment = unwritten_commands_[comment_index].command.get_comment();
 		if (old_comment != comment && old_comment.length() > 0)
 		{
 			if (comment.length() > 0)
@@ -653,72 +1573,99 @@ std::string arc_welder::get_comment_for_arc()
 	return comment;
 }
 
-std::string arc_welder::create_g92_e(double absolute_e)
+bool arc_welder::is_absolute_e_rewrite_command(const command_id id)
 {
-	std::stringstream stream;
-	stream << std::fixed << std::setprecision(5);
-	stream << "G92 E" << absolute_e;
-	return stream.str();
+	// Commands that will need rewritten absolute e values
+	switch (id)
+	{
+	case command_id_g0:
+	case command_id_g1:
+	case command_id_g2:
+	case command_id_g3:
+		return true;
+	default:
+		return false;
+	}
+}
+
+std::string arc_welder::create_g92_e(double absolute_e) const
+{
+	std::string gcode = "G92";
+	number_formatter::append_parameter(gcode, 'E', absolute_e, GCODE_E_PRECISION, compact_output_);
+	return gcode;
 }
 
-int arc_welder::write_gcode_to_file(std::string gcode)
+int arc_welder::write_gcode_to_file(const std::string& gcode)
 {
-	output_file_ << utilities::trim(gcode) << "\n";
-	//std::cout << utilities::trim(gcode) << "\n";
+	output_file_.write_trimmed_line(gcode.c_str(), static_cast<int>(gcode.length()));
 	return 1;
 }
 
 int arc_welder::write_unwritten_gcodes_to_file()
 {
+	GCODE_PROBE_SCOPE("arc_welder::write_unwritten_gcodes_to_file");
 	int size = unwritten_commands_.count();
-	std::string gcode_to_write;
-	
-	
+	if (size == 0)
+		return 0;
+	stage_timer_.enter(conversion_stage_format);
 	for (int index = 0; index < size; index++)
 	{
 		// The the current unwritten position and remove it from the list
 		unwritten_command p = unwritten_commands_.pop_front();
-		bool has_e_coordinate = false;
-		std::string additional_comment = "";
-		double old_e = p.offset_e;
-		double new_e = old_e;
-		if (!p.is_extruder_relative && utilities::greater_than(abs(absolute_e_offset_), 0.0) &&
-			absolute_e_rewrite_commands_.find(p.command.command) != absolute_e_rewrite_commands_.end()
-		){
-			// handle any absolute extrusion shift
-			// There is an offset, and we are in absolute E.  Rewrite the gcode
-			parsed_command new_command = p.command;
-			new_command.parameters.clear();
-			has_e_coordinate = false;
-			for (unsigned int index = 0; index < p.command.parameters.size(); index++)
-			{
-				parsed_command_parameter p_cur_param = p.command.parameters[index];
-				if (p_cur_param.name == "E")
+		if (p_chunk_ != NULL)
+		{
+			// The absolute e offset of a parallel chunk isn't known yet, so the command is formatted later.
+			p_chunk_->commands.push_back(p);
+			continue;
+		}
+		bool has_e_coordinate = apply_absolute_e_offset(p, absolute_e_offset_);
+		write_unwritten_command(p, has_e_coordinate);
+	}
+	// This is only called while welding
+	stage_timer_.enter(conversion_stage_arc_fit);
+	return size;
+}
+
+bool arc_welder::apply_absolute_e_offset(unwritten_command& p, double absolute_e_offset)
+{
+	bool has_e_coordinate = false;
+	if (!p.is_extruder_relative && utilities::greater_than(fabs(absolute_e_offset), 0.0) &&
+		is_absolute_e_rewrite_command(p.command.id)
+	){
+		// handle any absolute extrusion shift
+		// There is an offset, and we are in absolute E.  Rewrite the gcode
+		parsed_command new_command = p.command;
+		new_command.parameters.clear();
+		for (unsigned int index = 0; index < p.command.parameters.size(); index++)
+		{
+			parsed_command_parameter p_cur_param = p.command.parameters[index];
+			if (p_cur_param.name == 'E')
+			{
+				has_e_coordinate = true;
+				if (p_cur_param.value_type == 'U')
 				{
-					has_e_coordinate = true;
-					if (p_cur_param.value_type == 'U')
-					{
-						p_cur_param.value_type = 'F';
-					}
-					new_e = p.offset_e + absolute_e_offset_;
-					p_cur_param.double_value = new_e;
-					
+					p_cur_param.value_type = 'F';
 				}
-				new_command.parameters.push_back(p_cur_param);
+				p_cur_param.double_value = p.offset_e + absolute_e_offset;
 			}
+			new_command.parameters.push_back(p_cur_param);
+		}
 
-			
-			if (has_e_coordinate)
-			{
-				p.command = new_command;
-			}
+		if (has_e_coordinate)
+		{
+			p.command = new_command;
 		}
-		
-		write_gcode_to_file(p.to_string(has_e_coordinate, additional_comment));
-		
 	}
-	
-	return size;
+	// Returns true if the command must be rewritten
+	return has_e_coordinate;
+}
+
+void arc_welder::record_e_offset_change(bool is_reset, double difference)
+{
+	if (p_chunk_ != NULL)
+	{
+		p_chunk_->e_offset_changes.push_back(e_offset_change(static_cast<int>(p_chunk_->commands.size()), is_reset, difference));
+	}
 }
 
 std::string arc_welder::get_arc_gcode(double f, const std::string comment)
@@ -729,12 +1676,12 @@ std::string arc_welder::get_arc_gcode(double f, const std::string comment)
 	
 	if (p_new_current_pos->is_extruder_relative)
 	{
-		gcode = current_arc_.get_shape_gcode_relative(f);
+		gcode = current_arc_.get_shape_gcode_relative(f, p_new_current_pos->is_relative);
 	}
 	else
 	{
 		// Make sure to add the absoulte e offset
-		gcode = current_arc_.get_shape_gcode_absolute(f, p_new_current_pos->get_current_extruder().get_offset_e());
+		gcode = current_arc_.get_shape_gcode_absolute(f, p_new_current_pos->get_current_extruder().get_offset_e(), p_new_current_pos->is_relative);
 	}
 	if (comment.length() > 0)
 	{
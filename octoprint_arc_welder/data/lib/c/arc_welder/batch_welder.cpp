@@ -0,0 +1,356 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "batch_welder.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include "utilities.h"
+#include "work_stealing_pool.h"
+
+batch_worker_welder::batch_worker_welder(batch_welder* p_batch, logger* log, double resolution_mm, gcode_position_args args)
+	: arc_welder("", "", log, resolution_mm, args)
+{
+	p_batch_ = p_batch;
+	file_index_ = 0;
+	notification_period_seconds = p_batch->notification_period_seconds;
+}
+
+arc_welder_results batch_worker_welder::process_file(int file_index, const batch_welder_job& job)
+{
+	file_index_ = file_index;
+	set_paths(job.source_path, job.target_path);
+	return process();
+}
+
+bool batch_worker_welder::on_progress_(double percent_complete, double seconds_elapsed, double estimated_seconds_remaining, int gcodes_processed, int lines_processed, int points_compressed, int arcs_created)
+{
+	batch_file_progress progress;
+	progress.file_index = file_index_;
+	progress.is_started = true;
+	progress.percent_complete = percent_complete;
+	progress.seconds_elapsed = seconds_elapsed;
+	progress.estimated_seconds_remaining = estimated_seconds_remaining;
+	progress.gcodes_processed = gcodes_processed;
+	progress.lines_processed = lines_processed;
+	progress.points_compressed = points_compressed;
+	progress.arcs_created = arcs_created;
+	return p_batch_->report_progress(progress);
+}
+
+batch_welder::batch_welder(logger* log, double resolution_mm, gcode_position_args args)
+{
+	p_logger_ = log;
+	logger_type_ = 0;
+	resolution_mm_ = resolution_mm;
+	gcode_position_args_ = args;
+	num_threads_ = 0;
+	arc_e_mode_ = arc_e_mode_offset;
+	compact_output_ = false;
+	radius_arcs_ = false;
+	helical_arcs_ = false;
+	notification_period_seconds = 1;
+	cancel_requested_.store(false);
+	bytes_total_ = 0;
+	files_complete_ = 0;
+	files_failed_ = 0;
+	start_clock_ = 0;
+}
+
+batch_welder::batch_welder(logger* log, double resolution_mm, bool g90_g91_influences_extruder, int buffer_size)
+	: batch_welder(log, resolution_mm, arc_welder::get_args_(g90_g91_influences_extruder, buffer_size))
+{
+}
+
+batch_welder::batch_welder(const batch_welder& source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+batch_welder::~batch_welder()
+{
+}
+
+void batch_welder::set_logger_type(int logger_type)
+{
+	logger_type_ = logger_type;
+}
+
+void batch_welder::set_num_threads(int num_threads)
+{
+	num_threads_ = num_threads;
+}
+
+void batch_welder::set_arc_e_mode(arc_e_mode mode)
+{
+	arc_e_mode_ = mode;
+}
+
+void batch_welder::set_compact_output(bool compact_output)
+{
+	compact_output_ = compact_output;
+}
+
+void batch_welder::set_radius_arcs(bool radius_arcs)
+{
+	radius_arcs_ = radius_arcs;
+}
+
+void batch_welder::set_helical_arcs(bool helical_arcs)
+{
+	helical_arcs_ = helical_arcs;
+}
+
+void batch_welder::cancel()
+{
+	cancel_requested_.store(true);
+	std::lock_guard<std::mutex> lock(progress_mutex_);
+	for (unsigned int index = 0; index < workers_.size(); index++)
+	{
+		workers_[index]->cancel();
+	}
+}
+
+bool batch_welder::is_cancelled() const
+{
+	return cancel_requested_.load();
+}
+
+double batch_welder::get_clock_seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<arc_welder_results> batch_welder::process(const std::vector<batch_welder_job>& jobs)
+{
+	const int num_jobs = static_cast<int>(jobs.size());
+	std::vector<arc_welder_results> results(num_jobs);
+	if (num_jobs == 0)
+	{
+		return results;
+	}
+
+	int num_threads = num_threads_;
+	if (num_threads < 1)
+	{
+		num_threads = static_cast<int>(std::thread::hardware_concurrency());
+		if (num_threads < 1)
+			num_threads = 1;
+	}
+	if (num_threads > num_jobs)
+	{
+		num_threads = num_jobs;
+	}
+
+	// Deal the files out largest first, so that every queue starts with its biggest file and the small ones are left
+	// at the back, where they are stolen.
+	std::vector<int> order(num_jobs);
+	{
+		std::lock_guard<std::mutex> lock(progress_mutex_);
+		file_progress_ = std::vector<batch_file_progress>(num_jobs);
+		file_sizes_ = std::vector<long long>(num_jobs);
+		bytes_total_ = 0;
+		files_complete_ = 0;
+		files_failed_ = 0;
+		start_clock_ = get_clock_seconds();
+		for (int index = 0; index < num_jobs; index++)
+		{
+			order[index] = index;
+			file_progress_[index].file_index = index;
+			long long file_size = utilities::get_file_size(jobs[index].source_path);
+			file_sizes_[index] = file_size > 0 ? file_size : 0;
+			bytes_total_ += file_sizes_[index];
+		}
+		for (int index = 0; index < num_threads; index++)
+		{
+			workers_.push_back(new batch_worker_welder(this, p_logger_, resolution_mm_, gcode_position_args_));
+			workers_[index]->set_logger_type(logger_type_);
+			workers_[index]->set_arc_e_mode(arc_e_mode_);
+			workers_[index]->set_compact_output(compact_output_);
+			workers_[index]->set_radius_arcs(radius_arcs_);
+			workers_[index]->set_helical_arcs(helical_arcs_);
+			if (cancel_requested_.load())
+			{
+				workers_[index]->cancel();
+			}
+		}
+	}
+	const std::vector<long long>& file_sizes = file_sizes_;
+	std::stable_sort(order.begin(), order.end(), [&file_sizes](int left, int right) {
+		return file_sizes[left] > file_sizes[right];
+	});
+	work_stealing_pool<int> pool(num_threads);
+	for (int index = 0; index < num_jobs; index++)
+	{
+		pool.push(index % num_threads, order[index]);
+	}
+
+	if (p_logger_->is_log_level_enabled(logger_type_, INFO))
+	{
+		std::stringstream stream;
+		stream << "Converting " << num_jobs << " files (" << bytes_total_ << " bytes) on " << num_threads << " threads.";
+		p_logger_->log(logger_type_, INFO, stream.str());
+	}
+
+	pool.run([this, &jobs, &results](int thread_index, int file_index) {
+		arc_welder_results file_results;
+		if (cancel_requested_.load())
+		{
+			file_results.cancelled = true;
+		}
+		else
+		{
+			try
+			{
+				file_results = workers_[thread_index]->process_file(file_index, jobs[file_index]);
+			}
+			catch (...)
+			{
+				// The welder has already logged the error
+				file_results.success = false;
+				file_results.message = "An error occurred while converting the file.";
+			}
+		}
+		on_file_finished_(file_results);
+		results[file_index] = file_results;
+		complete_file(file_index, file_results);
+	});
+
+	{
+		std::lock_guard<std::mutex> lock(progress_mutex_);
+		for (unsigned int index = 0; index < workers_.size(); index++)
+		{
+			delete workers_[index];
+		}
+		workers_.clear();
+	}
+	return results;
+}
+
+void batch_welder::on_file_finished_(arc_welder_results& /* results */)
+{
+}
+
+bool batch_welder::report_progress(const batch_file_progress& file_progress)
+{
+	std::lock_guard<std::mutex> lock(progress_mutex_);
+	file_progress_[file_progress.file_index] = file_progress;
+	// The welder reports 100% as it finishes.  complete_file reports the file once its results are known.
+	if (file_progress.percent_complete >= 100 || cancel_requested_.load())
+	{
+		return !cancel_requested_.load();
+	}
+	if (!on_progress_(file_progress, get_overall_progress()))
+	{
+		cancel_requested_.store(true);
+		for (unsigned int index = 0; index < workers_.size(); index++)
+		{
+			workers_[index]->cancel();
+		}
+		return false;
+	}
+	return true;
+}
+
+void batch_welder::complete_file(int file_index, const arc_welder_results& results)
+{
+	std::lock_guard<std::mutex> lock(progress_mutex_);
+	batch_file_progress& progress = file_progress_[file_index];
+	progress.is_complete = true;
+	if (results.success)
+	{
+		progress.is_started = true;
+		progress.percent_complete = 100;
+		progress.estimated_seconds_remaining = 0;
+		progress.seconds_elapsed = results.seconds_elapsed;
+		progress.gcodes_processed = results.gcodes_processed;
+		progress.lines_processed = results.lines_processed;
+		progress.points_compressed = results.points_compressed;
+		progress.arcs_created = results.arcs_created;
+	}
+	else
+	{
+		files_failed_++;
+	}
+	files_complete_++;
+	if (!on_progress_(progress, get_overall_progress()))
+	{
+		cancel_requested_.store(true);
+		for (unsigned int index = 0; index < workers_.size(); index++)
+		{
+			workers_[index]->cancel();
+		}
+	}
+}
+
+batch_progress batch_welder::get_overall_progress() const
+{
+	batch_progress overall;
+	overall.files_total = static_cast<int>(file_progress_.size());
+	overall.files_complete = files_complete_;
+	overall.files_failed = files_failed_;
+	overall.bytes_total = bytes_total_;
+	overall.seconds_elapsed = get_clock_seconds() - start_clock_;
+	double bytes_processed = 0;
+	for (unsigned int index = 0; index < file_progress_.size(); index++)
+	{
+		const batch_file_progress& progress = file_progress_[index];
+		// A file that failed or was skipped counts as done, so that the total still reaches 100%
+		bytes_processed += static_cast<double>(file_sizes_[index]) * (progress.is_complete ? 100 : progress.percent_complete) / 100.0;
+		overall.gcodes_processed += progress.gcodes_processed;
+		overall.lines_processed += progress.lines_processed;
+		overall.points_compressed += progress.points_compressed;
+		overall.arcs_created += progress.arcs_created;
+	}
+	if (bytes_total_ > 0)
+	{
+		overall.percent_complete = bytes_processed / static_cast<double>(bytes_total_) * 100.0;
+	}
+	else
+	{
+		overall.percent_complete = static_cast<double>(files_complete_) / static_cast<double>(overall.files_total) * 100.0;
+	}
+	if (overall.percent_complete > 0)
+	{
+		overall.estimated_seconds_remaining = overall.seconds_elapsed * (100.0 - overall.percent_complete) / overall.percent_complete;
+	}
+	return overall;
+}
+
+bool batch_welder::on_progress_(const batch_file_progress& file_progress, const batch_progress& overall_progress)
+{
+	if (p_logger_->is_log_level_enabled(logger_type_, DEBUG))
+	{
+		std::stringstream stream;
+		stream << "File " << file_progress.file_index + 1 << ": " << utilities::to_string(file_progress.percent_complete) <<
+			"% complete.  Batch: " << overall_progress.files_complete << " of " << overall_progress.files_total <<
+			" files complete, " << utilities::to_string(overall_progress.percent_complete) << "% complete in " <<
+			utilities::to_string(overall_progress.seconds_elapsed) << " seconds, " <<
+			utilities::to_string(overall_progress.estimated_seconds_remaining) << " seconds remaining.";
+		p_logger_->log(logger_type_, DEBUG, stream.str());
+	}
+	return true;
+}
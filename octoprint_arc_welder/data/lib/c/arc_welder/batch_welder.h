@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "arc_welder.h"
+#include "logger.h"
+
+// A file to convert as part of a batch
+struct batch_welder_job
+{
+	batch_welder_job() {
+	}
+	batch_welder_job(std::string source, std::string target) {
+		source_path = source;
+		target_path = target;
+	}
+	std::string source_path;
+	std::string target_path;
+};
+
+// The progress of one file in a batch
+struct batch_file_progress
+{
+	batch_file_progress() {
+		file_index = 0;
+		is_started = false;
+		is_complete = false;
+		percent_complete = 0;
+		seconds_elapsed = 0;
+		estimated_seconds_remaining = 0;
+		gcodes_processed = 0;
+		lines_processed = 0;
+		points_compressed = 0;
+		arcs_created = 0;
+	}
+	// The index of the file in the list passed to process()
+	int file_index;
+	bool is_started;
+	bool is_complete;
+	double percent_complete;
+	double seconds_elapsed;
+	double estimated_seconds_remaining;
+	int gcodes_processed;
+	int lines_processed;
+	int points_compressed;
+	int arcs_created;
+};
+
+// The progress of a whole batch.  The counts include every file that has been started.
+struct batch_progress
+{
+	batch_progress() {
+		files_total = 0;
+		files_complete = 0;
+		files_failed = 0;
+		bytes_total = 0;
+		percent_complete = 0;
+		seconds_elapsed = 0;
+		estimated_seconds_remaining = 0;
+		gcodes_processed = 0;
+		lines_processed = 0;
+		points_compressed = 0;
+		arcs_created = 0;
+	}
+	int files_total;
+	int files_complete;
+	int files_failed;
+	long long bytes_total;
+	// Weighted by the size of each file
+	double percent_complete;
+	double seconds_elapsed;
+	double estimated_seconds_remaining;
+	int gcodes_processed;
+	int lines_processed;
+	int points_compressed;
+	int arcs_created;
+};
+
+class batch_welder;
+
+// The welder owned by one thread of a batch.  It is reused for every file the thread converts, so the position
+// buffers, the arc and the parser are only built once.
+class batch_worker_welder : public arc_welder
+{
+public:
+	batch_worker_welder(batch_welder* p_batch, logger* log, double resolution_mm, gcode_position_args args);
+	virtual ~batch_worker_welder() {
+	}
+	arc_welder_results process_file(int file_index, const batch_welder_job& job);
+protected:
+	virtual bool on_progress_(double percent_complete, double seconds_elapsed, double estimated_seconds_remaining, int gcodes_processed, int lines_processed, int points_compressed, int arcs_created);
+private:
+	batch_welder* p_batch_;
+	int file_index_;
+};
+
+// Converts many files at once, one file per thread, on a work-stealing pool.  The largest files are started first so
+// that a big file queued last can't leave the batch waiting on a single thread.
+class batch_welder
+{
+public:
+	batch_welder(logger* log, double resolution_mm, gcode_position_args args);
+	batch_welder(logger* log, double resolution_mm, bool g90_g91_influences_extruder, int buffer_size);
+	virtual ~batch_welder();
+	void set_logger_type(int logger_type);
+	// The number of files converted at once.  0 or less uses one thread per core.
+	void set_num_threads(int num_threads);
+	void set_arc_e_mode(arc_e_mode mode);
+	void set_compact_output(bool compact_output);
+	void set_radius_arcs(bool radius_arcs);
+	void set_helical_arcs(bool helical_arcs);
+	// Returns the results of every job, in the order they were supplied.  Jobs that were never started because the
+	// batch was cancelled are marked as cancelled.
+	std::vector<arc_welder_results> process(const std::vector<batch_welder_job>& jobs);
+	// Asks process() to stop every file as soon as possible.  This may be called from any thread.
+	void cancel();
+	bool is_cancelled() const;
+	double notification_period_seconds;
+protected:
+	// Called with the progress of one file and of the whole batch, from whichever thread is converting the file.  Calls
+	// are never made at the same time.  Return false to cancel the batch.
+	virtual bool on_progress_(const batch_file_progress& file_progress, const batch_progress& overall_progress);
+	// Called with the results of each file, on the thread that converted it, before they are stored.  A file that
+	// fails never fails the batch.
+	virtual void on_file_finished_(arc_welder_results& results);
+private:
+	friend class batch_worker_welder;
+	batch_welder(const batch_welder& source);
+	bool report_progress(const batch_file_progress& file_progress);
+	void complete_file(int file_index, const arc_welder_results& results);
+	batch_progress get_overall_progress() const;
+	static double get_clock_seconds();
+	logger* p_logger_;
+	int logger_type_;
+	double resolution_mm_;
+	gcode_position_args gcode_position_args_;
+	int num_threads_;
+	arc_e_mode arc_e_mode_;
+	bool compact_output_;
+	bool radius_arcs_;
+	bool helical_arcs_;
+	std::atomic<bool> cancel_requested_;
+	std::vector<batch_worker_welder*> workers_;
+	// Guards everything below, and serializes the calls to on_progress_
+	std::mutex progress_mutex_;
+	std::vector<batch_file_progress> file_progress_;
+	std::vector<long long> file_sizes_;
+	long long bytes_total_;
+	int files_complete_;
+	int files_failed_;
+	double start_clock_;
+};
@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "circle_tolerance.h"
+#include "segmented_shape.h"
+#include "utilities.h"
+#include <math.h>
+#ifdef CIRCLE_TOLERANCE_USE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef CIRCLE_TOLERANCE_USE_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CIRCLE_TOLERANCE_AVX2_FUNCTION
+#else
+#define CIRCLE_TOLERANCE_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+double circle_tolerance::get_segment_deviation(double x1, double y1, double x2, double y2, double center_x, double center_y, double radius)
+{
+	double deviation = fabs(utilities::get_cartesian_distance(x2, y2, center_x, center_y) - radius);
+	double segment_x = x2 - x1;
+	double segment_y = y2 - y1;
+	double t = ((center_x - x1) * segment_x + (center_y - y1) * segment_y) / (segment_x * segment_x + segment_y * segment_y);
+	if (utilities::less_than_or_equal(t, 0, CIRCLE_FLOATING_POINT_TOLERANCE) || utilities::greater_than_or_equal(t, 1, CIRCLE_FLOATING_POINT_TOLERANCE))
+		return deviation;
+	double foot_deviation = fabs(utilities::get_cartesian_distance(x1 + t * segment_x, y1 + t * segment_y, center_x, center_y) - radius);
+	if (foot_deviation > deviation)
+		return foot_deviation;
+	return deviation;
+}
+
+// Scalar tail shared by all of the kernels.  Checks segments [index - 1, index] for index in [start, count).
+static inline bool check_segments(const double* x, const double* y, int start, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation)
+{
+	for (int index = start; index < count; index++)
+	{
+		double deviation = circle_tolerance::get_segment_deviation(x[index - 1], y[index - 1], x[index], y[index], center_x, center_y, radius);
+		if (utilities::greater_than(deviation, tolerance))
+			return false;
+		if (deviation > max_deviation)
+			max_deviation = deviation;
+	}
+	return true;
+}
+
+bool circle_tolerance::does_circle_fit_points(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation)
+{
+	static const kernel_function kernel = select_kernel(NULL);
+	return kernel(x, y, count, center_x, center_y, radius, tolerance, max_deviation);
+}
+
+const char* circle_tolerance::get_kernel_name()
+{
+	const char* name;
+	select_kernel(&name);
+	return name;
+}
+
+circle_tolerance::kernel_function circle_tolerance::select_kernel(const char** name)
+{
+#ifdef CIRCLE_TOLERANCE_USE_AVX2
+	bool has_avx2;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	// The OS must save the ymm registers (osxsave + xgetbv) for avx to be usable
+	bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	has_avx2 = os_saves_ymm && (info[1] & (1 << 5)) != 0;
+#else
+	has_avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+	if (has_avx2)
+	{
+		if (name != NULL)
+			*name = "avx2";
+		return does_circle_fit_points_avx2;
+	}
+#endif
+#ifdef CIRCLE_TOLERANCE_USE_SSE2
+	if (name != NULL)
+		*name = "sse2";
+	return does_circle_fit_points_sse2;
+#else
+	if (name != NULL)
+		*name = "scalar";
+	return does_circle_fit_points_scalar;
+#endif
+}
+
+bool circle_tolerance::does_circle_fit_points_scalar(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation)
+{
+	max_deviation = 0;
+	return check_segments(x, y, 1, count, center_x, center_y, radius, tolerance, max_deviation);
+}
+
+#ifdef CIRCLE_TOLERANCE_USE_SSE2
+// There is no blend in SSE2, so select with and/andnot/or.
+static inline __m128d select_sse2(__m128d mask, __m128d if_true, __m128d if_false)
+{
+	return _mm_or_pd(_mm_and_pd(mask, if_true), _mm_andnot_pd(mask, if_false));
+}
+
+bool circle_tolerance::does_circle_fit_points_sse2(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation)
+{
+	const __m128d cx = _mm_set1_pd(center_x);
+	const __m128d cy = _mm_set1_pd(center_y);
+	const __m128d r = _mm_set1_pd(radius);
+	const __m128d tol = _mm_set1_pd(tolerance);
+	const __m128d zero_tolerance = _mm_set1_pd(ZERO_TOLERANCE);
+	const __m128d circle_tolerance = _mm_set1_pd(CIRCLE_FLOATING_POINT_TOLERANCE);
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d sign_mask = _mm_set1_pd(-0.0);
+	__m128d max_dev = zero;
+
+	int index = 1;
+	for (; index + 2 <= count; index += 2)
+	{
+		__m128d x1 = _mm_loadu_pd(x + index - 1);
+		__m128d y1 = _mm_loadu_pd(y + index - 1);
+		__m128d x2 = _mm_loadu_pd(x + index);
+		__m128d y2 = _mm_loadu_pd(y + index);
+
+		// Distance of the end point from the circle
+		__m128d dx = _mm_sub_pd(x2, cx);
+		__m128d dy = _mm_sub_pd(y2, cy);
+		__m128d dev = _mm_andnot_pd(sign_mask, _mm_sub_pd(_mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy))), r));
+
+		// Project the center onto the segment
+		__m128d sx = _mm_sub_pd(x2, x1);
+		__m128d sy = _mm_sub_pd(y2, y1);
+		__m128d num = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(cx, x1), sx), _mm_mul_pd(_mm_sub_pd(cy, y1), sy));
+		__m128d denom = _mm_add_pd(_mm_mul_pd(sx, sx), _mm_mul_pd(sy, sy));
+		__m128d t = _mm_div_pd(num, denom);
+		__m128d at_start = _mm_or_pd(_mm_cmplt_pd(t, zero), _mm_cmplt_pd(_mm_andnot_pd(sign_mask, t), circle_tolerance));
+		__m128d at_end = _mm_or_pd(_mm_cmpgt_pd(t, one), _mm_cmplt_pd(_mm_andnot_pd(sign_mask, _mm_sub_pd(t, one)), circle_tolerance));
+
+		// Distance of the foot point from the circle, if the foot lies between the end points
+		__m128d fx = _mm_sub_pd(_mm_add_pd(x1, _mm_mul_pd(t, sx)), cx);
+		__m128d fy = _mm_sub_pd(_mm_add_pd(y1, _mm_mul_pd(t, sy)), cy);
+		__m128d foot_dev = _mm_andnot_pd(sign_mask, _mm_sub_pd(_mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(fx, fx), _mm_mul_pd(fy, fy))), r));
+		__m128d use_foot = _mm_andnot_pd(_mm_or_pd(at_start, at_end), _mm_cmpgt_pd(foot_dev, dev));
+		dev = select_sse2(use_foot, foot_dev, dev);
+
+		// utilities::greater_than(dev, tolerance)
+		__m128d difference = _mm_andnot_pd(sign_mask, _mm_sub_pd(dev, tol));
+		__m128d out_of_tolerance = _mm_andnot_pd(_mm_cmplt_pd(difference, zero_tolerance), _mm_cmpgt_pd(dev, tol));
+		if (_mm_movemask_pd(out_of_tolerance) != 0)
+			return false;
+		max_dev = select_sse2(_mm_cmpgt_pd(dev, max_dev), dev, max_dev);
+	}
+
+	double lanes[2];
+	_mm_storeu_pd(lanes, max_dev);
+	max_deviation = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+	return check_segments(x, y, index, count, center_x, center_y, radius, tolerance, max_deviation);
+}
+#endif
+
+#ifdef CIRCLE_TOLERANCE_USE_AVX2
+CIRCLE_TOLERANCE_AVX2_FUNCTION
+bool circle_tolerance::does_circle_fit_points_avx2(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation)
+{
+	const __m256d cx = _mm256_set1_pd(center_x);
+	const __m256d cy = _mm256_set1_pd(center_y);
+	const __m256d r = _mm256_set1_pd(radius);
+	const __m256d tol = _mm256_set1_pd(tolerance);
+	const __m256d zero_tolerance = _mm256_set1_pd(ZERO_TOLERANCE);
+	const __m256d circle_tolerance = _mm256_set1_pd(CIRCLE_FLOATING_POINT_TOLERANCE);
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d sign_mask = _mm256_set1_pd(-0.0);
+	__m256d max_dev = zero;
+
+	int index = 1;
+	for (; index + 4 <= count; index += 4)
+	{
+		__m256d x1 = _mm256_loadu_pd(x + index - 1);
+		__m256d y1 = _mm256_loadu_pd(y + index - 1);
+		__m256d x2 = _mm256_loadu_pd(x + index);
+		__m256d y2 = _mm256_loadu_pd(y + index);
+
+		// Distance of the end point from the circle
+		__m256d dx = _mm256_sub_pd(x2, cx);
+		__m256d dy = _mm256_sub_pd(y2, cy);
+		__m256d dev = _mm256_andnot_pd(sign_mask, _mm256_sub_pd(_mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy))), r));
+
+		// Project the center onto the segment
+		__m256d sx = _mm256_sub_pd(x2, x1);
+		__m256d sy = _mm256_sub_pd(y2, y1);
+		__m256d num = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(cx, x1), sx), _mm256_mul_pd(_mm256_sub_pd(cy, y1), sy));
+		__m256d denom = _mm256_add_pd(_mm256_mul_pd(sx, sx), _mm256_mul_pd(sy, sy));
+		__m256d t = _mm256_div_pd(num, denom);
+		__m256d at_start = _mm256_or_pd(_mm256_cmp_pd(t, zero, _CMP_LT_OQ), _mm256_cmp_pd(_mm256_andnot_pd(sign_mask, t), circle_tolerance, _CMP_LT_OQ));
+		__m256d at_end = _mm256_or_pd(_mm256_cmp_pd(t, one, _CMP_GT_OQ), _mm256_cmp_pd(_mm256_andnot_pd(sign_mask, _mm256_sub_pd(t, one)), circle_tolerance, _CMP_LT_OQ));
+
+		// Distance of the foot point from the circle, if the foot lies between the end points
+		__m256d fx = _mm256_sub_pd(_mm256_add_pd(x1, _mm256_mul_pd(t, sx)), cx);
+		__m256d fy = _mm256_sub_pd(_mm256_add_pd(y1, _mm256_mul_pd(t, sy)), cy);
+		__m256d foot_dev = _mm256_andnot_pd(sign_mask, _mm256_sub_pd(_mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(fx, fx), _mm256_mul_pd(fy, fy))), r));
+		__m256d use_foot = _mm256_andnot_pd(_mm256_or_pd(at_start, at_end), _mm256_cmp_pd(foot_dev, dev, _CMP_GT_OQ));
+		dev = _mm256_blendv_pd(dev, foot_dev, use_foot);
+
+		// utilities::greater_than(dev, tolerance)
+		__m256d difference = _mm256_andnot_pd(sign_mask, _mm256_sub_pd(dev, tol));
+		__m256d out_of_tolerance = _mm256_andnot_pd(_mm256_cmp_pd(difference, zero_tolerance, _CMP_LT_OQ), _mm256_cmp_pd(dev, tol, _CMP_GT_OQ));
+		if (_mm256_movemask_pd(out_of_tolerance) != 0)
+			return false;
+		max_dev = _mm256_blendv_pd(max_dev, dev, _mm256_cmp_pd(dev, max_dev, _CMP_GT_OQ));
+	}
+
+	double lanes[4];
+	_mm256_storeu_pd(lanes, max_dev);
+	max_deviation = 0;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (lanes[lane] > max_deviation)
+			max_deviation = lanes[lane];
+	}
+	return check_segments(x, y, index, count, center_x, center_y, radius, tolerance, max_deviation);
+}
+#endif
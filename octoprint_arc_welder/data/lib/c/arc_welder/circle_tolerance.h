@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+// SSE2 is always available on these targets.  AVX2 is selected at runtime when the cpu supports it.
+// Other targets (ARM) use the scalar kernel.  Define CIRCLE_TOLERANCE_DISABLE_SIMD to force the scalar kernel.
+#ifndef CIRCLE_TOLERANCE_DISABLE_SIMD
+#define CIRCLE_TOLERANCE_USE_SSE2
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define CIRCLE_TOLERANCE_USE_AVX2
+#endif
+#endif
+#endif
+
+// Checks a run of arc points against a circle.  The points are stored as a structure of arrays (x[i], y[i]).
+// Each point after the first, and the point closest to the circle's center on each segment between two
+// points, must be within the tolerance of the circle.  Deviations are compared with utilities::greater_than,
+// and the results are identical no matter which kernel is used.
+class circle_tolerance
+{
+public:
+	// Returns false on the first point or segment that does not fit.  Otherwise max_deviation is set to the
+	// largest distance of any point or segment from the circle.
+	static bool does_circle_fit_points(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation);
+	// Returns the larger of the distance of (x2, y2) from the circle, and the distance of the point on the segment
+	// closest to the center from the circle (if that point lies between the end points).
+	static double get_segment_deviation(double x1, double y1, double x2, double y2, double center_x, double center_y, double radius);
+	// The name of the kernel selected for this cpu, "avx2", "sse2" or "scalar".
+	static const char* get_kernel_name();
+private:
+	circle_tolerance();
+	typedef bool(*kernel_function)(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation);
+	static kernel_function select_kernel(const char** name);
+	static bool does_circle_fit_points_scalar(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation);
+#ifdef CIRCLE_TOLERANCE_USE_SSE2
+	static bool does_circle_fit_points_sse2(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation);
+#endif
+#ifdef CIRCLE_TOLERANCE_USE_AVX2
+	static bool does_circle_fit_points_avx2(const double* x, const double* y, int count, double center_x, double center_y, double radius, double tolerance, double& max_deviation);
+#endif
+};
@@ -26,28 +26,64 @@
 #include "segmented_arc.h"
 #include "utilities.h"
 #include "segmented_shape.h"
+#include "circle_tolerance.h"
+#include "probes.h"
+#include "number_formatter.h"
 #include <iostream>
-#include <iomanip>
-#include <sstream>
 #include "math.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 segmented_arc::segmented_arc() : segmented_shape()
 {
 	min_segments_ = 3;
-	s_stream_ << std::fixed;
+	preserve_extrusion_ = false;
+	compact_output_ = false;
+	radius_arcs_ = false;
+	helical_arcs_ = false;
+	points_x_.reserve(get_max_segments());
+	points_y_.reserve(get_max_segments());
+	points_length_.reserve(get_max_segments());
+	rebuild_fit();
 }
 
 segmented_arc::segmented_arc(int max_segments, double resolution_mm) : segmented_shape(3, max_segments, resolution_mm)
 {
 	min_segments_ = 3;
-	s_stream_ << std::fixed;
+	preserve_extrusion_ = false;
+	compact_output_ = false;
+	radius_arcs_ = false;
+	helical_arcs_ = false;
+	points_x_.reserve(get_max_segments());
+	points_y_.reserve(get_max_segments());
+	points_length_.reserve(get_max_segments());
+	rebuild_fit();
 }
 
 segmented_arc::~segmented_arc()
 {
 }
 
+void segmented_arc::set_preserve_extrusion(bool preserve_extrusion)
+{
+	preserve_extrusion_ = preserve_extrusion;
+}
+
+void segmented_arc::set_compact_output(bool compact_output)
+{
+	compact_output_ = compact_output;
+}
+
+void segmented_arc::set_radius_arcs(bool radius_arcs)
+{
+	radius_arcs_ = radius_arcs;
+}
+
+void segmented_arc::set_helical_arcs(bool helical_arcs)
+{
+	helical_arcs_ = helical_arcs;
+}
+
 point segmented_arc::pop_front(double e_relative)
 {
 	e_relative_ -= e_relative;
@@ -55,16 +91,22 @@ point segmented_arc::pop_front(double e_relative)
 	{
 		set_is_shape(false);
 	}
-	return points_.pop_front();
+	point p = points_.pop_front();
+	rebuild_fit();
+	return p;
 }
 point segmented_arc::pop_back(double e_relative)
 {
 	e_relative_ -= e_relative;
-	return points_.pop_back();
-	if (points_.count() == min_segments_)
-	{
-		set_is_shape(false);
-	}
+	point p = points_.pop_back();
+	rebuild_fit();
+	return p;
+}
+
+void segmented_arc::clear()
+{
+	segmented_shape::clear();
+	rebuild_fit();
 }
 
 bool segmented_arc::is_shape()
@@ -80,7 +122,7 @@ bool segmented_arc::is_shape()
 
 bool segmented_arc::try_add_point(point p, double e_relative)
 {
-	
+	GCODE_PROBE_SCOPE("segmented_arc::try_add_point");
 	bool point_added = false;
 	// if we don't have enough segnemts to check the shape, just add
 	if (points_.count() > get_max_segments() - 1)
@@ -93,7 +135,7 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	{
 		point p1 = points_[points_.count() - 1];
 		distance = utilities::get_cartesian_distance(p1.x, p1.y, p.x, p.y);
-		if (!utilities::is_equal(p1.z, p.z))
+		if (!helical_arcs_ && !utilities::is_equal(p1.z, p.z))
 		{
 			// Arcs require that z is equal for all points
 			//std::cout << " failed - z change.\n";
@@ -127,6 +169,13 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	if (point_added)
 	{
 		points_.push_back(p);
+		points_x_.push_back(p.x);
+		points_y_.push_back(p.y);
+		points_length_.push_back(points_length_.empty() ? 0 : points_length_.back() + distance);
+		if (points_.count() > 1)
+		{
+			add_fit_point(p);
+		}
 		original_shape_length_ += distance;
 		if (points_.count() > 1)
 		{
@@ -140,6 +189,8 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 		// If we haven't added a point, and we have exactly min_segments_,
 		// pull off the initial arc point and try again
 		point old_initial_point = points_.pop_front();
+		// The fit is relative to the initial point, so it must be rebuilt
+		rebuild_fit();
 		// We have to remove the distance and e relative value
 		// accumulated between the old arc start point and the new
 		point new_initial_point = points_[0];
@@ -157,120 +208,164 @@ bool segmented_arc::try_add_point_internal(point p, double pd)
 	// If we don't have enough points (at least min_segments) return false
 	if (points_.count() < min_segments_ - 1)
 		return false;
-	
-	// Create a test circle
-	circle test_circle;
-	bool circle_created;
-	// Find a point in the middle of our list for p2
-	int mid_point_index = ((points_.count() - 2) / 2)+1;
-	circle_created = circle::try_create_circle(points_[0], points_[mid_point_index], p, test_circle);
-	
-	if (circle_created)
+
+	if (helical_arcs_ && !does_z_fit_points(p, pd))
 	{
+		return false;
+	}
 
-		// If we got a circle, make sure all of the points fit within the tolerance.
-		bool circle_fits_points;
+	// Create a test circle from the running fit, including the new point
+	circle test_circle;
+	if (!try_get_fitted_circle(p, test_circle))
+	{
+		return false;
+	}
 
-		// the circle is new..  we have to test it now, which is expensive :(
-		circle_fits_points = does_circle_fit_points(test_circle, p, pd);
-		if (circle_fits_points)
-		{
-			arc_circle_ = test_circle;
-		}
-		
-		// Only set is_shape if it goes from false to true
-		if (!is_shape())
-			set_is_shape(circle_fits_points);
-		
-		return circle_fits_points;
+	// The new point and the new segment are always checked against the test circle.
+	point last_point = points_[points_.count() - 1];
+	double new_deviation = circle_tolerance::get_segment_deviation(last_point.x, last_point.y, p.x, p.y, test_circle.center.x, test_circle.center.y, test_circle.radius);
+	if (utilities::greater_than(new_deviation, resolution_mm_))
+	{
+		return false;
 	}
-	
-	//std::cout << " failed - could not create a circle from the points.\n";
-	return false;
-	
-}
 
-bool segmented_arc::does_circle_fit_points(circle c, point p, double pd)
-{
-	// We know point 1 must fit (we used it to create the circle).  Check the other points
-	// Note:  We have not added the current point, but that's fine since it is guaranteed to fit too.
-	// If this works, it will be added.
-
-	double distance_from_center;
-	double difference_from_radius;
-	
-	// Check the endpoints to make sure they fit the current circle
-	for (int index = 1; index < points_.count(); index++)
+	// Every existing point lies within verified_deviation_ of the verified circle.  Moving the center
+	// and changing the radius can move a point's distance from the circle by at most the sum of those
+	// changes, so the existing points only need to be checked again when that bound exceeds the resolution.
+	circle verified_circle = verified_circle_;
+	double verified_deviation;
+	double drift = utilities::get_cartesian_distance(test_circle.center.x, test_circle.center.y, verified_circle_.center.x, verified_circle_.center.y)
+		+ abs(test_circle.radius - verified_circle_.radius);
+	if (has_verified_circle_ && !utilities::greater_than(verified_deviation_ + drift, resolution_mm_))
 	{
-		// Make sure the length from the center of our circle to the test point is 
-		// at or below our max distance.
-		distance_from_center = utilities::get_cartesian_distance(points_[index].x, points_[index].y, c.center.x, c.center.y);
-		double difference_from_radius = abs(distance_from_center - c.radius);
-		if (utilities::greater_than(difference_from_radius, resolution_mm_))
-		{
-			//std::cout << " failed - end points do not lie on circle.\n";
-			return false;
-		}
+		GCODE_PROBE_COUNT("segmented_arc::try_add_point_internal.drift_bound_passed");
+		verified_deviation = verified_deviation_;
+		if (new_deviation + drift > verified_deviation)
+			verified_deviation = new_deviation + drift;
 	}
-	
-	/*
-	// Check the midpoints of the segments in the points_ to make sure they fit our circle.
-	 for (int index = 0; index < points_.count() - 1; index++)
+	else
 	{
-		// Make sure the length from the center of our circle to the test point is 
-		// at or below our max distance.
-		point midpoint = point::get_midpoint(points_[index], points_[index + 1]);
-		distance_from_center = utilities::get_cartesian_distance(midpoint.x, midpoint.y, c.center.x, c.center.y);
-		difference_from_radius = abs(distance_from_center - c.radius);
-		// Test allowing more play for the midpoints.
-		if (utilities::greater_than(difference_from_radius, resolution_mm_))
+		// the bound is too loose, so we have to test every point, which is expensive :(
+		if (!does_circle_fit_points(test_circle, verified_deviation))
 		{
-			//std::cout << " failed - midpoints do not lie on circle.\n";
+			GCODE_PROBE_COUNT("segmented_arc::does_circle_fit_points.rejected");
 			return false;
 		}
+		if (new_deviation > verified_deviation)
+			verified_deviation = new_deviation;
+		verified_circle = test_circle;
 	}
-	*/
-	// Check the point perpendicular from the segment to the circle's center, if any such point exists
-	for (int index = 0; index < points_.count() - 1; index++)
+
+	// get the current arc and compare the total length to the original length
+	arc a;
+	bool circle_fits_points = try_get_arc(test_circle, p, pd, a);
+	if (circle_fits_points)
 	{
-		point point_to_test;
-		if (segment::get_closest_perpendicular_point(points_[index], points_[index + 1], c.center, point_to_test))
-		{
-			distance_from_center = utilities::get_cartesian_distance(point_to_test.x, point_to_test.y, c.center.x, c.center.y);
-			difference_from_radius = abs(distance_from_center - c.radius);
-			// Test allowing more play for the midpoints.
-			if (utilities::greater_than(difference_from_radius, resolution_mm_))
-			{
-				return false;
-			}
-		}
-		
+		arc_circle_ = test_circle;
+		verified_circle_ = verified_circle;
+		verified_deviation_ = verified_deviation;
+		has_verified_circle_ = true;
 	}
 
-	// Check the midpoint of the new point and the final point
-	point point_to_test;
-	if (segment::get_closest_perpendicular_point(points_[points_.count() - 1], p, c.center, point_to_test))
+	// Only set is_shape if it goes from false to true
+	if (!is_shape())
+		set_is_shape(circle_fits_points);
+
+	return circle_fits_points;
+}
+
+bool segmented_arc::does_z_fit_points(point p, double distance)
+{
+	// Firmware moves Z in proportion to the distance travelled around the arc, so the height of every point must be
+	// close to the straight line from the height of the first point to the height of the new point.
+	const double start_z = points_[0].z;
+	const double z_per_mm = (p.z - start_z) / (points_length_.back() + distance);
+	for (int index = 1; index < points_.count(); index++)
 	{
-		distance_from_center = utilities::get_cartesian_distance(point_to_test.x, point_to_test.y, c.center.x, c.center.y);
-		difference_from_radius = abs(distance_from_center - c.radius);
-		// Test allowing more play for the midpoints.
-		if (utilities::greater_than(difference_from_radius, resolution_mm_))
-		{
+		if (utilities::greater_than(fabs(points_[index].z - (start_z + z_per_mm * points_length_[index])), resolution_mm_))
 			return false;
-		}
 	}
-	
-	// get the current arc and compare the total length to the original length
-	arc a;
-	return try_get_arc(c, p, pd, a );
-	/*
-	if (!a.is_arc || utilities::greater_than(abs(a.length - (original_shape_length_ + pd)), resolution_mm_*2))
+	return true;
+}
+
+bool segmented_arc::does_circle_fit_points(circle& c, double& max_deviation)
+{
+	GCODE_PROBE_SCOPE("segmented_arc::does_circle_fit_points");
+	// Point 0 must fit (the fit passes through it).  Check the other points and the segments between them.
+	// Note:  We have not added the current point, the caller checks it and the final segment.
+	return circle_tolerance::does_circle_fit_points(points_x_.data(), points_y_.data(), points_.count(), c.center.x, c.center.y, c.radius, resolution_mm_, max_deviation);
+}
+
+bool segmented_arc::try_get_fitted_circle(point p, circle& c)
+{
+	// The arc is written from points_[0] to p, so firmware expects both of them to be on the circle.  The center is
+	// then on the perpendicular bisector of the chord, at m + t*n, where m is the middle of the chord and n is its unit
+	// normal.  With x and y relative to points_[0], a point is r^2 - (x^2 + y^2) from the circle (algebraically), which
+	// is 2*m.(x,y) + 2*t*n.(x,y) - (x^2 + y^2).  Minimize the sum of the squares over the other points to find t.
+	point origin = points_[0];
+	double chord_x = p.x - origin.x;
+	double chord_y = p.y - origin.y;
+	double chord = sqrt(chord_x * chord_x + chord_y * chord_y);
+	if (chord == 0)
+	{
+		return false;
+	}
+	double m_x = chord_x / 2.0;
+	double m_y = chord_y / 2.0;
+	double n_x = -chord_y / chord;
+	double n_y = chord_x / chord;
+	// The sums of (n.(x,y))^2 and of (n.(x,y)) * (x^2 + y^2 - 2*m.(x,y))
+	double nn = n_x * n_x * fit_xx_ + 2.0 * n_x * n_y * fit_xy_ + n_y * n_y * fit_yy_;
+	double nz = n_x * fit_xz_ + n_y * fit_yz_
+		- 2.0 * (m_x * n_x * fit_xx_ + (m_x * n_y + m_y * n_x) * fit_xy_ + m_y * n_y * fit_yy_);
+	// nn is zero when all of the points are on the chord
+	if (nn <= CIRCLE_FLOATING_POINT_TOLERANCE * (fit_xx_ + fit_yy_))
 	{
-		//std::cout << " failed - final lengths do not match.\n";
 		return false;
 	}
+	double t = nz / (2.0 * nn);
+	double center_x = m_x + t * n_x;
+	double center_y = m_y + t * n_y;
+	c.center.x = origin.x + center_x;
+	c.center.y = origin.y + center_y;
+	c.center.z = origin.z;
+	c.radius = sqrt(center_x * center_x + center_y * center_y);
 	return true;
-	*/
+}
+
+void segmented_arc::add_fit_point(point p)
+{
+	double x = p.x - points_[0].x;
+	double y = p.y - points_[0].y;
+	double z = x * x + y * y;
+	fit_xx_ += x * x;
+	fit_xy_ += x * y;
+	fit_yy_ += y * y;
+	fit_xz_ += x * z;
+	fit_yz_ += y * z;
+}
+
+void segmented_arc::rebuild_fit()
+{
+	fit_xx_ = 0;
+	fit_xy_ = 0;
+	fit_yy_ = 0;
+	fit_xz_ = 0;
+	fit_yz_ = 0;
+	has_verified_circle_ = false;
+	verified_deviation_ = 0;
+	points_x_.clear();
+	points_y_.clear();
+	points_length_.clear();
+	for (int index = 0; index < points_.count(); index++)
+	{
+		points_x_.push_back(points_[index].x);
+		points_y_.push_back(points_[index].y);
+		points_length_.push_back(index == 0 ? 0 : points_length_.back() + utilities::get_cartesian_distance(points_[index - 1].x, points_[index - 1].y, points_[index].x, points_[index].y));
+		// The first point is the origin of the fit, and contributes nothing.
+		if (index > 0)
+			add_fit_point(points_[index]);
+	}
 }
 
 bool segmented_arc::try_get_arc(arc & target_arc)
@@ -284,19 +379,15 @@ bool segmented_arc::try_get_arc(circle& c, point endpoint, double additional_dis
 	int mid_point_index = ((points_.count() - 1) / 2) + 1;
 	return arc::try_create_arc(c, points_[0], points_[mid_point_index], endpoint, original_shape_length_ + additional_distance, resolution_mm_, target_arc);
 }
-/*
-
-std::string segmented_arc::get_shape_gcode_absolute(double f, double e_abs_start)
+std::string segmented_arc::get_shape_gcode_absolute(double f, double e_abs_start, bool xyz_relative)
 {
-
-	s_stream_.clear();
-	s_stream_.str("");
+	GCODE_PROBE_SCOPE("segmented_arc::get_shape_gcode_absolute");
 	arc c;
 	try_get_arc(c);
-	
+
 	double new_extrusion;
 	// get the original ratio of filament extruded to length, but not for retractions
-	if (utilities::greater_than(e_relative_, 0))
+	if (!preserve_extrusion_ && utilities::greater_than(e_relative_, 0))
 	{
 		double extrusion_per_mm = e_relative_ / original_shape_length_;
 		new_extrusion = c.length * extrusion_per_mm;
@@ -305,127 +396,113 @@ std::string segmented_arc::get_shape_gcode_absolute(double f, double e_abs_start
 	{
 		new_extrusion = e_relative_;
 	}
-	
-	
 	double i = c.center.x - c.start_point.x;
 	double j = c.center.y - c.start_point.y;
-	if (utilities::less_than(c.angle_radians, 0))
+	// Format the numbers straight into the command
+	std::string gcode;
+	gcode.reserve(GCODE_CHAR_BUFFER_SIZE);
+	gcode.append(utilities::less_than(c.angle_radians, 0) ? "G2" : "G3");
+	// X and Y are modal, so compact arcs leave out an axis that doesn't move.  I and J are offsets, and always written.
+	if (!compact_output_ || c.end_point.x != c.start_point.x)
 	{
-		s_stream_ << "G2";
+		append_end_point_parameter(gcode, 'X', c.start_point.x, c.end_point.x, xyz_relative);
 	}
-	else
+	if (!compact_output_ || c.end_point.y != c.start_point.y)
 	{
-		s_stream_ << "G3";
+		append_end_point_parameter(gcode, 'Y', c.start_point.y, c.end_point.y, xyz_relative);
 	}
-	s_stream_ << std::setprecision(3);
-	s_stream_ << " X" << c.end_point.x << " Y" << c.end_point.y << " I" << i << " J" << j;
-	// Do not output for travel movements
-	if (e_relative_ != 0)
+	// Z only changes for helical arcs
+	if (c.end_point.z != c.start_point.z)
 	{
-		s_stream_ << std::setprecision(5);
-		s_stream_ << " E" << e_abs_start + new_extrusion;
+		append_end_point_parameter(gcode, 'Z', c.start_point.z, c.end_point.z, xyz_relative);
 	}
-	
-	if (utilities::greater_than(f, 0))
+	center_text_.clear();
+	number_formatter::append_parameter(center_text_, 'I', i, GCODE_COORDINATE_PRECISION, compact_output_);
+	number_formatter::append_parameter(center_text_, 'J', j, GCODE_COORDINATE_PRECISION, compact_output_);
+	if (radius_arcs_ && can_use_radius_form(c, xyz_relative))
 	{
-		s_stream_ << std::setprecision(0) << " F" << f;
+		radius_text_.clear();
+		number_formatter::append_parameter(radius_text_, 'R', c.radius, GCODE_COORDINATE_PRECISION, compact_output_);
+		gcode.append(radius_text_.length() < center_text_.length() ? radius_text_ : center_text_);
 	}
-	return s_stream_.str();
-}*/
-
-std::string segmented_arc::get_shape_gcode_absolute(double f, double e_abs_start)
-{
-	arc c;
-	try_get_arc(c);
-
-	double new_extrusion;
-	// get the original ratio of filament extruded to length, but not for retractions
-	if (utilities::greater_than(e_relative_, 0))
+	else
 	{
-		double extrusion_per_mm = e_relative_ / original_shape_length_;
-		new_extrusion = c.length * extrusion_per_mm;
+		gcode.append(center_text_);
 	}
-	else
+	// Do not output E for travel movements
+	if (e_relative_ != 0)
 	{
-		new_extrusion = e_relative_;
+		number_formatter::append_parameter(gcode, 'E', e_abs_start + new_extrusion, GCODE_E_PRECISION, compact_output_);
 	}
-	double i = c.center.x - c.start_point.x;
-	double j = c.center.y - c.start_point.y;
-	// Here is where the performance part kicks in (these are expensive calls) that makes things a bit ugly.
-	// there are a few cases we need to take into consideration before choosing our sprintf string
-	if (utilities::less_than(c.angle_radians, 0))
+	if (utilities::greater_than_or_equal(f, 1))
 	{
-		// G2
-		if (e_relative_ != 0)
-		{
-			double e = e_abs_start + new_extrusion;
-			// Add E param
-			if (utilities::greater_than_or_equal(f, 1))
-			{
-				// Add F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G2 X%.3f Y%.3f I%.3f J%.3f E%.5f F%.0f", c.end_point.x, c.end_point.y, i, j, e, f);
-			}
-			else
-			{
-				// No F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G2 X%.3f Y%.3f I%.3f J%.3f E%.5f", c.end_point.x, c.end_point.y, i, j, e);
-			}
-		}
-		else
-		{
-			// No E param
-			// Add E param
-			if (utilities::greater_than_or_equal(f, 1))
-			{
-				// Add F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G2 X%.3f Y%.3f I%.3f J%.3f F%.0f", c.end_point.x, c.end_point.y, i, j, f);
-			}
-			else
-			{
-				// No F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G2 X%.3f Y%.3f I%.3f J%.3f", c.end_point.x, c.end_point.y, i, j);
-			}
-		}
+		number_formatter::append_parameter(gcode, 'F', f, GCODE_F_PRECISION, compact_output_);
 	}
-	else
+	return gcode;
+}
+
+void segmented_arc::append_end_point_parameter(std::string& gcode, char name, double start, double end, bool xyz_relative) const
+{
+	if (!xyz_relative)
 	{
-		// G3
-		if (e_relative_ != 0)
-		{
-			double e = e_abs_start + new_extrusion;
-			// Add E param
-			if (utilities::greater_than_or_equal(f, 1))
-			{
-				// Add F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G3 X%.3f Y%.3f I%.3f J%.3f E%.5f F%.0f", c.end_point.x, c.end_point.y, i, j, e, f);
-			}
-			else
-			{
-				// No F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G3 X%.3f Y%.3f I%.3f J%.3f E%.5f", c.end_point.x, c.end_point.y, i, j, e);
-			}
-		}
-		else
-		{
-			// No E param
-			// Add E param
-			if (utilities::greater_than_or_equal(f, 1))
-			{
-				// Add F param
-				snprintf(gcode_buffer_, sizeof(gcode_buffer_), "G3 X%.3f Y%.3f I%.3f J%.3f F%.0f", c.end_point.x, c.end_point.y, i, j, f);
-			}
-			else
-			{
-				// No F param
-				snprintf(gcode_buffer_, GCODE_CHAR_BUFFER_SIZE, "G3 X%.3f Y%.3f I%.3f J%.3f", c.end_point.x, c.end_point.y, i, j);
-			}
-		}
+		number_formatter::append_parameter(gcode, name, end, GCODE_COORDINATE_PRECISION, compact_output_);
+		return;
 	}
-	return std::string(gcode_buffer_);
+	// Every following relative move starts where the arc ends, so a rounded offset would shift the rest of the path.
+	const double offset = end - start;
+	number_formatter::append_parameter(gcode, name, offset, get_relative_offset_precision(offset), compact_output_);
+}
+
+double segmented_arc::get_written_end_point(double start, double end, bool xyz_relative)
+{
+	if (!xyz_relative)
+		return get_written_value(end, GCODE_COORDINATE_PRECISION);
+	const double offset = end - start;
+	return start + get_written_value(offset, get_relative_offset_precision(offset));
+}
 
+int segmented_arc::get_relative_offset_precision(double offset)
+{
+	// Offsets of segments with the usual number of places are written exactly as before, and anything finer gets
+	// the places it needs.  The largest precision is always within the tolerance.
+	int precision = GCODE_COORDINATE_PRECISION;
+	while (precision < NUMBER_FORMATTER_MAX_PRECISION && fabs(get_written_value(offset, precision) - offset) > ARC_RELATIVE_OFFSET_TOLERANCE)
+	{
+		precision++;
+	}
+	return precision;
+}
+
+bool segmented_arc::can_use_radius_form(const arc& c, bool xyz_relative) const
+{
+	if (fabs(c.angle_radians) >= ARC_RADIUS_FORM_MAX_ANGLE_RADIANS)
+		return false;
+	// Find the center the way firmware does, from the start point, the end point as written and the radius as written.
+	// A positive R is the short way around, bending to the left of the chord for G3 and to the right for G2.
+	const double radius = get_written_value(c.radius, GCODE_COORDINATE_PRECISION);
+	const double dx = get_written_end_point(c.start_point.x, c.end_point.x, xyz_relative) - c.start_point.x;
+	const double dy = get_written_end_point(c.start_point.y, c.end_point.y, xyz_relative) - c.start_point.y;
+	const double chord = sqrt(dx * dx + dy * dy);
+	const double center_distance_squared = radius * radius - chord * chord / 4.0;
+	if (chord == 0 || center_distance_squared <= 0)
+		return false;
+	const double direction = c.angle_radians < 0 ? -1.0 : 1.0;
+	const double center_distance = direction * sqrt(center_distance_squared);
+	const double center_x = c.start_point.x + dx / 2.0 - center_distance * dy / chord;
+	const double center_y = c.start_point.y + dy / 2.0 + center_distance * dx / chord;
+	// No point on the reconstructed path is further than this from the fitted arc
+	const double deviation = utilities::get_cartesian_distance(center_x, center_y, c.center.x, c.center.y) + fabs(radius - c.radius);
+	return deviation <= resolution_mm_;
+}
+
+double segmented_arc::get_written_value(double value, int precision)
+{
+	char buffer[NUMBER_FORMATTER_MAX_LENGTH];
+	number_formatter::format_fixed(buffer, value, precision);
+	return atof(buffer);
 }
 
-std::string segmented_arc::get_shape_gcode_relative(double f)
+std::string segmented_arc::get_shape_gcode_relative(double f, bool xyz_relative)
 {
-	return get_shape_gcode_absolute(f, 0.0);
+	return get_shape_gcode_absolute(f, 0.0, xyz_relative);
 }
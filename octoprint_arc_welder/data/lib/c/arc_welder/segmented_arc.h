@@ -25,10 +25,16 @@
 
 #pragma once
 #include "segmented_shape.h"
-#include <iomanip>
-#include <sstream>
+#include <vector>
 
+// The capacity reserved for an arc command, which is enough for any reasonable coordinates
 #define GCODE_CHAR_BUFFER_SIZE 100
+// Radius (R) arcs are only written when they sweep less than this (150 degrees).  Close to 180 degrees, a tiny
+// change in R moves the center a long way, and firmware may not be able to find a center at all.
+#define ARC_RADIUS_FORM_MAX_ANGLE_RADIANS 2.61799387799
+// The end point offset of a relative (G91) arc is written with as many places as it takes to be this close to the
+// offset of the segments it replaces, so the following relative moves don't drift.
+#define ARC_RELATIVE_OFFSET_TOLERANCE 0.000000001
 class segmented_arc :
 	public segmented_shape
 {
@@ -37,22 +43,63 @@ public:
 	segmented_arc(int max_segments, double resolution_mm);
 	virtual ~segmented_arc();
 	virtual bool try_add_point(point p, double e_relative);
-	virtual std::string get_shape_gcode_absolute(double f, double e_abs_start);
-	virtual std::string get_shape_gcode_relative(double f);
+	// xyz_relative writes the end point as an offset from the start point, for arcs in G91 mode.
+	virtual std::string get_shape_gcode_absolute(double f, double e_abs_start, bool xyz_relative);
+	virtual std::string get_shape_gcode_relative(double f, bool xyz_relative);
 	virtual bool is_shape();
 	point pop_front(double e_relative);
 	point pop_back(double e_relative);
 	bool try_get_arc(arc & target_arc);
-	// static gcode buffer
-	
+	virtual void clear();
+	// When set, an arc extrudes exactly as much as the segments it replaces, instead of the same amount per mm.
+	void set_preserve_extrusion(bool preserve_extrusion);
+	// When set, arcs are written without spaces, with the shortest numbers, and without an X or Y that doesn't change.
+	void set_compact_output(bool compact_output);
+	// When set, an arc is written with R instead of I and J if that is shorter, and the firmware would reconstruct
+	// a path within the resolution from the rounded values.
+	void set_radius_arcs(bool radius_arcs);
+	// When set, the points of an arc may change height, as long as Z changes steadily along the path.  The arc is then
+	// written with a Z, which firmware moves linearly as the arc is drawn (a helix).
+	void set_helical_arcs(bool helical_arcs);
+
 private:
-	char gcode_buffer_[GCODE_CHAR_BUFFER_SIZE];
 	bool try_add_point_internal(point p, double pd);
-	bool does_circle_fit_points(circle c, point p, double additional_distance);
+	bool does_circle_fit_points(circle& c, double& max_deviation);
+	// Least squares (Kasa) circle fit.  The fit is constrained to pass through points_[0] and the new end point,
+	// and the sums are kept relative to points_[0] so each new point updates them in O(1).
+	bool try_get_fitted_circle(point p, circle& c);
+	void add_fit_point(point p);
+	void rebuild_fit();
+	double fit_xx_;
+	double fit_xy_;
+	double fit_yy_;
+	double fit_xz_;
+	double fit_yz_;
+	// A structure of arrays copy of points_ for the tolerance kernels
+	std::vector<double> points_x_;
+	std::vector<double> points_y_;
+	// The XY distance along the path from the first point to each point
+	std::vector<double> points_length_;
+	// The last circle that every point was fully checked against, and the largest distance
+	// of any point or segment from that circle.
+	circle verified_circle_;
+	double verified_deviation_;
+	bool has_verified_circle_;
 	bool try_get_arc(circle& c, point endpoint, double additional_distance, arc & target_arc);
+	bool can_use_radius_form(const arc& c, bool xyz_relative) const;
+	void append_end_point_parameter(std::string& gcode, char name, double start, double end, bool xyz_relative) const;
+	static double get_written_end_point(double start, double end, bool xyz_relative);
+	static int get_relative_offset_precision(double offset);
+	bool does_z_fit_points(point p, double distance);
+	static double get_written_value(double value, int precision);
 	int min_segments_;
+	bool preserve_extrusion_;
+	bool compact_output_;
+	bool radius_arcs_;
+	bool helical_arcs_;
+	// The center (I and J) and radius (R) forms of the arc being written, kept to reuse their storage
+	std::string center_text_;
+	std::string radius_text_;
 	circle arc_circle_;
-	int test_count_ = 0;
-	std::ostringstream s_stream_;
 };
 
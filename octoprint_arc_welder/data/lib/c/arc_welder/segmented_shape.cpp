@@ -76,24 +76,26 @@ point point::get_midpoint(point p1, point p2)
 #pragma endregion Point Functions
 
 #pragma region Segment Functions
-bool segment::get_closest_perpendicular_point(point c, point &d)
+bool segment::get_closest_perpendicular_point(const point& c, point &d)
 {
 	return segment::get_closest_perpendicular_point(p1, p2, c, d);
 }
 
-bool segment::get_closest_perpendicular_point(point p1, point p2, point c, point& d)
+bool segment::get_closest_perpendicular_point(const point& p1, const point& p2, const point& c, point& d)
 {
 	// [(Cx - Ax)(Bx - Ax) + (Cy - Ay)(By - Ay)] / [(Bx - Ax) ^ 2 + (By - Ay) ^ 2]
-	double num = (c.x - p1.x)*(p2.x - p1.x) + (c.y - p1.y)*(p2.y - p1.y);
-	double denom = (pow((p2.x - p1.x), 2) + pow((p2.y - p1.y), 2));
+	double dx = p2.x - p1.x;
+	double dy = p2.y - p1.y;
+	double num = (c.x - p1.x) * dx + (c.y - p1.y) * dy;
+	double denom = dx * dx + dy * dy;
 	double t = num / denom;
 
 	// We're considering this a failure if t == 0 or t==1 within our tolerance.  In that case we hit the endpoint, which is OK.
 	if (utilities::less_than_or_equal(t, 0, CIRCLE_FLOATING_POINT_TOLERANCE) || utilities::greater_than_or_equal(t, 1, CIRCLE_FLOATING_POINT_TOLERANCE))
 		return false;
 
-	d.x = p1.x + t * (p2.x - p1.x);
-	d.y = p1.y + t * (p2.y - p1.y);
+	d.x = p1.x + t * dx;
+	d.y = p1.y + t * dy;
 
 	return true;
 }
@@ -198,12 +200,14 @@ double circle::get_radians(point p1, point p2)
 
 point circle::get_closest_point(point p)
 {
-	vector v = p - center;
-	double mag = v.get_magnitude();
-	double px = center.x + v.x / mag * radius;
-	double py = center.y + v.y / mag * radius;
-	double pz = center.z + v.z / mag * radius;
-	return point(px, py, pz, 0);
+	// The circle is in the XY plane, so project onto it and keep the height of the point.  Helical arcs
+	// have points above or below the center, and a 3D projection would pull them off the circle.
+	double vx = p.x - center.x;
+	double vy = p.y - center.y;
+	double mag = sqrt(vx * vx + vy * vy);
+	double px = center.x + vx / mag * radius;
+	double py = center.y + vy / mag * radius;
+	return point(px, py, p.z, 0);
 }
 #pragma endregion Circle Functions
 
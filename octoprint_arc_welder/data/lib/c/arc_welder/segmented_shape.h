@@ -77,8 +77,8 @@ struct segment
 	point p1;
 	point p2;
 
-	bool get_closest_perpendicular_point(point c, point& d);
-	static bool get_closest_perpendicular_point(point p1, point p2, point c, point& d);
+	bool get_closest_perpendicular_point(const point& c, point& d);
+	static bool get_closest_perpendicular_point(const point& p1, const point& p2, const point& c, point& d);
 };
 
 struct vector : point
@@ -0,0 +1,142 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "stage_timer.h"
+#include "utilities.h"
+
+// The number of clock reads used to measure their cost
+#define STAGE_TIMER_CALIBRATION_MARKS 256
+
+stage_timer::stage_timer() : stage_timer(1)
+{
+}
+
+stage_timer::stage_timer(int sample_interval)
+{
+	sample_interval_ = sample_interval > 0 ? sample_interval : 1;
+	num_units_ = 0;
+	num_sampled_units_ = 0;
+	units_until_sample_ = 1;
+	is_sampling_ = false;
+	current_stage_ = conversion_stage_none;
+	last_cpu_seconds_ = 0;
+	start_cpu_seconds_ = 0;
+	total_cpu_seconds_ = 0;
+	get_mark_overhead(mark_seconds_, mark_cpu_seconds_);
+	for (int index = 0; index < NUM_CONVERSION_STAGES; index++)
+	{
+		sampled_seconds_[index] = 0;
+		sampled_cpu_seconds_[index] = 0;
+	}
+}
+
+void stage_timer::start()
+{
+	start_cpu_seconds_ = utilities::get_thread_cpu_seconds();
+}
+
+void stage_timer::stop()
+{
+	if (is_sampling_)
+	{
+		end_sample();
+	}
+	total_cpu_seconds_ += utilities::get_thread_cpu_seconds() - start_cpu_seconds_;
+}
+
+void stage_timer::begin_sample()
+{
+	units_until_sample_ = sample_interval_;
+	is_sampling_ = true;
+	num_sampled_units_++;
+	current_stage_ = conversion_stage_none;
+	last_time_ = std::chrono::steady_clock::now();
+	last_cpu_seconds_ = utilities::get_thread_cpu_seconds();
+}
+
+void stage_timer::end_sample()
+{
+	// Most callers already left the last stage of the unit
+	if (current_stage_ != conversion_stage_none)
+	{
+		mark(conversion_stage_none);
+	}
+	is_sampling_ = false;
+}
+
+void stage_timer::mark(conversion_stage stage)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double cpu_seconds = utilities::get_thread_cpu_seconds();
+	if (current_stage_ != conversion_stage_none)
+	{
+		// Take out the cost of reading the clocks, which can be larger than the stage itself
+		double seconds = std::chrono::duration<double>(now - last_time_).count() - mark_seconds_;
+		double stage_cpu_seconds = cpu_seconds - last_cpu_seconds_ - mark_cpu_seconds_;
+		sampled_seconds_[current_stage_] += seconds > 0 ? seconds : 0;
+		sampled_cpu_seconds_[current_stage_] += stage_cpu_seconds > 0 ? stage_cpu_seconds : 0;
+	}
+	current_stage_ = stage;
+	last_time_ = now;
+	last_cpu_seconds_ = cpu_seconds;
+}
+
+void stage_timer::get_mark_overhead(double& seconds, double& cpu_seconds)
+{
+	// Measured once, the first time a timer is created
+	struct mark_overhead
+	{
+		mark_overhead() {
+			std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+			double start_cpu_seconds = utilities::get_thread_cpu_seconds();
+			std::chrono::steady_clock::time_point end_time = start_time;
+			double end_cpu_seconds = start_cpu_seconds;
+			for (int index = 0; index < STAGE_TIMER_CALIBRATION_MARKS; index++)
+			{
+				end_time = std::chrono::steady_clock::now();
+				end_cpu_seconds = utilities::get_thread_cpu_seconds();
+			}
+			seconds = std::chrono::duration<double>(end_time - start_time).count() / STAGE_TIMER_CALIBRATION_MARKS;
+			cpu_seconds = (end_cpu_seconds - start_cpu_seconds) / STAGE_TIMER_CALIBRATION_MARKS;
+		}
+		double seconds;
+		double cpu_seconds;
+	};
+	static const mark_overhead overhead;
+	seconds = overhead.seconds;
+	cpu_seconds = overhead.cpu_seconds;
+}
+
+void stage_timer::add_to(conversion_stage_times& times) const
+{
+	times.total_cpu_seconds += total_cpu_seconds_;
+	if (num_sampled_units_ == 0)
+		return;
+	double scale = static_cast<double>(num_units_) / static_cast<double>(num_sampled_units_);
+	for (int index = 0; index < NUM_CONVERSION_STAGES; index++)
+	{
+		times.seconds[index] += sampled_seconds_[index] * scale;
+		times.cpu_seconds[index] += sampled_cpu_seconds_[index] * scale;
+	}
+}
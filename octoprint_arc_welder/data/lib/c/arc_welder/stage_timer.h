@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <string>
+#include <chrono>
+
+#define NUM_CONVERSION_STAGES 6
+static const std::string conversion_stage_name[NUM_CONVERSION_STAGES] = {
+	"read", "parse", "position", "arc_fit", "format", "write"
+};
+enum conversion_stage
+{
+	conversion_stage_read,
+	conversion_stage_parse,
+	conversion_stage_position,
+	conversion_stage_arc_fit,
+	conversion_stage_format,
+	conversion_stage_write,
+	// Time that belongs to no stage, such as waiting for another thread
+	conversion_stage_none
+};
+
+// The wall and cpu time spent in each stage.  When stages run on several threads, the times are added together.
+struct conversion_stage_times
+{
+	conversion_stage_times() {
+		for (int index = 0; index < NUM_CONVERSION_STAGES; index++)
+		{
+			seconds[index] = 0;
+			cpu_seconds[index] = 0;
+		}
+		total_cpu_seconds = 0;
+	}
+	double seconds[NUM_CONVERSION_STAGES];
+	double cpu_seconds[NUM_CONVERSION_STAGES];
+	// The cpu time of every thread that worked on the conversion
+	double total_cpu_seconds;
+};
+
+// Splits the time of one thread between the conversion stages.  The work is divided into units (a line, a batch
+// or a chunk), and only one in every sample_interval units is timed.  Call start and stop on the thread being timed.
+class stage_timer
+{
+public:
+	stage_timer();
+	stage_timer(int sample_interval);
+	void start();
+	void stop();
+	// Starts the next unit of work, and decides whether it is timed.
+	inline void begin_unit()
+	{
+		num_units_++;
+		if (is_sampling_)
+		{
+			end_sample();
+		}
+		if (--units_until_sample_ == 0)
+		{
+			begin_sample();
+		}
+	}
+	// Everything from here until the next call belongs to the stage.
+	inline void enter(conversion_stage stage)
+	{
+		if (is_sampling_)
+		{
+			mark(stage);
+		}
+	}
+	// Adds the scaled times to the totals.
+	void add_to(conversion_stage_times& times) const;
+private:
+	void mark(conversion_stage stage);
+	void begin_sample();
+	void end_sample();
+	// The time it takes to read both clocks, which is included in every timed interval.
+	static void get_mark_overhead(double& seconds, double& cpu_seconds);
+	int sample_interval_;
+	long long num_units_;
+	long long num_sampled_units_;
+	int units_until_sample_;
+	bool is_sampling_;
+	conversion_stage current_stage_;
+	std::chrono::steady_clock::time_point last_time_;
+	double last_cpu_seconds_;
+	double start_cpu_seconds_;
+	double total_cpu_seconds_;
+	double sampled_seconds_[NUM_CONVERSION_STAGES];
+	double sampled_cpu_seconds_[NUM_CONVERSION_STAGES];
+	double mark_seconds_;
+	double mark_cpu_seconds_;
+};
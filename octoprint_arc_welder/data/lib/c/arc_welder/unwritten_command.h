@@ -36,27 +36,33 @@ struct unwritten_command
 		is_relative = false;
 		command = cmd;
 	}
-	unwritten_command(position* p) {
+	unwritten_command(position* p, const parsed_command& cmd) {
 		e_relative = p->get_current_extruder().e_relative;
 		offset_e = p->get_current_extruder().get_offset_e();
 		is_extruder_relative = p->is_extruder_relative;
-		command = p->command;
+		command = cmd;
 	}
 	bool is_extruder_relative;
 	double e_relative;
 	double offset_e;
 	parsed_command command;
 
-	std::string to_string(bool rewrite, std::string additional_comment)
+	std::string to_string(bool rewrite, bool compact, std::string additional_comment)
 	{
-		command.comment.append(additional_comment);
+		command.append_comment(additional_comment);
 
 		if (rewrite)
 		{
-			return command.rewrite_gcode_string();
+			return command.rewrite_gcode_string(compact);
 		}
 
 		return command.to_string();
 	}
+
+	// True if the command is written exactly as it appears in the source
+	bool is_verbatim(bool rewrite) const
+	{
+		return !rewrite && command.is_verbatim();
+	}
 };
 
@@ -0,0 +1,586 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Console Application
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Converts gcode files without Python.
+//
+// Usage: arc_welder_console [options] <source> [target]
+//        arc_welder_console [options] --batch <list file>
+
+#include "arc_welder_console.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+void console_logger::log(const int logger_type, const int log_level, const std::string& message, bool /* is_exception */)
+{
+	if (!is_log_level_enabled(logger_type, log_level))
+		return;
+	std::string output;
+	create_log_message(logger_type, log_level, message, output);
+	std::cerr << output << "\n";
+}
+
+console_arc_welder::console_arc_welder(std::string source_path, std::string target_path, logger* log, const arc_welder_console_args& args)
+	: arc_welder(source_path, target_path, log, args.resolution_mm, arc_welder::get_args_(args.g90_g91_influences_extruder, args.buffer_size))
+{
+	show_progress_ = args.show_progress;
+	notification_period_seconds = args.notification_period_seconds;
+	set_pipelined(args.pipelined);
+	set_parallel_threads(args.parallel_threads);
+	set_arc_e_mode(args.e_mode);
+	set_compact_output(args.compact_output);
+	set_radius_arcs(args.radius_arcs);
+	set_helical_arcs(args.helical_arcs);
+}
+
+bool console_arc_welder::on_progress_(double percent_complete, double seconds_elapsed, double estimated_seconds_remaining, int gcodes_processed, int lines_processed, int points_compressed, int arcs_created)
+{
+	if (show_progress_)
+	{
+		std::cerr << std::fixed << std::setprecision(2)
+			<< "Progress: " << percent_complete << "% complete in " << seconds_elapsed << " seconds, "
+			<< estimated_seconds_remaining << " seconds remaining.  Gcodes Processed: " << gcodes_processed
+			<< ", Lines Processed: " << lines_processed << ", Points Compressed: " << points_compressed
+			<< ", Arcs Created: " << arcs_created << "\n";
+	}
+	return true;
+}
+
+console_batch_welder::console_batch_welder(logger* log, const arc_welder_console_args& args)
+	: batch_welder(log, args.resolution_mm, arc_welder::get_args_(args.g90_g91_influences_extruder, args.buffer_size))
+{
+	show_progress_ = args.show_progress;
+	source_paths_ = args.source_paths;
+	notification_period_seconds = args.notification_period_seconds;
+	set_num_threads(args.batch_jobs);
+	set_arc_e_mode(args.e_mode);
+	set_compact_output(args.compact_output);
+	set_radius_arcs(args.radius_arcs);
+	set_helical_arcs(args.helical_arcs);
+}
+
+bool console_batch_welder::on_progress_(const batch_file_progress& file_progress, const batch_progress& overall_progress)
+{
+	if (show_progress_)
+	{
+		std::cerr << std::fixed << std::setprecision(2)
+			<< source_paths_[file_progress.file_index] << ": " << file_progress.percent_complete << "% complete.  Batch: "
+			<< overall_progress.files_complete << " of " << overall_progress.files_total << " files, "
+			<< overall_progress.percent_complete << "% complete in " << overall_progress.seconds_elapsed << " seconds, "
+			<< overall_progress.estimated_seconds_remaining << " seconds remaining.  Arcs Created: " << overall_progress.arcs_created << "\n";
+	}
+	return true;
+}
+
+static void print_usage(const char* program)
+{
+	std::cerr
+		<< "Usage: " << program << " [options] <source> [target]\n"
+		<< "       " << program << " [options] --batch <list file>\n"
+		<< "\n"
+		<< "Converts G0/G1 segments into G2/G3 arcs.  Use " << ARC_WELDER_CONSOLE_STDIO_PATH << " as the source to read stdin, and as\n"
+		<< "the target to write stdout.  When reading stdin the target defaults to stdout, otherwise to the source with\n"
+		<< "'.aw' inserted before the extension.  Each line of a batch list is a source path, optionally followed by a\n"
+		<< "tab and a target path.  The files in a batch are converted at the same time, one per thread, and can't use\n"
+		<< "stdin or stdout.  Progress, statistics and log messages are written to stderr.\n"
+		<< "\n"
+		<< "Options:\n"
+		<< "  -r, --resolution-mm <mm>             Maximum deviation from the original path (default "
+		<< ARC_WELDER_CONSOLE_DEFAULT_RESOLUTION_MM << ")\n"
+		<< "  -b, --buffer-size <count>            Position buffer size, which limits the points per arc (default "
+		<< ARC_WELDER_CONSOLE_DEFAULT_BUFFER_SIZE << ")\n"
+		<< "  -g, --g90-g91-influences-extruder    G90/G91 also set the extruder mode\n"
+		<< "  -e, --arc-e-mode <mode>              How absolute E stays in step after an arc: offset rewrites the E of\n"
+		<< "                                       the following moves, g92 adds a G92 E after the arc, and preserve\n"
+		<< "                                       keeps the extrusion of the replaced segments (default offset)\n"
+		<< "  -c, --compact                        Write arcs and rewritten moves without spaces, trailing zeros or\n"
+		<< "                                       leading zeros, and leave out an arc's X or Y when it doesn't change\n"
+		<< "      --radius-arcs                    Write arcs under 150 degrees with R instead of I and J when shorter\n"
+		<< "      --helical-arcs                   Also weld moves that change Z steadily, such as a spiral vase, into\n"
+		<< "                                       arcs with a Z\n"
+		<< "  -p, --pipelined                      Read, parse, weld and write on separate threads, for files of 1MB or\n"
+		<< "                                       more when there is more than one core (not with --batch)\n"
+		<< "  -t, --threads <count>                Weld the layers of a single file on this many threads, with the same\n"
+		<< "                                       limits as --pipelined (not with --batch)\n"
+		<< "  -n, --progress-seconds <seconds>     Seconds between progress updates (default 1)\n"
+		<< "  -q, --quiet                          Don't print progress or statistics\n"
+		<< "  -l, --log-level <level>              VERBOSE, DEBUG, INFO, WARNING, ERROR or CRITICAL (default ERROR)\n"
+		<< "      --batch <list file>              Convert every file in the list\n"
+		<< "  -j, --jobs <count>                   The number of batch files converted at once (default one per core)\n"
+		<< "  -h, --help                           Show this help\n";
+}
+
+static std::string get_default_target_path(const std::string& source_path)
+{
+	if (source_path == ARC_WELDER_CONSOLE_STDIO_PATH)
+	{
+		return ARC_WELDER_CONSOLE_STDIO_PATH;
+	}
+	std::string::size_type separator = source_path.find_last_of("/\\");
+	std::string::size_type extension = source_path.find_last_of('.');
+	if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+	{
+		return source_path + ".aw";
+	}
+	return source_path.substr(0, extension) + ".aw" + source_path.substr(extension);
+}
+
+static bool load_batch_list(const std::string& list_path, arc_welder_console_args& args)
+{
+	std::ifstream list(list_path.c_str());
+	if (!list.is_open())
+	{
+		std::cerr << "Unable to open the batch list " << list_path << ".\n";
+		return false;
+	}
+	std::string line;
+	while (utilities::safe_get_line(list, line))
+	{
+		line = utilities::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+		std::string::size_type tab = line.find('\t');
+		if (tab == std::string::npos)
+		{
+			args.source_paths.push_back(line);
+			args.target_paths.push_back(get_default_target_path(line));
+		}
+		else
+		{
+			args.source_paths.push_back(utilities::trim(line.substr(0, tab)));
+			args.target_paths.push_back(utilities::trim(line.substr(tab + 1)));
+		}
+	}
+	return true;
+}
+
+static bool parse_log_level(const std::string& name, int& log_level)
+{
+	for (int index = 0; index < LOG_LEVEL_COUNT; index++)
+	{
+		if (log_level_names[index] == name)
+		{
+			log_level = index;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Parses the whole of an option's value, printing an error if it isn't a number
+static bool try_parse_int(const std::string& option, const char* text, int& value)
+{
+	char* p_end;
+	errno = 0;
+	long parsed = strtol(text, &p_end, 10);
+	if (p_end == text || *p_end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX)
+	{
+		std::cerr << "Invalid value " << text << " for " << option << ", expected a whole number.\n";
+		return false;
+	}
+	value = static_cast<int>(parsed);
+	return true;
+}
+
+static bool try_parse_double(const std::string& option, const char* text, double& value)
+{
+	char* p_end;
+	errno = 0;
+	double parsed = strtod(text, &p_end);
+	if (p_end == text || *p_end != '\0' || errno == ERANGE)
+	{
+		std::cerr << "Invalid value " << text << " for " << option << ", expected a number.\n";
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+// Returns 0 if the arguments are valid, -1 if help was shown, otherwise the exit code
+static int parse_args(int argc, char* argv[], arc_welder_console_args& args)
+{
+	std::vector<std::string> positional;
+	std::string batch_list_path;
+	for (int index = 1; index < argc; index++)
+	{
+		std::string arg = argv[index];
+		bool has_value = index + 1 < argc;
+		if (arg == "-h" || arg == "--help")
+		{
+			print_usage(argv[0]);
+			return -1;
+		}
+		else if (arg == "-g" || arg == "--g90-g91-influences-extruder")
+		{
+			args.g90_g91_influences_extruder = true;
+		}
+		else if (arg == "-c" || arg == "--compact")
+		{
+			args.compact_output = true;
+		}
+		else if (arg == "--radius-arcs")
+		{
+			args.radius_arcs = true;
+		}
+		else if (arg == "--helical-arcs")
+		{
+			args.helical_arcs = true;
+		}
+		else if (arg == "-p" || arg == "--pipelined")
+		{
+			args.pipelined = true;
+		}
+		else if (arg == "-q" || arg == "--quiet")
+		{
+			args.show_progress = false;
+		}
+		else if ((arg == "-r" || arg == "--resolution-mm") && has_value)
+		{
+			if (!try_parse_double(arg, argv[++index], args.resolution_mm))
+				return 2;
+		}
+		else if ((arg == "-b" || arg == "--buffer-size") && has_value)
+		{
+			if (!try_parse_int(arg, argv[++index], args.buffer_size))
+				return 2;
+		}
+		else if ((arg == "-e" || arg == "--arc-e-mode") && has_value)
+		{
+			if (!arc_welder::try_get_arc_e_mode(argv[++index], args.e_mode))
+			{
+				std::cerr << "Unknown arc E mode " << argv[index] << ".\n";
+				return 2;
+			}
+		}
+		else if ((arg == "-t" || arg == "--threads") && has_value)
+		{
+			if (!try_parse_int(arg, argv[++index], args.parallel_threads))
+				return 2;
+		}
+		else if ((arg == "-n" || arg == "--progress-seconds") && has_value)
+		{
+			if (!try_parse_double(arg, argv[++index], args.notification_period_seconds))
+				return 2;
+		}
+		else if ((arg == "-l" || arg == "--log-level") && has_value)
+		{
+			if (!parse_log_level(argv[++index], args.log_level))
+			{
+				std::cerr << "Unknown log level " << argv[index] << ".\n";
+				return 2;
+			}
+		}
+		else if ((arg == "-j" || arg == "--jobs") && has_value)
+		{
+			if (!try_parse_int(arg, argv[++index], args.batch_jobs))
+				return 2;
+		}
+		else if (arg == "--batch" && has_value)
+		{
+			batch_list_path = argv[++index];
+		}
+		else if (arg.length() > 1 && arg[0] == '-')
+		{
+			std::cerr << "Unknown or incomplete option " << arg << ".\n";
+			print_usage(argv[0]);
+			return 2;
+		}
+		else
+		{
+			positional.push_back(arg);
+		}
+	}
+
+	if (!(args.resolution_mm > 0))
+	{
+		std::cerr << "The resolution must be greater than 0.\n";
+		return 2;
+	}
+	if (args.buffer_size < ARC_WELDER_CONSOLE_MIN_BUFFER_SIZE)
+	{
+		std::cerr << "The buffer size must be at least " << ARC_WELDER_CONSOLE_MIN_BUFFER_SIZE << ".\n";
+		return 2;
+	}
+	if (args.parallel_threads < 0 || args.batch_jobs < 0)
+	{
+		std::cerr << "The number of threads and jobs can't be negative.\n";
+		return 2;
+	}
+	if (!batch_list_path.empty())
+	{
+		if (!positional.empty())
+		{
+			std::cerr << "A batch list can't be combined with a source file.\n";
+			return 2;
+		}
+		// Each batch file is converted on a single thread of the batch's own pool
+		if (args.pipelined || args.parallel_threads > 1)
+		{
+			std::cerr << "A batch list can't be combined with --pipelined or --threads.  Use --jobs instead.\n";
+			return 2;
+		}
+		if (!load_batch_list(batch_list_path, args))
+		{
+			return 1;
+		}
+		for (unsigned int index = 0; index < args.source_paths.size(); index++)
+		{
+			if (args.source_paths[index] == ARC_WELDER_CONSOLE_STDIO_PATH || args.target_paths[index] == ARC_WELDER_CONSOLE_STDIO_PATH)
+			{
+				std::cerr << "A batch list can't read stdin or write stdout.\n";
+				return 2;
+			}
+		}
+		args.is_batch = true;
+	}
+	else if (positional.size() == 1 || positional.size() == 2)
+	{
+		args.source_paths.push_back(positional[0]);
+		args.target_paths.push_back(positional.size() == 2 ? positional[1] : get_default_target_path(positional[0]));
+	}
+	else
+	{
+		print_usage(argv[0]);
+		return 2;
+	}
+	return 0;
+}
+
+// Creates an empty temporary file, since the welder needs a seekable file of known size
+static bool create_temp_file(std::string& path)
+{
+#ifdef _WIN32
+	char directory[MAX_PATH + 1];
+	char file_path[MAX_PATH + 1];
+	DWORD length = GetTempPathA(sizeof(directory), directory);
+	if (length == 0 || length > sizeof(directory) || GetTempFileNameA(directory, "aw", 0, file_path) == 0)
+	{
+		return false;
+	}
+	path = file_path;
+	return true;
+#else
+	const char* directory = getenv("TMPDIR");
+	std::string file_path = std::string(directory != NULL && directory[0] != '\0' ? directory : "/tmp") + "/arc_welder_XXXXXX";
+	std::vector<char> buffer(file_path.begin(), file_path.end());
+	buffer.push_back('\0');
+	int file_descriptor = mkstemp(&buffer[0]);
+	if (file_descriptor == -1)
+	{
+		return false;
+	}
+	close(file_descriptor);
+	path = &buffer[0];
+	return true;
+#endif
+}
+
+static bool copy_stream(FILE* p_source, FILE* p_target)
+{
+	std::vector<char> buffer(ARC_WELDER_CONSOLE_COPY_BUFFER_SIZE);
+	size_t count;
+	while ((count = fread(&buffer[0], 1, buffer.size(), p_source)) > 0)
+	{
+		if (fwrite(&buffer[0], 1, count, p_target) != count)
+		{
+			return false;
+		}
+	}
+	return !ferror(p_source) && fflush(p_target) == 0;
+}
+
+static bool copy_stdin_to_file(const std::string& path)
+{
+	FILE* p_file = fopen(path.c_str(), "wb");
+	if (p_file == NULL)
+	{
+		return false;
+	}
+	bool copied = copy_stream(stdin, p_file);
+	return fclose(p_file) == 0 && copied;
+}
+
+static bool copy_file_to_stdout(const std::string& path)
+{
+	FILE* p_file = fopen(path.c_str(), "rb");
+	if (p_file == NULL)
+	{
+		return false;
+	}
+	bool copied = copy_stream(p_file, stdout);
+	fclose(p_file);
+	return copied;
+}
+
+static void print_results(const std::string& source_path, const std::string& target_path, const arc_welder_results& results)
+{
+	std::cerr << std::fixed << std::setprecision(2)
+		<< "Converted " << source_path << " to " << target_path << " in " << results.seconds_elapsed << " seconds ("
+		<< results.stage_times.total_cpu_seconds << " cpu seconds).\n"
+		<< "  Source Size: " << results.source_file_size << ", Target Size: " << results.target_file_size
+		<< ", Compression Ratio: " << results.compression_ratio << "\n"
+		<< "  Lines Processed: " << results.lines_processed << ", Gcodes Processed: " << results.gcodes_processed
+		<< ", Points Compressed: " << results.points_compressed << ", Arcs Created: " << results.arcs_created << "\n"
+		<< "  Peak Memory: " << results.peak_memory_bytes << " bytes\n"
+		<< std::setprecision(3) << "  Stage Seconds (wall/cpu):";
+	for (int index = 0; index < NUM_CONVERSION_STAGES; index++)
+	{
+		std::cerr << " " << conversion_stage_name[index] << " " << results.stage_times.seconds[index] << "/" << results.stage_times.cpu_seconds[index];
+	}
+	std::cerr << "\n";
+}
+
+static bool convert_file(const std::string& source_path, const std::string& target_path, const arc_welder_console_args& args, console_logger& log)
+{
+	bool is_stdin = source_path == ARC_WELDER_CONSOLE_STDIO_PATH;
+	bool is_stdout = target_path == ARC_WELDER_CONSOLE_STDIO_PATH;
+	std::string welder_source_path = source_path;
+	std::string welder_target_path = target_path;
+	if (is_stdin && !create_temp_file(welder_source_path))
+	{
+		std::cerr << "Unable to create a temporary file for stdin.\n";
+		return false;
+	}
+	if (is_stdout && !create_temp_file(welder_target_path))
+	{
+		std::cerr << "Unable to create a temporary file for stdout.\n";
+		if (is_stdin)
+			std::remove(welder_source_path.c_str());
+		return false;
+	}
+
+	bool success = true;
+	if (is_stdin && !copy_stdin_to_file(welder_source_path))
+	{
+		std::cerr << "Unable to read stdin.\n";
+		success = false;
+	}
+	if (success)
+	{
+		arc_welder_results results;
+		try
+		{
+			console_arc_welder welder(welder_source_path, welder_target_path, &log, args);
+			results = welder.process();
+		}
+		catch (...)
+		{
+			results.success = false;
+		}
+		success = results.success;
+		if (success && is_stdout && !copy_file_to_stdout(welder_target_path))
+		{
+			std::cerr << "Unable to write stdout.\n";
+			success = false;
+		}
+		if (!success)
+		{
+			std::cerr << "Unable to convert " << source_path << ".\n";
+		}
+		else if (args.show_progress)
+		{
+			print_results(is_stdin ? "stdin" : source_path, is_stdout ? "stdout" : target_path, results);
+		}
+	}
+
+	if (is_stdin)
+		std::remove(welder_source_path.c_str());
+	if (is_stdout)
+		std::remove(welder_target_path.c_str());
+	return success;
+}
+
+static int convert_batch(const arc_welder_console_args& args, console_logger& log)
+{
+	std::vector<batch_welder_job> jobs;
+	for (unsigned int index = 0; index < args.source_paths.size(); index++)
+	{
+		jobs.push_back(batch_welder_job(args.source_paths[index], args.target_paths[index]));
+	}
+	console_batch_welder welder(&log, args);
+	std::vector<arc_welder_results> results = welder.process(jobs);
+	int num_failed = 0;
+	for (unsigned int index = 0; index < results.size(); index++)
+	{
+		if (!results[index].success)
+		{
+			std::cerr << "Unable to convert " << args.source_paths[index] << ".  " << results[index].message << "\n";
+			num_failed++;
+		}
+		else if (args.show_progress)
+		{
+			print_results(args.source_paths[index], args.target_paths[index], results[index]);
+		}
+	}
+	if (args.show_progress)
+	{
+		std::cerr << "Converted " << (results.size() - num_failed) << " of " << results.size() << " files.\n";
+	}
+	return num_failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	arc_welder_console_args args;
+	int exit_code = parse_args(argc, argv, args);
+	if (exit_code != 0)
+	{
+		return exit_code < 0 ? 0 : exit_code;
+	}
+#ifdef _WIN32
+	// Gcode must pass through the standard streams unchanged
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	std::vector<std::string> logger_names;
+	logger_names.push_back("arc_welder.gcode_conversion");
+	std::vector<int> logger_levels;
+	logger_levels.push_back(args.log_level);
+	console_logger log(logger_names, logger_levels);
+	log.set_log_level(args.log_level);
+
+	if (args.is_batch)
+	{
+		return convert_batch(args, log);
+	}
+	return convert_file(args.source_paths[0], args.target_paths[0], args, log) ? 0 : 1;
+}
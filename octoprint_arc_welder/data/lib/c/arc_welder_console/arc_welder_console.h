@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Console Application
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "arc_welder.h"
+#include "batch_welder.h"
+#include "logger.h"
+#include <string>
+#include <vector>
+
+#define ARC_WELDER_CONSOLE_DEFAULT_RESOLUTION_MM 0.05
+#define ARC_WELDER_CONSOLE_DEFAULT_BUFFER_SIZE 50
+// The welder keeps buffer_size - 5 points in an arc, and needs at least 3
+#define ARC_WELDER_CONSOLE_MIN_BUFFER_SIZE 8
+// The size of the blocks copied between stdin/stdout and the temporary files
+#define ARC_WELDER_CONSOLE_COPY_BUFFER_SIZE 1048576
+// Passed as a source or target path to read stdin or write stdout
+#define ARC_WELDER_CONSOLE_STDIO_PATH "-"
+
+struct arc_welder_console_args
+{
+	arc_welder_console_args() {
+		resolution_mm = ARC_WELDER_CONSOLE_DEFAULT_RESOLUTION_MM;
+		buffer_size = ARC_WELDER_CONSOLE_DEFAULT_BUFFER_SIZE;
+		g90_g91_influences_extruder = false;
+		e_mode = arc_e_mode_offset;
+		compact_output = false;
+		radius_arcs = false;
+		helical_arcs = false;
+		pipelined = false;
+		parallel_threads = 0;
+		batch_jobs = 0;
+		is_batch = false;
+		show_progress = true;
+		notification_period_seconds = 1;
+		log_level = ERROR;
+	}
+	double resolution_mm;
+	int buffer_size;
+	bool g90_g91_influences_extruder;
+	arc_e_mode e_mode;
+	bool compact_output;
+	bool radius_arcs;
+	bool helical_arcs;
+	bool pipelined;
+	int parallel_threads;
+	// The number of batch files converted at once, or 0 for one per core
+	int batch_jobs;
+	bool is_batch;
+	bool show_progress;
+	double notification_period_seconds;
+	int log_level;
+	// Pairs of source and target paths
+	std::vector<std::string> source_paths;
+	std::vector<std::string> target_paths;
+};
+
+// Writes every message to stderr, so that stdout only ever contains gcode
+class console_logger : public logger
+{
+public:
+	console_logger(std::vector<std::string> names, std::vector<int> levels) : logger(names, levels)
+	{
+	}
+	using logger::log;
+	virtual void log(const int logger_type, const int log_level, const std::string& message, bool is_exception);
+};
+
+// Prints each progress update to stderr
+class console_arc_welder : public arc_welder
+{
+public:
+	console_arc_welder(std::string source_path, std::string target_path, logger* log, const arc_welder_console_args& args);
+	virtual ~console_arc_welder() {
+	}
+protected:
+	virtual bool on_progress_(double percent_complete, double seconds_elapsed, double estimated_seconds_remaining, int gcodes_processed, int lines_processed, int points_compressed, int arcs_created);
+private:
+	bool show_progress_;
+};
+
+// Prints the progress of each file, and of the whole batch, to stderr
+class console_batch_welder : public batch_welder
+{
+public:
+	console_batch_welder(logger* log, const arc_welder_console_args& args);
+	virtual ~console_batch_welder() {
+	}
+protected:
+	virtual bool on_progress_(const batch_file_progress& file_progress, const batch_progress& overall_progress);
+private:
+	bool show_progress_;
+	std::vector<std::string> source_paths_;
+};
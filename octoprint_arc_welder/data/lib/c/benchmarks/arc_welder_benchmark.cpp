@@ -0,0 +1,602 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Measures the parser, position tracking, arc fitting and a full conversion on synthetic gcode.  Every scenario is
+// generated from a fixed seed, so the input is identical from run to run and machine to machine.  Reports lines/sec,
+// MB/sec and arcs/sec for each scenario, using the fastest of the iterations.  The full conversion is also run
+// pipelined and on 2 and 4 threads, with the wall clock speedup over the serial conversion and the CPU time used.  The threaded conversions
+// are always run, even on one core, and must give the same output as the serial conversion.
+//
+// Usage: arc_welder_benchmark [lines per scenario] [iterations] [work directory] [scenario]
+
+#include "arc_welder.h"
+#include "gcode_parser.h"
+#include "gcode_position.h"
+#include "segmented_arc.h"
+#include "logger.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define BENCHMARK_DEFAULT_LINES 100000
+#define BENCHMARK_DEFAULT_ITERATIONS 3
+#define BENCHMARK_RESOLUTION_MM 0.05
+#define BENCHMARK_BUFFER_SIZE 50
+#define BENCHMARK_SEED 20200801
+
+// xorshift64*, so that the corpus doesn't depend on the standard library's distributions
+class benchmark_random
+{
+public:
+	benchmark_random(unsigned long long seed)
+	{
+		state_ = seed != 0 ? seed : 1;
+	}
+	unsigned long long next()
+	{
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return state_ * 2685821657736338717ULL;
+	}
+	// A value in [min, max)
+	double next_double(double min, double max)
+	{
+		return min + (max - min) * (static_cast<double>(next() >> 11) / 9007199254740992.0);
+	}
+	int next_int(int min, int max)
+	{
+		return min + static_cast<int>(next() % static_cast<unsigned long long>(max - min + 1));
+	}
+private:
+	unsigned long long state_;
+};
+
+// Builds the gcode for a scenario, tracking the absolute extruder position.
+class corpus_writer
+{
+public:
+	corpus_writer(std::string& text) : text_(text)
+	{
+		e_ = 0;
+		num_lines_ = 0;
+	}
+	void line(const char* gcode)
+	{
+		text_.append(gcode);
+		text_.push_back('\n');
+		num_lines_++;
+	}
+	void move(double x, double y, double f)
+	{
+		char buffer[96];
+		snprintf(buffer, sizeof(buffer), "G0 X%.3f Y%.3f F%.0f", x, y, f);
+		line(buffer);
+	}
+	void extrude(double x, double y, double length)
+	{
+		char buffer[96];
+		e_ += length * 0.0333;
+		snprintf(buffer, sizeof(buffer), "G1 X%.3f Y%.3f E%.5f", x, y, e_);
+		line(buffer);
+	}
+	void extrude_z(double x, double y, double z, double length)
+	{
+		char buffer[96];
+		e_ += length * 0.0333;
+		snprintf(buffer, sizeof(buffer), "G1 X%.3f Y%.3f Z%.4f E%.5f", x, y, z, e_);
+		line(buffer);
+	}
+	void layer(int index, double z)
+	{
+		char buffer[96];
+		snprintf(buffer, sizeof(buffer), ";LAYER:%d", index);
+		line(buffer);
+		snprintf(buffer, sizeof(buffer), "G1 Z%.3f F7800", z);
+		line(buffer);
+	}
+	void start()
+	{
+		line("; generated by arc_welder_benchmark");
+		line("M82");
+		line("G90");
+		line("G28");
+		line("G92 E0");
+		line("G1 F1800");
+	}
+	int num_lines() const
+	{
+		return num_lines_;
+	}
+private:
+	std::string& text_;
+	double e_;
+	int num_lines_;
+};
+
+typedef void(*corpus_generator)(corpus_writer& writer, benchmark_random& random, int num_lines);
+
+// Circles and holes exported with a very fine tolerance, about 0.3mm per segment
+static void generate_circles(corpus_writer& writer, benchmark_random& random, int num_lines)
+{
+	for (int layer = 0; writer.num_lines() < num_lines; layer++)
+	{
+		writer.layer(layer, 0.2 + layer * 0.2);
+		for (int circle = 0; circle < 8 && writer.num_lines() < num_lines; circle++)
+		{
+			double cx = random.next_double(60, 140);
+			double cy = random.next_double(60, 140);
+			double r = random.next_double(2, 40);
+			int segments = static_cast<int>(2 * PI_DOUBLE * r / 0.3);
+			if (segments < 16)
+				segments = 16;
+			double direction = random.next_int(0, 1) == 0 ? 1.0 : -1.0;
+			double segment_length = 2 * PI_DOUBLE * r / segments;
+			writer.move(cx + r, cy, 9000);
+			writer.line(";TYPE:External perimeter");
+			for (int index = 1; index <= segments; index++)
+			{
+				double angle = direction * 2 * PI_DOUBLE * index / segments;
+				writer.extrude(cx + r * cos(angle), cy + r * sin(angle), segment_length);
+			}
+		}
+	}
+}
+
+// Vase mode.  Z rises with every segment, so nothing here can be welded, but it all has to be tracked.
+static void generate_spiral(corpus_writer& writer, benchmark_random& random, int num_lines)
+{
+	const int segments_per_turn = 240;
+	const double layer_height = 0.2;
+	writer.layer(0, layer_height);
+	double z = layer_height;
+	for (int turn = 0; writer.num_lines() < num_lines; turn++)
+	{
+		// The radius wanders slowly, like the wall of a vase
+		double r = 30 + 10 * sin(turn * 0.05) + random.next_double(-0.02, 0.02);
+		double segment_length = 2 * PI_DOUBLE * r / segments_per_turn;
+		for (int index = 1; index <= segments_per_turn; index++)
+		{
+			double angle = 2 * PI_DOUBLE * index / segments_per_turn;
+			z += layer_height / segments_per_turn;
+			writer.extrude_z(100 + r * cos(angle), 100 + r * sin(angle), z, segment_length);
+		}
+	}
+}
+
+// Rounded rectangles whose points jitter by a few microns, as they do after slicing a mesh
+static void generate_noisy_perimeters(corpus_writer& writer, benchmark_random& random, int num_lines)
+{
+	const int corner_segments = 24;
+	for (int layer = 0; writer.num_lines() < num_lines; layer++)
+	{
+		writer.layer(layer, 0.2 + layer * 0.2);
+		for (int perimeter = 0; perimeter < 4; perimeter++)
+		{
+			double inset = perimeter * 0.45;
+			double half_width = 30 - inset;
+			double half_height = 20 - inset;
+			double r = 8 - inset;
+			writer.line(";TYPE:Perimeter");
+			writer.move(100 + half_width, 100, 9000);
+			// The four corners, each joined to the next by a straight side
+			for (int corner = 0; corner < 4; corner++)
+			{
+				double cx = 100 + (corner == 0 || corner == 3 ? half_width - r : -(half_width - r));
+				double cy = 100 + (corner < 2 ? half_height - r : -(half_height - r));
+				for (int index = 0; index <= corner_segments; index++)
+				{
+					double angle = (corner + static_cast<double>(index) / corner_segments) * PI_DOUBLE / 2;
+					double x = cx + r * cos(angle) + random.next_double(-0.004, 0.004);
+					double y = cy + r * sin(angle) + random.next_double(-0.004, 0.004);
+					writer.extrude(x, y, r * PI_DOUBLE / 2 / corner_segments);
+				}
+			}
+		}
+	}
+}
+
+// Rectilinear infill, which has no curves at all
+static void generate_infill(corpus_writer& writer, benchmark_random& random, int num_lines)
+{
+	const double spacing = 0.45;
+	for (int layer = 0; writer.num_lines() < num_lines; layer++)
+	{
+		writer.layer(layer, 0.2 + layer * 0.2);
+		writer.line(";TYPE:Solid infill");
+		writer.move(60, 60, 9000);
+		double y = 60;
+		for (int index = 0; index < 180 && writer.num_lines() < num_lines; index++)
+		{
+			double length = 80 + random.next_double(-0.5, 0.5);
+			double x = index % 2 == 0 ? 60 + length : 60;
+			writer.extrude(x, y, length);
+			y += spacing;
+			writer.extrude(x, y, spacing);
+		}
+	}
+}
+
+// Slicer headers and footers are mostly long setting comments
+static void generate_comment_heavy(corpus_writer& writer, benchmark_random& random, int num_lines)
+{
+	char buffer[256];
+	for (int block = 0; writer.num_lines() < num_lines; block++)
+	{
+		for (int index = 0; index < 200; index++)
+		{
+			int value_length = random.next_int(1, 120);
+			std::string value;
+			for (int c = 0; c < value_length; c++)
+			{
+				value.push_back(static_cast<char>('a' + random.next_int(0, 25)));
+			}
+			snprintf(buffer, sizeof(buffer), "; setting_%d_%d = %s", block, index, value.c_str());
+			writer.line(buffer);
+		}
+		writer.line("M104 S215 ; set temperature");
+		writer.line("M140 S60 ; set bed temperature");
+		// A few straight moves between the blocks
+		writer.move(50, 50, 9000);
+		for (int index = 1; index <= 20; index++)
+		{
+			writer.extrude(50 + (index % 2) * 100, 50 + index * 0.45 + random.next_double(-0.01, 0.01), 100);
+		}
+	}
+}
+
+struct benchmark_scenario
+{
+	const char* name;
+	corpus_generator generator;
+};
+
+static const benchmark_scenario benchmark_scenarios[] = {
+	{ "circles", generate_circles },
+	{ "spiral", generate_spiral },
+	{ "noisy_perimeters", generate_noisy_perimeters },
+	{ "infill", generate_infill },
+	{ "comment_heavy", generate_comment_heavy }
+};
+
+// The points a welder would try to join, and where the runs of candidate points are broken
+struct arc_candidate
+{
+	point p;
+	double e_relative;
+	bool starts_run;
+};
+
+static double get_seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void split_lines(const std::string& text, std::vector<const char*>& lines)
+{
+	const char* p = text.c_str();
+	const char* end = p + text.length();
+	while (p < end)
+	{
+		lines.push_back(p);
+		while (p < end && *p != '\n')
+			p++;
+		p++;
+	}
+}
+
+static double benchmark_parser(const std::vector<const char*>& lines, int iterations)
+{
+	gcode_parser parser;
+	parsed_command cmd;
+	double best_seconds = 0;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int index = 0; index < lines.size(); index++)
+		{
+			cmd.clear();
+			parser.try_parse_gcode(lines[index], cmd);
+		}
+		double seconds = get_seconds_since(start);
+		if (iteration == 0 || seconds < best_seconds)
+			best_seconds = seconds;
+	}
+	return best_seconds;
+}
+
+static double benchmark_position(const std::vector<parsed_command>& commands, int iterations)
+{
+	double best_seconds = 0;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		gcode_position source_position(arc_welder::get_args_(false, BENCHMARK_BUFFER_SIZE));
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int index = 0; index < commands.size(); index++)
+		{
+			parsed_command cmd = commands[index];
+			source_position.update(cmd, index + 1, index + 1, -1);
+		}
+		double seconds = get_seconds_since(start);
+		if (iteration == 0 || seconds < best_seconds)
+			best_seconds = seconds;
+	}
+	return best_seconds;
+}
+
+static void get_arc_candidates(const std::vector<parsed_command>& commands, std::vector<arc_candidate>& candidates)
+{
+	gcode_position source_position(arc_welder::get_args_(false, BENCHMARK_BUFFER_SIZE));
+	bool starts_run = true;
+	for (unsigned int index = 0; index < commands.size(); index++)
+	{
+		parsed_command cmd = commands[index];
+		source_position.update(cmd, index + 1, index + 1, -1);
+		position* p_cur_pos = source_position.get_current_position_ptr();
+		position* p_pre_pos = source_position.get_previous_position_ptr();
+		const extruder& current_extruder = p_cur_pos->get_current_extruder();
+		if (
+			cmd.is_known_command && !cmd.is_empty && cmd.id == command_id_g1 &&
+			current_extruder.is_extruding && !p_cur_pos->is_relative &&
+			p_cur_pos->z == p_pre_pos->z
+		)
+		{
+			arc_candidate candidate;
+			candidate.p = point(p_cur_pos->x, p_cur_pos->y, p_cur_pos->z, current_extruder.e_relative);
+			candidate.e_relative = current_extruder.e_relative;
+			candidate.starts_run = starts_run;
+			candidates.push_back(candidate);
+			starts_run = false;
+		}
+		else if (cmd.has_gcode())
+		{
+			starts_run = true;
+		}
+	}
+}
+
+// Joins the candidate points into arcs as the welder does, generating the gcode for each.  Returns the arc count.
+static int weld_candidates(const std::vector<arc_candidate>& candidates, size_t& gcode_length)
+{
+	segmented_arc arc(BENCHMARK_BUFFER_SIZE - 5, BENCHMARK_RESOLUTION_MM);
+	int arcs = 0;
+	for (unsigned int index = 0; index < candidates.size(); index++)
+	{
+		const arc_candidate& candidate = candidates[index];
+		if (!candidate.starts_run && arc.try_add_point(candidate.p, candidate.e_relative))
+			continue;
+		if (arc.is_shape())
+		{
+			gcode_length += arc.get_shape_gcode_absolute(0, 0, false).length();
+			arcs++;
+		}
+		arc.clear();
+		arc.try_add_point(candidate.p, candidate.e_relative);
+	}
+	if (arc.is_shape())
+	{
+		gcode_length += arc.get_shape_gcode_absolute(0, 0, false).length();
+		arcs++;
+	}
+	return arcs;
+}
+
+static double benchmark_segmented_arc(const std::vector<arc_candidate>& candidates, int iterations, int& arcs)
+{
+	double best_seconds = 0;
+	size_t gcode_length = 0;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		arcs = weld_candidates(candidates, gcode_length);
+		double seconds = get_seconds_since(start);
+		if (iteration == 0 || seconds < best_seconds)
+			best_seconds = seconds;
+	}
+	return best_seconds;
+}
+
+// How a full conversion is run.  The first mode is the serial conversion that the others are compared to.
+struct process_mode
+{
+	const char* name;
+	bool pipelined;
+	int parallel_threads;
+};
+
+static const process_mode process_modes[] = {
+	{ "process", false, 0 },
+	{ "pipelined", true, 0 },
+	{ "threads 2", false, 2 },
+	{ "threads 4", false, 4 }
+};
+
+static double benchmark_process(const std::string& source_path, const std::string& target_path, logger& log, const process_mode& mode, int iterations, arc_welder_results& results)
+{
+	double best_seconds = 0;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		arc_welder welder(source_path, target_path, &log, BENCHMARK_RESOLUTION_MM, false, BENCHMARK_BUFFER_SIZE);
+		welder.set_pipelined(mode.pipelined);
+		welder.set_parallel_threads(mode.parallel_threads);
+		welder.set_threaded_min_file_size(0);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		results = welder.process();
+		double seconds = get_seconds_since(start);
+		if (iteration == 0 || seconds < best_seconds)
+			best_seconds = seconds;
+	}
+	return best_seconds;
+}
+
+static bool read_file(const std::string& path, std::string& text)
+{
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+	text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+// Pass a negative byte or arc count to leave that rate out
+static void print_result(const char* benchmark, double seconds, double count, const char* count_name, double bytes, double arcs)
+{
+	std::cout << "  " << std::left << std::setw(16) << benchmark << std::right << std::fixed << std::setprecision(0)
+		<< std::setw(14) << (count / seconds) << " " << std::left << std::setw(8) << count_name << std::right;
+	if (bytes >= 0)
+		std::cout << std::setprecision(2) << std::setw(10) << (bytes / seconds / 1048576.0) << " MB/s";
+	else
+		std::cout << std::setw(15) << "";
+	if (arcs >= 0)
+		std::cout << std::setprecision(0) << std::setw(12) << (arcs / seconds) << " arcs/s";
+	std::cout << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+	int num_lines = argc > 1 ? atoi(argv[1]) : BENCHMARK_DEFAULT_LINES;
+	if (num_lines < 1)
+		num_lines = BENCHMARK_DEFAULT_LINES;
+	int iterations = argc > 2 ? atoi(argv[2]) : BENCHMARK_DEFAULT_ITERATIONS;
+	if (iterations < 1)
+		iterations = 1;
+	std::string work_directory = argc > 3 ? argv[3] : ".";
+	std::string scenario_filter = argc > 4 ? argv[4] : "";
+
+	std::vector<std::string> logger_names;
+	logger_names.push_back("arc_welder.gcode_conversion");
+	std::vector<int> logger_levels;
+	logger_levels.push_back(ERROR);
+	logger log(logger_names, logger_levels);
+	log.set_log_level(ERROR);
+
+	std::cout << "Lines per scenario: " << num_lines << ", Iterations: " << iterations << ", Resolution: " << BENCHMARK_RESOLUTION_MM << "mm\n";
+	bool found_scenario = false;
+	for (unsigned int scenario_index = 0; scenario_index < sizeof(benchmark_scenarios) / sizeof(benchmark_scenarios[0]); scenario_index++)
+	{
+		const benchmark_scenario& scenario = benchmark_scenarios[scenario_index];
+		if (!scenario_filter.empty() && scenario_filter != scenario.name)
+			continue;
+		found_scenario = true;
+
+		std::string text;
+		corpus_writer writer(text);
+		benchmark_random random(BENCHMARK_SEED + scenario_index);
+		writer.start();
+		scenario.generator(writer, random, num_lines);
+		std::vector<const char*> lines;
+		split_lines(text, lines);
+		const double num_scenario_lines = static_cast<double>(lines.size());
+		const double num_bytes = static_cast<double>(text.length());
+
+		// The parser needs each line terminated, and the rest need them parsed
+		std::vector<parsed_command> commands(lines.size());
+		{
+			gcode_parser parser;
+			for (unsigned int index = 0; index < lines.size(); index++)
+			{
+				parser.try_parse_gcode(lines[index], commands[index]);
+			}
+		}
+		std::vector<arc_candidate> candidates;
+		get_arc_candidates(commands, candidates);
+
+		std::string source_path = work_directory + "/arc_welder_benchmark_" + scenario.name + ".gcode";
+		std::string target_path = work_directory + "/arc_welder_benchmark_" + scenario.name + ".aw.gcode";
+		{
+			std::ofstream source(source_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			source.write(text.c_str(), text.length());
+			if (!source.good())
+			{
+				std::cerr << "Unable to write " << source_path << ".\n";
+				return 1;
+			}
+		}
+
+		std::cout << "\n" << scenario.name << ": " << lines.size() << " lines, " << std::fixed << std::setprecision(2)
+			<< (num_bytes / 1048576.0) << " MB, " << candidates.size() << " arc candidates\n";
+
+		print_result("gcode_parser", benchmark_parser(lines, iterations), num_scenario_lines, "lines/s", num_bytes, -1);
+		print_result("gcode_position", benchmark_position(commands, iterations), num_scenario_lines, "lines/s", num_bytes, -1);
+		if (!candidates.empty())
+		{
+			int arcs = 0;
+			double arc_seconds = benchmark_segmented_arc(candidates, iterations, arcs);
+			print_result("segmented_arc", arc_seconds, static_cast<double>(candidates.size()), "points/s", -1, arcs);
+		}
+		double serial_seconds = 0;
+		std::string serial_output;
+		for (unsigned int mode_index = 0; mode_index < sizeof(process_modes) / sizeof(process_modes[0]); mode_index++)
+		{
+			const process_mode& mode = process_modes[mode_index];
+			arc_welder_results results;
+			double process_seconds = benchmark_process(source_path, target_path, log, mode, iterations, results);
+			if (!results.success)
+			{
+				std::cerr << "The " << mode.name << " conversion of " << source_path << " failed.\n";
+				return 1;
+			}
+			std::string output;
+			if (!read_file(target_path, output))
+			{
+				std::cerr << "Unable to read " << target_path << ".\n";
+				return 1;
+			}
+			print_result(mode.name, process_seconds, num_scenario_lines, "lines/s", num_bytes, results.arcs_created);
+			if (mode_index == 0)
+			{
+				serial_seconds = process_seconds;
+				serial_output.swap(output);
+			}
+			std::cout << "    " << std::setprecision(3) << process_seconds << "s, speedup " << std::setprecision(2)
+				<< (serial_seconds / process_seconds) << "x, cpu " << std::setprecision(3) << results.stage_times.total_cpu_seconds << "s\n";
+			if (mode_index == 0)
+			{
+				std::cout << "  compression ratio " << std::setprecision(2) << results.compression_ratio << "\n";
+			}
+			else if (output != serial_output)
+			{
+				std::cerr << "The " << mode.name << " output of " << source_path << " differs from the serial output.\n";
+				return 1;
+			}
+		}
+
+		std::remove(source_path.c_str());
+		std::remove(target_path.c_str());
+	}
+	if (!found_scenario)
+	{
+		std::cerr << "Unknown scenario " << scenario_filter << ".\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+
+// Compares number_formatter::append_fixed with snprintf, using every parameter value from a gcode file.  Each value
+// is written with the precision its parameter uses in the output, and with the other two gcode precisions.  Reports
+// the time per number for each, and how many results differ from snprintf.
+//
+// Usage: number_formatter_benchmark <gcode file> [iterations]
+
+#include "number_formatter.h"
+#include "number_parser.h"
+#include "line_reader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct formatted_number
+{
+	formatted_number(double value, int precision)
+	{
+		this->value = value;
+		this->precision = precision;
+	}
+	double value;
+	int precision;
+};
+
+// Values that are hard to round, or that printf writes in an unusual way
+static const double edge_values[] = {
+	0.0, -0.0, 0.0005, 1.0005, 2.5, 0.5, -0.5, 1.5, 0.00005, 0.000015, 1e-320, -1e-7, 123456.0005,
+	999.9995, 9.9999999, 1e14, 1e15, -1e15, 1e300, 4503599627370495.5
+};
+
+static void add_number(std::vector<formatted_number>& numbers, double value, char name)
+{
+	const int precision = number_formatter::get_parameter_precision(name);
+	numbers.push_back(formatted_number(value, precision));
+	if (precision != GCODE_COORDINATE_PRECISION)
+		numbers.push_back(formatted_number(value, GCODE_COORDINATE_PRECISION));
+	if (precision != GCODE_E_PRECISION)
+		numbers.push_back(formatted_number(value, GCODE_E_PRECISION));
+	if (precision != GCODE_F_PRECISION)
+		numbers.push_back(formatted_number(value, GCODE_F_PRECISION));
+}
+
+// Collect the value of each parameter letter, up to the next letter or comment.  Values are also offset and scaled,
+// as the welder does, so that they aren't all short decimals.
+static void load_numbers(const char * path, std::vector<formatted_number>& numbers)
+{
+	line_reader reader;
+	if (!reader.open(path))
+	{
+		std::cerr << "Unable to open " << path << ".\n";
+		exit(1);
+	}
+	const char * line;
+	int length;
+	while (reader.get_line(&line, &length))
+	{
+		std::string text(line, length);
+		const char * p = text.c_str();
+		while (*p != '\0' && *p != ';')
+		{
+			char name = *p++;
+			if (name >= 'a' && name <= 'z')
+				name = static_cast<char>(name - 32);
+			double value;
+			if (name >= 'A' && name <= 'Z' && number_parser::try_extract_double(&p, &value))
+			{
+				add_number(numbers, value, name);
+				add_number(numbers, value * 1.0000123 - 0.0001, name);
+			}
+		}
+	}
+	reader.close();
+	for (unsigned int index = 0; index < sizeof(edge_values) / sizeof(edge_values[0]); index++)
+	{
+		add_number(numbers, edge_values[index], 'X');
+	}
+}
+
+static double run_snprintf(std::vector<formatted_number>& numbers, int iterations, size_t * p_checksum)
+{
+	size_t checksum = 0;
+	char buffer[NUMBER_FORMATTER_MAX_LENGTH];
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (std::vector<formatted_number>::iterator it = numbers.begin(); it != numbers.end(); ++it)
+		{
+			checksum += snprintf(buffer, sizeof(buffer), "%.*f", it->precision, it->value);
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	*p_checksum = checksum;
+	return elapsed.count();
+}
+
+static double run_formatter(std::vector<formatted_number>& numbers, int iterations, size_t * p_checksum)
+{
+	size_t checksum = 0;
+	std::string output;
+	output.reserve(NUMBER_FORMATTER_MAX_LENGTH);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (std::vector<formatted_number>::iterator it = numbers.begin(); it != numbers.end(); ++it)
+		{
+			output.clear();
+			number_formatter::append_fixed(output, it->value, it->precision);
+			checksum += output.length();
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	*p_checksum = checksum;
+	return elapsed.count();
+}
+
+static int count_mismatches(std::vector<formatted_number>& numbers)
+{
+	int mismatches = 0;
+	char expected[NUMBER_FORMATTER_MAX_LENGTH];
+	std::string output;
+	for (std::vector<formatted_number>::iterator it = numbers.begin(); it != numbers.end(); ++it)
+	{
+		snprintf(expected, sizeof(expected), "%.*f", it->precision, it->value);
+		output.clear();
+		number_formatter::append_fixed(output, it->value, it->precision);
+		if (output != expected)
+		{
+			if (mismatches < 10)
+				std::cerr << "Mismatch: " << expected << " was written as " << output << "\n";
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <gcode file> [iterations]\n";
+		return 1;
+	}
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+	if (iterations < 1)
+		iterations = 1;
+
+	std::vector<formatted_number> numbers;
+	load_numbers(argv[1], numbers);
+	const double total_numbers = static_cast<double>(numbers.size()) * iterations;
+
+	size_t snprintf_checksum, checksum;
+	// Warm up the cache
+	run_snprintf(numbers, 1, &snprintf_checksum);
+	double snprintf_seconds = run_snprintf(numbers, iterations, &snprintf_checksum);
+	double seconds = run_formatter(numbers, iterations, &checksum);
+
+	std::cout << "Numbers: " << numbers.size() << ", Iterations: " << iterations << "\n";
+	std::cout << "snprintf:         " << (snprintf_seconds * 1e9 / total_numbers) << " ns/number (checksum " << snprintf_checksum << ")\n";
+	std::cout << "Number formatter: " << (seconds * 1e9 / total_numbers) << " ns/number (checksum " << checksum << ")\n";
+	std::cout << "Results that differ from snprintf: " << count_mismatches(numbers) << "\n";
+	std::cout << "Speedup: " << (snprintf_seconds / seconds) << "x\n";
+	return 0;
+}
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Compares number_parser::try_extract_double with the original gcode_parser implementation, using every parameter
+// value from a gcode file.  Reports the time per number for each, and how many results differ from strtod.
+//
+// Usage: number_parser_benchmark <gcode file> [iterations]
+
+#include "number_parser.h"
+#include "line_reader.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The implementation used by gcode_parser before number_parser existed.
+static double legacy_ten_pow(unsigned short n)
+{
+	double r = 1.0;
+
+	while (n > 0) {
+		r *= 10;
+		--n;
+	}
+
+	return r;
+}
+
+static bool legacy_try_extract_double(const char ** p_p_gcode, double * p_double)
+{
+	const char * p = *p_p_gcode;
+	bool neg = false;
+	double r = 0;
+	bool found_numbers = false;
+	while (*p == ' ')
+		++p;
+	if (*p == '-') {
+		neg = true;
+		++p;
+		while (*p == ' ')
+			++p;
+	}
+	else if (*p == '+') {
+		++p;
+		while (*p == ' ')
+			++p;
+	}
+	while ((*p >= '0' && *p <= '9') || *p == ' ') {
+		if (*p != ' ')
+		{
+			found_numbers = true;
+			r = (r*10.0) + (*p - '0');
+		}
+		++p;
+	}
+	if (*p == '.') {
+		double f = 0.0;
+		unsigned short n = 0;
+		++p;
+		while ((*p >= '0' && *p <= '9') || *p == ' ') {
+			if (*p != ' ')
+			{
+				found_numbers = true;
+				f = (f*10.0) + (*p - '0');
+				++n;
+			}
+			++p;
+		}
+		r += f / legacy_ten_pow(n);
+	}
+	if (neg) {
+		r = -r;
+	}
+	if (found_numbers)
+	{
+		*p_double = r;
+		*p_p_gcode = p;
+	}
+
+	return found_numbers;
+}
+
+typedef bool(*extract_double_function)(const char ** p_p_gcode, double * p_double);
+
+static bool is_number_char(char c)
+{
+	return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == ' ';
+}
+
+// Collect the text following each parameter letter, up to the next letter or comment.
+static void load_numbers(const char * path, std::vector<std::string>& numbers)
+{
+	line_reader reader;
+	if (!reader.open(path))
+	{
+		std::cerr << "Unable to open " << path << ".\n";
+		exit(1);
+	}
+	const char * line;
+	int length;
+	while (reader.get_line(&line, &length))
+	{
+		for (int index = 0; index < length && line[index] != ';'; index++)
+		{
+			char c = line[index];
+			if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')))
+				continue;
+			int start = index + 1;
+			int end = start;
+			while (end < length && is_number_char(line[end]))
+				end++;
+			if (end > start)
+				numbers.push_back(std::string(line + start, end - start));
+			index = end - 1;
+		}
+	}
+	reader.close();
+}
+
+static double run(extract_double_function function, std::vector<std::string>& numbers, int iterations, double * p_checksum)
+{
+	double checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (std::vector<std::string>::iterator it = numbers.begin(); it != numbers.end(); ++it)
+		{
+			const char * p = it->c_str();
+			double value;
+			if (function(&p, &value))
+				checksum += value;
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	*p_checksum = checksum;
+	return elapsed.count();
+}
+
+static int count_mismatches(extract_double_function function, std::vector<std::string>& numbers)
+{
+	int mismatches = 0;
+	for (std::vector<std::string>::iterator it = numbers.begin(); it != numbers.end(); ++it)
+	{
+		std::string cleaned;
+		for (std::string::iterator c = it->begin(); c != it->end(); ++c)
+		{
+			if (*c != ' ')
+				cleaned.push_back(*c);
+		}
+		const char * p = it->c_str();
+		double value;
+		if (!function(&p, &value))
+			continue;
+		double expected = strtod(cleaned.c_str(), NULL);
+		if (std::memcmp(&value, &expected, sizeof(double)) != 0)
+			mismatches++;
+	}
+	return mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <gcode file> [iterations]\n";
+		return 1;
+	}
+	int iterations = argc > 2 ? atoi(argv[2]) : 10;
+	if (iterations < 1)
+		iterations = 1;
+
+	std::vector<std::string> numbers;
+	load_numbers(argv[1], numbers);
+	if (numbers.empty())
+	{
+		std::cerr << "No parameter values were found in " << argv[1] << ".\n";
+		return 1;
+	}
+	const double total_numbers = static_cast<double>(numbers.size()) * iterations;
+
+	double legacy_checksum, checksum;
+	// Warm up the cache
+	run(legacy_try_extract_double, numbers, 1, &legacy_checksum);
+	double legacy_seconds = run(legacy_try_extract_double, numbers, iterations, &legacy_checksum);
+	double seconds = run(number_parser::try_extract_double, numbers, iterations, &checksum);
+
+	std::cout << "Numbers: " << numbers.size() << ", Iterations: " << iterations << "\n";
+	std::cout << "Legacy parser:  " << (legacy_seconds * 1e9 / total_numbers) << " ns/number, "
+		<< count_mismatches(legacy_try_extract_double, numbers) << " results differ from strtod (checksum " << legacy_checksum << ")\n";
+	std::cout << "Number parser:  " << (seconds * 1e9 / total_numbers) << " ns/number, "
+		<< count_mismatches(number_parser::try_extract_double, numbers) << " results differ from strtod (checksum " << checksum << ")\n";
+	std::cout << "Speedup: " << (legacy_seconds / seconds) << "x\n";
+	return 0;
+}
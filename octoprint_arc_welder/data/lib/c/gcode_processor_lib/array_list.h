@@ -58,7 +58,7 @@ public:
 		items_ = new_items;
 		max_size_ = max_size;
 	}
-	void push_front(T object)
+	void push_front(const T& object)
 	{
 		if (count_ == max_size_)
 		{
@@ -74,7 +74,7 @@ public:
 		count_++;
 		items_[front_index_] = object;
 	}
-	void push_back(T object)
+	void push_back(const T& object)
 	{
 		if (count_ == max_size_)
 		{
@@ -109,7 +109,8 @@ public:
 			throw std::exception();
 		}
 
-		return items_[--count_];
+		count_--;
+		return items_[(front_index_ + count_ + max_size_) % max_size_];
 	}
 	T& operator[](int index)
 	{
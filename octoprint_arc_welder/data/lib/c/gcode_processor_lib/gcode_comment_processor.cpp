@@ -36,7 +36,7 @@ comment_process_type gcode_comment_processor::get_comment_process_type()
 	return processing_type_;
 }
 
-void gcode_comment_processor::update(position& pos)
+void gcode_comment_processor::update(position& pos, const parsed_command& command)
 {
 	if (processing_type_ == comment_process_type_off)
 		return;
@@ -49,30 +49,30 @@ void gcode_comment_processor::update(position& pos)
 
 	if (processing_type_ == comment_process_type_unknown || processing_type_ == comment_process_type_slic3r_pe)
 	{
-		if (update_feature_for_slic3r_pe_comment(pos, pos.command.comment))
+		if (update_feature_for_slic3r_pe_comment(pos, command))
 			processing_type_ = comment_process_type_slic3r_pe;
 	}
 	
 }
 
-bool gcode_comment_processor::update_feature_for_slic3r_pe_comment(position& pos, std::string &comment) const
+bool gcode_comment_processor::update_feature_for_slic3r_pe_comment(position& pos, const parsed_command& command) const
 {
-	if (comment == "perimeter" || comment == "move to first perimeter point")
+	if (command.comment_equals("perimeter") || command.comment_equals("move to first perimeter point"))
 	{
 		pos.feature_type_tag = feature_type_unknown_perimeter_feature;
 		return true;
 	}
-	if (comment == "infill" || comment == "move to first infill point")
+	if (command.comment_equals("infill") || command.comment_equals("move to first infill point"))
 	{
 		pos.feature_type_tag = feature_type_infill_feature;
 		return true;
 	}
-	if (comment == "infill(bridge)" || comment == "move to first infill(bridge) point")
+	if (command.comment_equals("infill(bridge)") || command.comment_equals("move to first infill(bridge) point"))
 	{
 		pos.feature_type_tag = feature_type_bridge_feature;
 		return true;
 	}
-	if (comment == "skirt" || comment == "move to first skirt point")
+	if (command.comment_equals("skirt") || command.comment_equals("move to first skirt point"))
 	{
 		pos.feature_type_tag = feature_type_skirt_feature;
 		return true;
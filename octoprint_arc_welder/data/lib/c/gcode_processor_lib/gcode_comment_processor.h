@@ -68,7 +68,7 @@ public:
 	
 	gcode_comment_processor();
 	~gcode_comment_processor();
-	void update(position& pos);
+	void update(position& pos, const parsed_command& command);
 	void update(std::string & comment);
 	comment_process_type get_comment_process_type();
 
@@ -81,7 +81,7 @@ private:
 	bool update_feature_from_section_for_simplify_3d(position& pos) const;
 	bool update_feature_from_section_for_slice3r_pe(position& pos) const;
 	void update_feature_for_unknown_slicer_comment(position& pos, std::string &comment);
-	bool update_feature_for_slic3r_pe_comment(position& pos, std::string &comment) const;
+	bool update_feature_for_slic3r_pe_comment(position& pos, const parsed_command& command) const;
 	void update_unknown_section(std::string & comment);
 	bool update_cura_section(std::string &comment);
 	bool update_simplify_3d_section(std::string &comment);
@@ -22,73 +22,12 @@
 
 #include "gcode_parser.h"
 #include "utilities.h"
+#include "number_parser.h"
+#include "probes.h"
 #include <cmath>
 #include <iostream>
 gcode_parser::gcode_parser()
 {
-	// doesn't work in the ancient version of c++ I am forced to use :(
-	// or at least I don't know how to us a newer one with python 2.7
-	// help...
-	/* 
-	std::vector<std::string> text_only_function_names = { "M117" }; // "M117" is an example of a command that would work here.
-
-	std::vector<std::string> parsable_command_names = {
-		"G0","G1","G2","G3","G10","G11","G20","G21","G28","G29","G80","G90","G91","G92","M82","M83","M104","M105","M106","M109","M114","M116","M140","M141","M190","M191","M207","M208","M240","M400","T"
-	};
-	*/
-	// Have to resort to barbarity.
-	// Text only function names
-	std::vector<std::string> text_only_function_names;
-	text_only_function_names.push_back(("M117"));
-	// parsable_command_names
-	std::vector<std::string> parsable_command_names;
-	parsable_command_names.push_back("G0");
-	parsable_command_names.push_back("G1");
-	parsable_command_names.push_back("G2");
-	parsable_command_names.push_back("G3");
-	parsable_command_names.push_back("G10");
-	parsable_command_names.push_back("G11");
-	parsable_command_names.push_back("G20");
-	parsable_command_names.push_back("G21");
-	parsable_command_names.push_back("G28");
-	parsable_command_names.push_back("G29");
-	parsable_command_names.push_back("G80");
-	parsable_command_names.push_back("G90");
-	parsable_command_names.push_back("G91");
-	parsable_command_names.push_back("G92");
-	parsable_command_names.push_back("M82");
-	parsable_command_names.push_back("M83");
-	parsable_command_names.push_back("M104");
-	parsable_command_names.push_back("M105");
-	parsable_command_names.push_back("M106");
-	parsable_command_names.push_back("M109");
-	parsable_command_names.push_back("M114");
-	parsable_command_names.push_back("M116");
-	parsable_command_names.push_back("M140");
-	parsable_command_names.push_back("M141");
-	parsable_command_names.push_back("M190");
-	parsable_command_names.push_back("M191");
-	parsable_command_names.push_back("M207");
-	parsable_command_names.push_back("M208");
-	parsable_command_names.push_back("M218");
-	parsable_command_names.push_back("M240");
-	parsable_command_names.push_back("M400");
-	parsable_command_names.push_back("M563");
-	parsable_command_names.push_back("T");
-	parsable_command_names.push_back("@OCTOLAPSE");
-
-	for (unsigned int index = 0; index < text_only_function_names.size(); index++)
-	{
-		std::string functionName = text_only_function_names[index];
-		text_only_functions_.insert(functionName);
-	}
-
-	for (unsigned int index = 0; index < parsable_command_names.size(); index++)
-	{
-		std::string commandName = parsable_command_names[index];
-		parsable_commands_.insert(commandName);
-	}
-
 }
 
 gcode_parser::gcode_parser(const gcode_parser &source)
@@ -98,8 +37,6 @@ gcode_parser::gcode_parser(const gcode_parser &source)
 
 gcode_parser::~gcode_parser()
 {
-	text_only_functions_.clear();
-	parsable_commands_.clear();
 }
 
 parsed_command gcode_parser::parse_gcode(const char * gcode)
@@ -111,13 +48,27 @@ parsed_command gcode_parser::parse_gcode(const char * gcode)
 }
 
 // Superfast gcode parser - v2
+// The gcode may be terminated by either '\0' or '\n', which allows lines to be parsed in place from a file buffer.
+// The line is copied into the command once, and the command, gcode, comment and any string parameters are stored
+// as spans within that copy.
 bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
 {
-	// Create a command
-	char * p_gcode = const_cast<char *>(gcode);
-	char * p = const_cast<char *>(gcode);
+	GCODE_PROBE_SCOPE("gcode_parser::try_parse_gcode");
+	// Copy the line into the command
+	const char * p_line_end = gcode;
+	while (*p_line_end != '\0' && *p_line_end != '\n')
+		p_line_end++;
+	command.line.assign(gcode, p_line_end - gcode);
+	command.command_span = text_span();
+	command.gcode_span = text_span();
+	command.comment_span = text_span();
+	command.id = command_id_unknown;
+
+	const char * p_line = command.line.c_str();
+	const char * p_gcode = p_line;
+	const char * p = p_line;
 	command.is_empty = true;
-	command.is_known_command = try_extract_gcode_command(&p, &(command.command));
+	command.is_known_command = try_extract_gcode_command(&p, p_line, &(command.command_span));
 	if (!command.is_known_command)
 	{
 		while (true)
@@ -132,42 +83,45 @@ bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
 			}
 			p_gcode++;
 		}
-		command.command = "";
+		command.command_span = text_span();
 	}
 	else
 		command.is_empty = false;
 
-	bool has_seen_character = false;
+	// The gcode span starts and ends with a printable character
+	const char * p_gcode_start = NULL;
+	const char * p_gcode_end = NULL;
 	while (true)
 	{
 		char cur_char = *p_gcode;
 		if (cur_char == '\0' || cur_char == ';')
 			break;
-		else if (cur_char > 32 || (cur_char == ' ' && has_seen_character))
+		else if (cur_char > 32)
 		{
-			if (cur_char >= 'a' && cur_char <= 'z')
-				command.gcode.push_back(cur_char - 32);
-			else
-				command.gcode.push_back(cur_char);
-			has_seen_character = true;
+			if (p_gcode_start == NULL)
+				p_gcode_start = p_gcode;
+			p_gcode_end = p_gcode + 1;
 		}
 		p_gcode++;
 	}
-	command.gcode = utilities::rtrim(command.gcode);
+	if (p_gcode_start != NULL)
+	{
+		command.gcode_span = text_span(static_cast<int>(p_gcode_start - p_line), static_cast<int>(p_gcode_end - p_gcode_start));
+	}
 
 	if (command.is_known_command)
 	{
-
-		if (parsable_commands_.find(command.command) == parsable_commands_.end())
+		command.id = get_command_id(p_line + command.command_span.offset, command.command_span.length);
+		switch (command.id)
 		{
+		case command_id_unknown:
+		case command_id_unparsed:
 			return true;
-		}
-		if (command.command.length() > 0 && command.command == "@OCTOLAPSE")
+		case command_id_at_octolapse:
 		{
-			
 			parsed_command_parameter octolapse_parameter;
 
-			if (!try_extract_octolapse_parameter(&p, &octolapse_parameter))
+			if (!try_extract_octolapse_parameter(&p, p_line, &octolapse_parameter))
 			{
 				return true;
 			}
@@ -175,73 +129,144 @@ bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
 			// Extract any additional parameters the old way
 			while (true)
 			{
-				//std::cout << "GcodeParser.try_parse_gcode - Trying to extract parameters.\r\n";
 				parsed_command_parameter param;
-				if (try_extract_parameter(&p, &param))
+				if (try_extract_parameter(&p, p_line, &param))
 					command.parameters.push_back(param);
 				else
 				{
-					//std::cout << "GcodeParser.try_parse_gcode - No parameters found.\r\n";
 					break;
 				}
 			}
-
+			break;
 		}
-		else if (
-			text_only_functions_.find(command.command) != text_only_functions_.end() ||
-			(
-				command.command.length() > 0 && command.command[0] == '@'
-			)
-		){
-			//std::cout << "GcodeParser.try_parse_gcode - Text only parameter found.\r\n";
-			parsed_command_parameter text_command;
-			if (!try_extract_text_parameter(&p, &(text_command.string_value)))
+		case command_id_t:
+		{
+			parsed_command_parameter param;
+
+			if (try_extract_t_parameter(&p, p_line, &param))
 			{
-				return true;
+				command.parameters.push_back(param);
 			}
-			text_command.name = '\0';
-			command.parameters.push_back(text_command);
+			break;
 		}
-		else
-		{
-			if (command.command[0] == 'T')
+		default:
+			while (true)
 			{
-				//std::cout << "GcodeParser.try_parse_gcode - T parameter found.\r\n";
 				parsed_command_parameter param;
-
-				if (try_extract_t_parameter(&p, &param))
-				{
+				if (try_extract_parameter(&p, p_line, &param))
 					command.parameters.push_back(param);
-				}
-					
-			}
-			else
-			{
-				while (true)
+				else
 				{
-					//std::cout << "GcodeParser.try_parse_gcode - Trying to extract parameters.\r\n";
-					parsed_command_parameter param;
-					if (try_extract_parameter(&p, &param))
-						command.parameters.push_back(param);
-					else
-					{
-						//std::cout << "GcodeParser.try_parse_gcode - No parameters found.\r\n";
-						break;
-					}
+					break;
 				}
 			}
+			break;
 		}
 	}
-	try_extract_comment(&p_gcode, &(command.comment));
+	try_extract_comment(&p_gcode, p_line, &(command.comment_span));
 		
 
 	return command.is_known_command;
 	
 }
 
-bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_command)
+command_id gcode_parser::get_command_id(const char * p_command, const int length)
+{
+	const char * p_end = p_command + length;
+	// Commands may contain spaces (G 1), skip them
+	while (p_command < p_end && *p_command == ' ')
+		p_command++;
+	if (p_command == p_end)
+		return command_id_unknown;
+
+	char gcode_word = *p_command++;
+	if (gcode_word >= 'a' && gcode_word <= 'z')
+		gcode_word -= 32;
+
+	if (gcode_word == '@')
+	{
+		const char * p_name = "OCTOLAPSE";
+		for (; p_command < p_end; p_command++, p_name++)
+		{
+			char cur_char = *p_command;
+			if (cur_char >= 'a' && cur_char <= 'z')
+				cur_char -= 32;
+			if (cur_char != *p_name)
+				return command_id_unparsed;
+		}
+		return *p_name == '\0' ? command_id_at_octolapse : command_id_unparsed;
+	}
+	if (gcode_word == 'T')
+		return command_id_t;
+
+	// Get the address.  Addresses with a leading zero or a subcode are not in the table.
+	int address = 0;
+	int num_digits = 0;
+	bool has_leading_zero = false;
+	for (; p_command < p_end; p_command++)
+	{
+		if (*p_command == ' ')
+			continue;
+		if (*p_command < '0' || *p_command > '9' || num_digits > 3)
+			return command_id_unparsed;
+		if (num_digits == 0 && *p_command == '0')
+			has_leading_zero = true;
+		address = address * 10 + (*p_command - '0');
+		num_digits++;
+	}
+	if (num_digits == 0 || (has_leading_zero && num_digits > 1))
+		return command_id_unparsed;
+
+	if (gcode_word == 'G')
+	{
+		switch (address)
+		{
+		case 0: return command_id_g0;
+		case 1: return command_id_g1;
+		case 2: return command_id_g2;
+		case 3: return command_id_g3;
+		case 10: return command_id_g10;
+		case 11: return command_id_g11;
+		case 20: return command_id_g20;
+		case 21: return command_id_g21;
+		case 28: return command_id_g28;
+		case 29: return command_id_g29;
+		case 80: return command_id_g80;
+		case 90: return command_id_g90;
+		case 91: return command_id_g91;
+		case 92: return command_id_g92;
+		}
+	}
+	else if (gcode_word == 'M')
+	{
+		switch (address)
+		{
+		case 82: return command_id_m82;
+		case 83: return command_id_m83;
+		case 104: return command_id_m104;
+		case 105: return command_id_m105;
+		case 106: return command_id_m106;
+		case 109: return command_id_m109;
+		case 114: return command_id_m114;
+		case 116: return command_id_m116;
+		case 140: return command_id_m140;
+		case 141: return command_id_m141;
+		case 190: return command_id_m190;
+		case 191: return command_id_m191;
+		case 207: return command_id_m207;
+		case 208: return command_id_m208;
+		case 218: return command_id_m218;
+		case 240: return command_id_m240;
+		case 400: return command_id_m400;
+		case 563: return command_id_m563;
+		}
+	}
+	return command_id_unparsed;
+}
+
+bool gcode_parser::try_extract_gcode_command(const char ** p_p_gcode, const char * p_line, text_span * p_command)
 {
-	char * p = *p_p_gcode;
+	const char * p = *p_p_gcode;
 	char gcode_word;
 	bool found_command = false;
 
@@ -253,7 +278,7 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 	// See if this is an @ command, which can be used in octoprint for controlling octolapse
 	if (*p == '@')
 	{
-		found_command = gcode_parser::try_extract_at_command(&p, p_command);
+		found_command = gcode_parser::try_extract_at_command(&p, p_line, p_command);
 	}
 	else
 	{
@@ -266,8 +291,9 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 		gcode_word = *p;
 	if (gcode_word == 'G' || gcode_word == 'M' || gcode_word == 'T')
 	{
-		// Set the gcode word of the new command to the current pointer's location and increment both
-		(*p_command).push_back(gcode_word);
+		// The command starts at the gcode word, and ends after the last character of the address
+		const char * p_command_start = p;
+		const char * p_command_end = p + 1;
 		p++;
 
 		if (gcode_word != 'T')
@@ -279,7 +305,7 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 				if (*p != ' ')
 				{
 					found_command = true;
-					(*p_command).push_back(*p++);
+					p_command_end = ++p;
 				}
 				else if (found_command)
 				{
@@ -302,13 +328,13 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 				}
 			}
 			if (*p == '.') {
-				(*p_command).push_back(*p++);
+				p_command_end = ++p;
 				found_command = false;
 				while ((*p >= '0' && *p <= '9') || *p == ' ') {
 					if (*p != ' ')
 					{
 						found_command = true;
-						(*p_command).push_back(*p++);
+						p_command_end = ++p;
 					}
 					else
 						++p;
@@ -319,7 +345,7 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 		{
 			// peek at the next character and see if it is either a number, a question mark, a c, x, or integer.
 			// Use a different pointer so as not to mess up parameter parsing
-			char * p_t = p;
+			const char * p_t = p;
 			// skip any whitespace
 			// Ignore Leading Spaces
 			while (*p_t == ' ' || *p_t == '\t')
@@ -351,14 +377,16 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 				found_command = true;
 			}
 		}
+		*p_command = text_span(static_cast<int>(p_command_start - p_line), static_cast<int>(p_command_end - p_command_start));
 	}
 	*p_p_gcode = p;
 	return found_command;
 }
 
-bool gcode_parser::try_extract_at_command(char ** p_p_gcode, std::string * p_command)
+bool gcode_parser::try_extract_at_command(const char ** p_p_gcode, const char * p_line, text_span * p_command)
 {
-	char *p = *p_p_gcode;
+	const char *p = *p_p_gcode;
+	const char *p_start = p;
 	bool found_command = false;
 	while (*p != '\0' && *p != ';' && *p!= ' ')
 	{
@@ -366,19 +394,16 @@ bool gcode_parser::try_extract_at_command(char ** p_p_gcode, std::string * p_com
 		{
 			found_command = true;
 		}
-		if (*p >= 'a' && *p <= 'z')
-			(*p_command).push_back(*p++ - 32);
-		else
-			(*p_command).push_back(*p++);
-		
+		p++;
 	}
+	*p_command = text_span(static_cast<int>(p_start - p_line), static_cast<int>(p - p_start));
 	*p_p_gcode = p;
 	return found_command;
 
 }
 
-bool gcode_parser::try_extract_unsigned_long(char ** p_p_gcode, unsigned long * p_value) {
-	char * p = *p_p_gcode;
+bool gcode_parser::try_extract_unsigned_long(const char ** p_p_gcode, unsigned long * p_value) {
+	const char * p = *p_p_gcode;
 	unsigned int r = 0;
 	bool found_numbers = false;
 	// skip any leading whitespace
@@ -402,83 +427,11 @@ bool gcode_parser::try_extract_unsigned_long(char ** p_p_gcode, unsigned long *
 	return found_numbers;
 }
 
-double gcode_parser::ten_pow(unsigned short n) {
-	double r = 1.0;
-
-	while (n > 0) {
-		r *= 10;
-		--n;
-	}
-
-	return r;
-}
-
-bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) const
-{
-	char * p = *p_p_gcode;
-	bool neg = false;
-	double r = 0;
-	bool found_numbers = false;
-	// skip any leading whitespace
-	while (*p == ' ')
-		++p;
-	// Check for negative sign
-	if (*p == '-') {
-		neg = true;
-		++p;
-		while (*p == ' ')
-			++p;
-	}
-	else if (*p == '+') {
-		// Positive sign doesn't affect anything since we assume positive
-		++p;
-		while (*p == ' ')
-			++p;
-	}
-	// skip any additional whitespace
-	
-
-	while ((*p >= '0' && *p <= '9') || *p == ' ') {
-		if (*p != ' ')
-		{
-			found_numbers = true;
-			r = (r*10.0) + (*p - '0');
-		}
-		++p;
-	}
-	if (*p == '.') {
-		double f = 0.0;
-		unsigned short n = 0;
-		++p;
-		while ((*p >= '0' && *p <= '9') || *p == ' ') {
-			if (*p != ' ')
-			{
-				found_numbers = true;
-				f = (f*10.0) + (*p - '0');
-				++n;
-			}
-			++p;
-		}
-		//r += f / pow(10.0, n);
-		r += f / ten_pow(n);
-	}
-	if (neg) {
-		r = -r;
-	}
-	if (found_numbers)
-	{
-		*p_double = r;
-		*p_p_gcode = p;
-	}
-	
-	return found_numbers;
-}
-
-bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter)
+bool gcode_parser::try_extract_text_parameter(const char ** p_p_gcode, const char * p_line, text_span * p_parameter)
 {
 	// Skip initial whitespace
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a text parameter from  " << *p_p_gcode << "\r\n";
-	char * p = *p_p_gcode;
+	const char * p = *p_p_gcode;
 	
 	// Ignore Leading Spaces
 	while (*p == ' ')
@@ -486,46 +439,42 @@ bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, std::string * p
 		p++;
 	}
 	// Add all values, stop at end of string or when we hit a ';'
-
+	const char * p_start = p;
 	while (*p != '\0' && *p != ';')
 	{
-		(*p_parameter).push_back(*p++);
+		p++;
 	}
+	*p_parameter = text_span(static_cast<int>(p_start - p_line), static_cast<int>(p - p_start));
 	*p_p_gcode = p;
 	return true;
 
 }
 
-bool gcode_parser::try_extract_octolapse_parameter(char ** p_p_gcode, parsed_command_parameter * p_parameter)
+bool gcode_parser::try_extract_octolapse_parameter(const char ** p_p_gcode, const char * p_line, parsed_command_parameter * p_parameter)
 {
-	p_parameter->name = "";
-	p_parameter->value_type = 'N';
+	// The octolapse parameter has no letter, the parameter name is stored as a string value
+	p_parameter->name = '\0';
+	p_parameter->value_type = 'S';
 	// Skip initial whitespace
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a text parameter from  " << *p_p_gcode << "\r\n";
-	char * p = *p_p_gcode;
+	const char * p = *p_p_gcode;
 	bool has_found_parameter = false;
 	// Ignore Leading Spaces
 	while (*p == ' ')
 	{
 		p++;
 	}
-	// extract name, make all caps.
+	// extract name
+	const char * p_start = p;
 	while (*p != '\0' && *p != ';' && *p != ' ')
 	{
 		if (!has_found_parameter)
 		{
 			has_found_parameter = true;
 		}
-
-		if (*p >= 'a' && *p <= 'z')
-		{
-			p_parameter->name.push_back(*p++ - 32);
-		}
-		else
-		{
-			p_parameter->name.push_back(*p++);
-		}
+		p++;
 	}
+	p_parameter->string_value = text_span(static_cast<int>(p_start - p_line), static_cast<int>(p - p_start));
 	// Todo: Handle any otolapse commands require a string parameter
 	/*
 	// Ignore spaces after the command name
@@ -553,10 +502,10 @@ bool gcode_parser::try_extract_octolapse_parameter(char ** p_p_gcode, parsed_com
 	return has_found_parameter;
 }
 
-bool gcode_parser::try_extract_parameter(char ** p_p_gcode, parsed_command_parameter * parameter) const
+bool gcode_parser::try_extract_parameter(const char ** p_p_gcode, const char * p_line, parsed_command_parameter * parameter) const
 {
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a parameter from  " << *p_p_gcode << "\r\n";
-	char * p = *p_p_gcode;
+	const char * p = *p_p_gcode;
 
 	// Ignore Leading Spaces
 	while (*p == ' ')
@@ -574,13 +523,13 @@ bool gcode_parser::try_extract_parameter(char ** p_p_gcode, parsed_command_param
 	// TODO:  See if unsigned long works....
 
 	// Add all values, stop at end of string or when we hit a ';'
-	if (try_extract_double(&p,&(parameter->double_value)))
+	if (number_parser::try_extract_double(&p,&(parameter->double_value)))
 	{
 		parameter->value_type = 'F';
 	}
 	else
 	{
-		if(try_extract_text_parameter(&p, &(parameter->string_value)))
+		if(try_extract_text_parameter(&p, p_line, &(parameter->string_value)))
 		{
 			parameter->value_type = 'S';
 		}
@@ -595,10 +544,10 @@ bool gcode_parser::try_extract_parameter(char ** p_p_gcode, parsed_command_param
 
 }
 
-bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, parsed_command_parameter * parameter)
+bool gcode_parser::try_extract_t_parameter(const char ** p_p_gcode, const char * p_line, parsed_command_parameter * parameter)
 {
 	//std::cout << "Trying to extract a T parameter from " << *p_p_gcode << "\r\n";
-	char * p = *p_p_gcode;
+	const char * p = *p_p_gcode;
 	parameter->name = 'T';
 	// Ignore Leading Spaces
 	while (*p == L' ')
@@ -609,19 +558,19 @@ bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, parsed_command_par
 	if (*p == L'c' || *p == L'C')
 	{
 		//std::cout << "Found C value for T parameter\r\n";
-		parameter->string_value = "C";
+		parameter->string_value = text_span(static_cast<int>(p - p_line), 1);
 		parameter->value_type = 'S';
 	}
 	else if (*p == L'x' || *p == L'X')
 	{
 		//std::cout << "Found X value for T parameter\r\n";
-		parameter->string_value = "X";
+		parameter->string_value = text_span(static_cast<int>(p - p_line), 1);
 		parameter->value_type = 'S';
 	}
 	else if (*p == L'?')
 	{
 		//std::cout << "Found ? value for T parameter\r\n";
-		parameter->string_value = "?";
+		parameter->string_value = text_span(static_cast<int>(p - p_line), 1);
 		parameter->value_type = 'S';
 	}
 	else
@@ -637,11 +586,11 @@ bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, parsed_command_par
 	return true;
 }
 
-bool gcode_parser::try_extract_comment(char ** p_p_gcode, std::string * p_comment)
+bool gcode_parser::try_extract_comment(const char ** p_p_gcode, const char * p_line, text_span * p_comment)
 {
 	// Skip initial whitespace
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a text parameter from  " << *p_p_gcode << "\r\n";
-	char * p = *p_p_gcode;
+	const char * p = *p_p_gcode;
 
 	bool found_comment = false;
 	// Hunt for the comment (semicolon)
@@ -654,23 +603,19 @@ bool gcode_parser::try_extract_comment(char ** p_p_gcode, std::string * p_commen
 		p++;
 	}
 
-	// Add all values, stop at end of string or when we hit a ';'
-	/*while (*p == ';' || *p == ' ')
-	{
-		p++;
-	}*/
-	// Add all characters until we hit the null terminator
+	// The comment includes all characters until we hit the end of the line, excluding any trailing line breaks.
+	// Line breaks within the comment are removed when it is materialized.
+	const char * p_start = p;
+	const char * p_end = p;
 	while (*p != '\0')
 	{
-		if (*p != '\r' && *p != '\n')
+		if (*p++ != '\r')
 		{
-			// Dont't add line breaks
-			(*p_comment).push_back(*p++);
+			p_end = p;
 		}
-		else
-			p++;
 	}
+	*p_comment = text_span(static_cast<int>(p_start - p_line), static_cast<int>(p_end - p_start));
 	*p_p_gcode = p;
-	return p_comment->length() != 0;
+	return p_comment->length != 0;
 
-}
\ No newline at end of file
+}
@@ -38,19 +38,15 @@ public:
 	parsed_command parse_gcode(const char * gcode);
 private:
 	gcode_parser(const gcode_parser &source);
-	// Variables and lookups
-	std::set<std::string> text_only_functions_;
-	std::set<std::string> parsable_commands_;
 	// Functions
-	bool try_extract_double(char ** p_p_gcode, double * p_double) const;
-	static bool try_extract_gcode_command(char ** p_p_gcode, std::string * p_command);
-	static bool try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter);
-	bool try_extract_parameter(char ** p_p_gcode, parsed_command_parameter * parameter) const;
-	static bool try_extract_t_parameter(char ** p_p_gcode, parsed_command_parameter * parameter);
-	static bool try_extract_unsigned_long(char ** p_p_gcode, unsigned long * p_value);
-	double static ten_pow(unsigned short n);
-	bool try_extract_comment(char ** p_p_gcode, std::string * p_comment);
-	static bool try_extract_at_command(char ** p_p_gcode, std::string * p_command);
-	bool try_extract_octolapse_parameter(char ** p_p_gcode, parsed_command_parameter * p_parameter);
+	static command_id get_command_id(const char * p_command, int length);
+	static bool try_extract_gcode_command(const char ** p_p_gcode, const char * p_line, text_span * p_command);
+	static bool try_extract_text_parameter(const char ** p_p_gcode, const char * p_line, text_span * p_parameter);
+	bool try_extract_parameter(const char ** p_p_gcode, const char * p_line, parsed_command_parameter * parameter) const;
+	static bool try_extract_t_parameter(const char ** p_p_gcode, const char * p_line, parsed_command_parameter * parameter);
+	static bool try_extract_unsigned_long(const char ** p_p_gcode, unsigned long * p_value);
+	bool try_extract_comment(const char ** p_p_gcode, const char * p_line, text_span * p_comment);
+	static bool try_extract_at_command(const char ** p_p_gcode, const char * p_line, text_span * p_command);
+	bool try_extract_octolapse_parameter(const char ** p_p_gcode, const char * p_line, parsed_command_parameter * p_parameter);
 };
 #endif
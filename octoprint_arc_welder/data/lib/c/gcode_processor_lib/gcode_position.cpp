@@ -22,6 +22,7 @@
 
 #include "gcode_position.h"
 #include "utilities.h"
+#include "probes.h"
 #include <algorithm>
 #include <iterator>
 #include <math.h>
@@ -229,7 +230,6 @@ gcode_position::gcode_position()
 	e_axis_default_mode_ = "absolute";
 	xyz_axis_default_mode_ = "absolute";
 	units_default_ = "millimeters";
-	gcode_functions_ = get_gcode_functions();
 
 	is_bound_ = false;
 	snapshot_x_min_ = 0;
@@ -312,7 +312,6 @@ gcode_position::gcode_position(gcode_position_args args)
 	e_axis_default_mode_ = args.e_axis_default_mode;
 	xyz_axis_default_mode_ = args.xyz_axis_default_mode;
 	units_default_ = args.units_default;
-	gcode_functions_ = get_gcode_functions();
 
 	is_bound_ = args.is_bound_;
 	snapshot_x_min_ = args.snapshot_x_min;
@@ -343,16 +342,11 @@ gcode_position::gcode_position(gcode_position_args args)
 	initial_pos.current_tool = current_extruder;
 	for (int index = 0; index < args.num_extruders; index++)
 	{
-		initial_pos.p_extruders[index].x_firmware_offset = args.x_firmware_offsets[index];
-		initial_pos.p_extruders[index].y_firmware_offset = args.y_firmware_offsets[index];
+		initial_pos.extruders[index].x_firmware_offset = args.x_firmware_offsets[index];
+		initial_pos.extruders[index].y_firmware_offset = args.y_firmware_offsets[index];
 	}
-
-	for (int index = 0; index < position_buffer_size_; index++)
-	{
-
-		add_position(initial_pos);
-	}
-	num_pos_ = 0;
+	initial_position_ = initial_pos;
+	reset();
 }
 
 gcode_position::gcode_position(const gcode_position &source)
@@ -418,13 +412,12 @@ void gcode_position::add_position(position& pos)
 		num_pos_++;
 }
 
-void gcode_position::add_position(parsed_command& cmd)
+void gcode_position::add_position()
 {
 	const int prev_pos = cur_pos_;
 	cur_pos_ = (cur_pos_+1) % position_buffer_size_;
 	positions_[cur_pos_] = positions_[prev_pos];
 	positions_[cur_pos_].reset_state();
-	positions_[cur_pos_].command = cmd;
 	positions_[cur_pos_].is_empty = false;
 	if (num_pos_ < position_buffer_size_)
 		num_pos_++;
@@ -463,37 +456,39 @@ position * gcode_position::get_previous_position_ptr()
 
 void gcode_position::update(parsed_command& command, const long file_line_number, const long gcode_number, const long file_position)
 {
+	GCODE_PROBE_SCOPE("gcode_position::update");
 	
 	/*if (command.is_empty)
 	{
 		// process any comment sections
-		comment_processor_.update(command.comment);
+		comment_processor_.update(command.get_comment());
 		return;
 	}*/
 	
-	add_position(command);
+	add_position();
 	position * p_current_pos = get_current_position_ptr();
 	position * p_previous_pos = get_previous_position_ptr();
 	p_current_pos->file_line_number = file_line_number;
 	p_current_pos->gcode_number = gcode_number;
 	p_current_pos->file_position = file_position;
-	comment_processor_.update(*p_current_pos);
+	comment_processor_.update(*p_current_pos, command);
 
 	if (!command.is_known_command || command.is_empty)
 		return;
 
-	// Does our function exist in our functions map?
-	gcode_functions_iterator_ = gcode_functions_.find(command.command);
+	// Does this command have a function?
+	const pos_function_type func = get_gcode_function(command.id);
 
-	if (gcode_functions_iterator_ != gcode_functions_.end())
+	if (func != NULL)
 	{
 		p_current_pos->gcode_ignored = false;
 		// Execute the function to process this gcode
-		const pos_function_type func = gcode_functions_iterator_->second;
 		(this->*func)(p_current_pos, command);
 		// calculate z and e relative distances
 		p_current_pos->get_current_extruder().e_relative = (p_current_pos->get_current_extruder().e - p_previous_pos->get_extruder(p_current_pos->current_tool).e);
+#ifndef GCODE_POSITION_LEAN
 		p_current_pos->z_relative = (p_current_pos->z - p_previous_pos->z);
+#endif
 		// Have the XYZ positions changed after processing a command ?
 
 		p_current_pos->has_xy_position_changed = (
@@ -508,6 +503,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 			p_current_pos->y_null != p_previous_pos->y_null ||
 			p_current_pos->z_null != p_previous_pos->z_null);
 
+#ifndef GCODE_POSITION_LEAN
 		// see if our position is homed
 		if (!p_current_pos->has_definite_position)
 		{
@@ -523,6 +519,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				!p_current_pos->is_relative_null &&
 				!p_current_pos->is_extruder_relative_null);
 		}
+#endif
 	}
 
 	if (p_current_pos->has_position_changed)
@@ -586,13 +583,16 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				p_current_pos->get_current_extruder().is_deretracting = false;
 				p_current_pos->get_current_extruder().is_deretracting_start = false;
 			}
+#ifndef GCODE_POSITION_LEAN
 			p_current_pos->get_current_extruder().is_primed = utilities::is_zero(p_current_pos->get_current_extruder().extrusion_length) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
 			p_current_pos->get_current_extruder().is_partially_retracted = utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, 0) && utilities::less_than(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
 			p_current_pos->get_current_extruder().is_retracted = utilities::greater_than_or_equal(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
 			p_current_pos->get_current_extruder().is_deretracted = utilities::greater_than(p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length, 0) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
+#endif
 			// *************End Calculate extruder state*************
 		}
 
+#ifndef GCODE_POSITION_LEAN
 		// Calcluate position restructions
 		// TODO:  INCLUDE POSITION RESTRICTION CALCULATIONS!
 		// Set is_in_bounds_ to false if we're not in bounds, it will be true at this point
@@ -683,6 +683,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 			}
 
 		}
+#endif
 
 		
 
@@ -727,29 +728,50 @@ position* gcode_position::undo_update(int num_updates)
 }
 
 // Private Members
-std::map<std::string, gcode_position::pos_function_type> gcode_position::get_gcode_functions()
+gcode_position::pos_function_type gcode_position::get_gcode_function(const command_id id)
 {
-	std::map<std::string, pos_function_type> newMap;
-	newMap.insert(std::make_pair("G0", &gcode_position::process_g0_g1));
-	newMap.insert(std::make_pair("G1", &gcode_position::process_g0_g1));
-	newMap.insert(std::make_pair("G2", &gcode_position::process_g2));
-	newMap.insert(std::make_pair("G3", &gcode_position::process_g3));
-	newMap.insert(std::make_pair("G10", &gcode_position::process_g10));
-	newMap.insert(std::make_pair("G11", &gcode_position::process_g11));
-	newMap.insert(std::make_pair("G20", &gcode_position::process_g20));
-	newMap.insert(std::make_pair("G21", &gcode_position::process_g21));
-	newMap.insert(std::make_pair("G28", &gcode_position::process_g28));
-	newMap.insert(std::make_pair("G90", &gcode_position::process_g90));
-	newMap.insert(std::make_pair("G91", &gcode_position::process_g91));
-	newMap.insert(std::make_pair("G92", &gcode_position::process_g92));
-	newMap.insert(std::make_pair("M82", &gcode_position::process_m82));
-	newMap.insert(std::make_pair("M83", &gcode_position::process_m83));
-	newMap.insert(std::make_pair("M207", &gcode_position::process_m207));
-	newMap.insert(std::make_pair("M208", &gcode_position::process_m208));
-	newMap.insert(std::make_pair("M218", &gcode_position::process_m218));
-	newMap.insert(std::make_pair("M563", &gcode_position::process_m563));
-	newMap.insert(std::make_pair("T", &gcode_position::process_t));
-	return newMap;
+	switch (id)
+	{
+	case command_id_g0:
+	case command_id_g1:
+		return &gcode_position::process_g0_g1;
+	case command_id_g2:
+		return &gcode_position::process_g2;
+	case command_id_g3:
+		return &gcode_position::process_g3;
+	case command_id_g10:
+		return &gcode_position::process_g10;
+	case command_id_g11:
+		return &gcode_position::process_g11;
+	case command_id_g20:
+		return &gcode_position::process_g20;
+	case command_id_g21:
+		return &gcode_position::process_g21;
+	case command_id_g28:
+		return &gcode_position::process_g28;
+	case command_id_g90:
+		return &gcode_position::process_g90;
+	case command_id_g91:
+		return &gcode_position::process_g91;
+	case command_id_g92:
+		return &gcode_position::process_g92;
+	case command_id_m82:
+		return &gcode_position::process_m82;
+	case command_id_m83:
+		return &gcode_position::process_m83;
+	case command_id_m207:
+		return &gcode_position::process_m207;
+	case command_id_m208:
+		return &gcode_position::process_m208;
+	case command_id_m218:
+		return &gcode_position::process_m218;
+	case command_id_m563:
+		return &gcode_position::process_m563;
+	case command_id_t:
+		return &gcode_position::process_t;
+	default:
+		return NULL;
+	}
 }
 
 void gcode_position::update_position(
@@ -767,6 +789,7 @@ void gcode_position::update_position(
 	const bool force, 
 	const bool is_g1_g0) const
 {
+#ifndef GCODE_POSITION_LEAN
 	if (is_g1_g0)
 	{
 		if (!update_e)
@@ -782,6 +805,7 @@ void gcode_position::update_position(
 		}
 
 	}
+#endif
 	if (update_f)
 	{
 		pos->f = f;
@@ -886,27 +910,27 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		const parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		if (p_cur_param.name == 'X')
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "E")
+		else if (p_cur_param.name == 'E')
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			update_z = true;
 			z = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "F")
+		else if (p_cur_param.name == 'F')
 		{
 			update_f = true;
 			f = p_cur_param.double_value;
@@ -928,22 +952,22 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		const parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		if (p_cur_param.name == 'X')
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "E")
+		else if (p_cur_param.name == 'E')
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "F")
+		else if (p_cur_param.name == 'F')
 		{
 			update_f = true;
 			f = p_cur_param.double_value;
@@ -973,13 +997,13 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		/*if (p_cur_param.name == "S")
+		/*if (p_cur_param.name == 'S')
 		{
 			if (p_cur_param.value_type == 'F')
 				s = p_cur_param.double_value;
 		}
 		else */
-		if (p_cur_param.name == "P")
+		if (p_cur_param.name == 'P')
 		{
 			has_p = true;
 			if (p_cur_param.value_type == 'L')
@@ -995,7 +1019,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_p = false;
 		}
-		else if (p_cur_param.name == "X")
+		else if (p_cur_param.name == 'X')
 		{
 			has_x = true;
 			if (p_cur_param.value_type == 'F')
@@ -1003,7 +1027,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_x = false;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			has_y = true;
 			if (p_cur_param.value_type == 'F')
@@ -1011,7 +1035,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_y = false;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			has_z = true;
 			if (p_cur_param.value_type == 'F')
@@ -1075,11 +1099,11 @@ void gcode_position::process_g28(position* pos, parsed_command& cmd)
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		if (p_cur_param.name == 'X')
 			has_x = true;
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 			has_y = true;
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 			has_z = true;
 	}
 	if (has_x)
@@ -1179,27 +1203,27 @@ void gcode_position::process_g92(position* pos, parsed_command& cmd)
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		if (p_cur_param.name == 'X')
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "E")
+		else if (p_cur_param.name == 'E')
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			update_z = true;
 			z = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "O")
+		else if (p_cur_param.name == 'O')
 		{
 			o_exists = true;
 		}
@@ -1312,7 +1336,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 	{
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
 		
-		if (p_cur_param.name == "T")
+		if (p_cur_param.name == 'T')
 		{
 			has_t = true;
 			if (p_cur_param.value_type == 'L')
@@ -1329,7 +1353,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 				has_t = false;
 
 		}
-		else if (p_cur_param.name == "X")
+		else if (p_cur_param.name == 'X')
 		{
 			has_x = true;
 			if (p_cur_param.value_type == 'F')
@@ -1337,7 +1361,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 			else
 				has_x = false;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			has_y = true;
 			if (p_cur_param.value_type == 'F')
@@ -1345,7 +1369,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 			else
 				has_y = false;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			has_z = true;
 			if (p_cur_param.value_type == 'F')
@@ -1391,7 +1415,7 @@ void gcode_position::process_t(position* pos, parsed_command& cmd)
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "T" && p_cur_param.value_type == 'U')
+		if (p_cur_param.name == 'T' && p_cur_param.value_type == 'U')
 		{
 			pos->current_tool = static_cast<int>(p_cur_param.unsigned_long_value);
 			if (!zero_based_extruder_)
@@ -1415,4 +1439,24 @@ void gcode_position::process_t(position* pos, parsed_command& cmd)
 gcode_comment_processor* gcode_position::get_gcode_comment_processor()
 {
 	return &comment_processor_;
-}
\ No newline at end of file
+}
+
+void gcode_position::reset()
+{
+	cur_pos_ = -1;
+	num_pos_ = 0;
+	for (int index = 0; index < position_buffer_size_; index++)
+	{
+		add_position(initial_position_);
+	}
+	num_pos_ = 0;
+	comment_processor_ = gcode_comment_processor();
+}
+
+void gcode_position::reset_to(const position& pos, const gcode_comment_processor& comment_processor)
+{
+	cur_pos_ = 0;
+	positions_[0] = pos;
+	num_pos_ = 1;
+	comment_processor_ = comment_processor;
+}
@@ -24,7 +24,6 @@
 #define GCODE_POSITION_H
 #include <string>
 #include <vector>
-#include <map>
 #include "gcode_parser.h"
 #include "position.h"
 #include "gcode_comment_processor.h"
@@ -126,6 +125,8 @@ struct gcode_position_args {
 	void delete_y_firmware_offsets();
 };
 
+// Define GCODE_POSITION_LEAN to compile the layer, height, priming, z-hop and snapshot bounds tracking
+// (which is only used by Octolapse) out of position and update().
 class gcode_position
 {
 public:
@@ -146,13 +147,17 @@ public:
 	position * get_current_position_ptr();
 	position * get_previous_position_ptr();
 	gcode_comment_processor* get_gcode_comment_processor();
+	// Discards the position history and continues from the supplied state, as if it were the last update.
+	void reset_to(const position& pos, const gcode_comment_processor& comment_processor);
+	// Returns to the state the position was constructed in, keeping the position buffer.
+	void reset();
 private:
 	gcode_position(const gcode_position &source);
 	int position_buffer_size_;
 	position* positions_;
 	int cur_pos_;
 	int num_pos_;
-	void add_position(parsed_command &);
+	void add_position();
 	void add_position(position &);
 	bool autodetect_position_;
 	double priming_height_;
@@ -188,10 +193,7 @@ private:
 	bool shared_extruder_;
 	bool zero_based_extruder_;
 
-	std::map<std::string, pos_function_type> gcode_functions_;
-	std::map<std::string, pos_function_type>::iterator gcode_functions_iterator_;
-	
-	std::map<std::string, pos_function_type> get_gcode_functions();
+	static pos_function_type get_gcode_function(command_id id);
 	/// Process Gcode Command Functions
 	void process_g0_g1(position*, parsed_command&);
 	void process_g2(position*, parsed_command&);
@@ -213,6 +215,7 @@ private:
 	void process_t(position*, parsed_command&);
 
 	gcode_comment_processor comment_processor_;
+	position initial_position_;
 	void delete_retraction_lengths_();
 	void delete_z_lift_heights_();
 	void set_num_extruders(int num_extruders);
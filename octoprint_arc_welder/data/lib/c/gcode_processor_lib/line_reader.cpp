@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "line_reader.h"
+#ifdef LINE_READER_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <string.h>
+
+line_reader::line_reader()
+{
+	is_open_ = false;
+	is_memory_mapped_ = false;
+	file_size_ = 0;
+	position_ = 0;
+	p_map_ = NULL;
+}
+
+line_reader::line_reader(const line_reader &source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+line_reader::~line_reader()
+{
+	close();
+}
+
+bool line_reader::open(const std::string& file_path)
+{
+	close();
+	if (try_map_file(file_path))
+	{
+		is_memory_mapped_ = true;
+		is_open_ = true;
+		return true;
+	}
+
+	// Fall back to an ifstream.  Open in binary mode so that the byte offsets we report are exact.
+	file_.open(file_path.c_str(), std::ios::in | std::ios::binary);
+	if (!file_.is_open())
+	{
+		return false;
+	}
+	file_.seekg(0, std::ios::end);
+	file_size_ = static_cast<long long>(file_.tellg());
+	file_.seekg(0, std::ios::beg);
+	is_open_ = true;
+	return true;
+}
+
+void line_reader::close()
+{
+	unmap_file();
+	if (file_.is_open())
+	{
+		file_.close();
+	}
+	file_.clear();
+	line_.clear();
+	is_open_ = false;
+	is_memory_mapped_ = false;
+	file_size_ = 0;
+	position_ = 0;
+}
+
+bool line_reader::is_open() const
+{
+	return is_open_;
+}
+
+bool line_reader::is_memory_mapped() const
+{
+	return is_memory_mapped_;
+}
+
+const char * line_reader::get_mapped_data() const
+{
+	return is_memory_mapped_ ? p_map_ : NULL;
+}
+
+long long line_reader::get_file_size() const
+{
+	return file_size_;
+}
+
+long long line_reader::get_position() const
+{
+	return position_;
+}
+
+bool line_reader::seek(long long position)
+{
+	if (!is_open_ || position < 0 || position > file_size_)
+		return false;
+
+	if (!is_memory_mapped_)
+	{
+		// Clear any eof flag left by a previous read before moving
+		file_.clear();
+		file_.seekg(static_cast<std::streamoff>(position), std::ios::beg);
+		if (!file_)
+			return false;
+	}
+	position_ = position;
+	return true;
+}
+
+bool line_reader::get_line(const char ** p_p_line, int * p_length)
+{
+	if (!is_open_)
+		return false;
+
+	if (is_memory_mapped_)
+	{
+		if (position_ >= file_size_)
+			return false;
+
+		char * p_start = p_map_ + position_;
+		const size_t bytes_remaining = static_cast<size_t>(file_size_ - position_);
+		char * p_end = static_cast<char *>(memchr(p_start, '\n', bytes_remaining));
+		if (p_end == NULL)
+		{
+			// The final line has no line ending, so there is nothing within the mapping to terminate it.
+			// Copy it so that it is null terminated.
+			line_.assign(p_start, bytes_remaining);
+			position_ = file_size_;
+			*p_p_line = line_.c_str();
+			*p_length = static_cast<int>(line_.length());
+			return true;
+		}
+		*p_p_line = p_start;
+		*p_length = static_cast<int>(p_end - p_start);
+		position_ += (p_end - p_start) + 1;
+		return true;
+	}
+
+	if (!std::getline(file_, line_))
+		return false;
+
+	position_ += static_cast<long long>(line_.length()) + 1;
+	if (position_ > file_size_)
+	{
+		// The final line had no line ending
+		position_ = file_size_;
+	}
+	*p_p_line = line_.c_str();
+	*p_length = static_cast<int>(line_.length());
+	return true;
+}
+
+std::string line_reader::get_line_ending()
+{
+	bool is_crlf = false;
+	if (is_memory_mapped_)
+	{
+		const char * p_end = static_cast<const char *>(memchr(p_map_, '\n', static_cast<size_t>(file_size_)));
+		is_crlf = p_end != NULL && p_end > p_map_ && *(p_end - 1) == '\r';
+	}
+	else if (is_open_)
+	{
+		const long long position = position_;
+		std::string first_line;
+		file_.clear();
+		file_.seekg(0, std::ios::beg);
+		// A first line without a line feed is the whole file, which has no line ending to match
+		is_crlf = std::getline(file_, first_line) && !file_.eof() && !first_line.empty() && first_line[first_line.length() - 1] == '\r';
+		seek(position);
+	}
+	return is_crlf ? "\r\n" : "\n";
+}
+
+bool line_reader::try_map_file(const std::string& file_path)
+{
+#ifdef LINE_READER_USE_MMAP
+	int file_descriptor = ::open(file_path.c_str(), O_RDONLY);
+	if (file_descriptor < 0)
+		return false;
+
+	struct stat file_stat;
+	if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size <= 0)
+	{
+		// mmap cannot map an empty file, let the fallback handle it.
+		::close(file_descriptor);
+		return false;
+	}
+
+	void * p_map = mmap(NULL, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	// The mapping keeps its own reference to the file, so the descriptor is no longer needed.
+	::close(file_descriptor);
+	if (p_map == MAP_FAILED)
+		return false;
+
+	// We only ever read the file front to back, so let the kernel read ahead aggressively.
+	madvise(p_map, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL);
+	p_map_ = static_cast<char *>(p_map);
+	file_size_ = static_cast<long long>(file_stat.st_size);
+	position_ = 0;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void line_reader::unmap_file()
+{
+#ifdef LINE_READER_USE_MMAP
+	if (p_map_ != NULL)
+	{
+		munmap(p_map_, static_cast<size_t>(file_size_));
+	}
+#endif
+	p_map_ = NULL;
+}
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <string>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+// Memory map the source file where mmap is available.  Other platforms use the ifstream fallback.
+#define LINE_READER_USE_MMAP
+#endif
+
+// Reads a gcode file one line at a time.  When the file can be memory mapped, each line is returned as a span
+// that points directly into the mapping, so no copy is made.  Otherwise (or if the mapping fails) the file is read
+// with an ifstream.  Returned lines are terminated by '\n' or '\0', and the length never includes the terminator.
+// A returned line is only guaranteed to be valid until the next call to get_line.
+class line_reader
+{
+public:
+	line_reader();
+	virtual ~line_reader();
+	bool open(const std::string& file_path);
+	void close();
+	bool is_open() const;
+	bool is_memory_mapped() const;
+	// The whole file when it is memory mapped, otherwise NULL.  This is valid until the file is closed.
+	const char * get_mapped_data() const;
+	bool get_line(const char ** p_p_line, int * p_length);
+	// The line ending of the first line of the file, "\r\n" or "\n".  The read position is unchanged.
+	std::string get_line_ending();
+	long long get_file_size() const;
+	// The exact byte offset of the next unread line.
+	long long get_position() const;
+	// Moves to a byte offset, which must be the start of a line (a value returned by get_position).
+	bool seek(long long position);
+private:
+	line_reader(const line_reader &source);
+	bool try_map_file(const std::string& file_path);
+	void unmap_file();
+	std::ifstream file_;
+	std::string line_;
+	bool is_open_;
+	bool is_memory_mapped_;
+	long long file_size_;
+	long long position_;
+	char * p_map_;
+};
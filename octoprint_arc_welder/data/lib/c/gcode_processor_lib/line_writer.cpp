@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "line_writer.h"
+#include "utilities.h"
+#ifdef LINE_WRITER_USE_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include <string.h>
+
+line_writer::line_writer()
+{
+	buffer_size_ = LINE_WRITER_DEFAULT_BUFFER_SIZE;
+	p_buffer_ = new char[buffer_size_];
+	buffer_count_ = 0;
+	bytes_written_ = 0;
+	is_open_ = false;
+	has_error_ = false;
+	is_preallocated_ = false;
+	file_descriptor_ = -1;
+	line_ending_ = "\n";
+}
+
+line_writer::line_writer(int buffer_size)
+{
+	buffer_size_ = buffer_size > 0 ? buffer_size : LINE_WRITER_DEFAULT_BUFFER_SIZE;
+	p_buffer_ = new char[buffer_size_];
+	buffer_count_ = 0;
+	bytes_written_ = 0;
+	is_open_ = false;
+	has_error_ = false;
+	is_preallocated_ = false;
+	file_descriptor_ = -1;
+	line_ending_ = "\n";
+}
+
+line_writer::line_writer(const line_writer &source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+line_writer::~line_writer()
+{
+	close();
+	delete[] p_buffer_;
+}
+
+bool line_writer::open(const std::string& file_path, long long predicted_size)
+{
+	close();
+	buffer_count_ = 0;
+	bytes_written_ = 0;
+	has_error_ = false;
+	is_preallocated_ = false;
+#ifdef LINE_WRITER_USE_POSIX
+	file_descriptor_ = ::open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (file_descriptor_ < 0)
+	{
+		return false;
+	}
+#ifdef FALLOC_FL_KEEP_SIZE
+	if (predicted_size > 0)
+	{
+		// Reserve the space without changing the file size.  Any unused space is released when the file is closed.
+		// This is only an optimization, so a failure (unsupported file system, etc) is ignored.
+		is_preallocated_ = fallocate(file_descriptor_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(predicted_size)) == 0;
+	}
+#endif
+#else
+	// Binary mode, so that the line ending isn't translated
+	file_.open(file_path.c_str(), std::ios::out | std::ios::binary);
+	if (!file_.is_open())
+	{
+		return false;
+	}
+#endif
+	is_open_ = true;
+	return true;
+}
+
+bool line_writer::close()
+{
+	if (!is_open_)
+		return !has_error_;
+
+	flush();
+#ifdef LINE_WRITER_USE_POSIX
+	if (is_preallocated_)
+	{
+		// Release any reserved space beyond the end of the file
+		if (ftruncate(file_descriptor_, static_cast<off_t>(bytes_written_)) != 0)
+			has_error_ = true;
+	}
+	if (::close(file_descriptor_) != 0)
+		has_error_ = true;
+	file_descriptor_ = -1;
+#else
+	file_.close();
+	if (file_.fail())
+		has_error_ = true;
+#endif
+	is_open_ = false;
+	return !has_error_;
+}
+
+bool line_writer::is_open() const
+{
+	return is_open_;
+}
+
+bool line_writer::has_error() const
+{
+	return has_error_;
+}
+
+long long line_writer::get_bytes_written() const
+{
+	return bytes_written_ + buffer_count_;
+}
+
+void line_writer::write_line(const std::string& text)
+{
+	write_line(text.c_str(), static_cast<int>(text.length()));
+}
+
+void line_writer::write_line(const char * text, int length)
+{
+	append(text, length);
+	append(line_ending_.c_str(), static_cast<int>(line_ending_.length()));
+}
+
+void line_writer::set_line_ending(const std::string& line_ending)
+{
+	line_ending_ = line_ending;
+}
+
+void line_writer::write_trimmed_line(const char * text, int length)
+{
+	int start = 0;
+	while (start < length && utilities::is_whitespace(text[start]))
+	{
+		start++;
+	}
+	int end = length;
+	while (end > start && utilities::is_whitespace(text[end - 1]))
+	{
+		end--;
+	}
+	write_line(text + start, end - start);
+}
+
+void line_writer::write(const char * text, int length)
+{
+	append(text, length);
+}
+
+void line_writer::append(const char * text, int length)
+{
+	if (buffer_count_ + length > buffer_size_)
+	{
+		flush();
+		if (length > buffer_size_)
+		{
+			// This will never fit in the buffer, write it directly.
+			write_to_file(text, length);
+			return;
+		}
+	}
+	memcpy(p_buffer_ + buffer_count_, text, length);
+	buffer_count_ += length;
+}
+
+bool line_writer::flush()
+{
+	if (buffer_count_ == 0)
+		return !has_error_;
+	bool success = write_to_file(p_buffer_, buffer_count_);
+	buffer_count_ = 0;
+	return success;
+}
+
+bool line_writer::write_to_file(const char * text, int length)
+{
+	if (!is_open_ || has_error_)
+	{
+		has_error_ = true;
+		return false;
+	}
+#ifdef LINE_WRITER_USE_POSIX
+	while (length > 0)
+	{
+		ssize_t written = ::write(file_descriptor_, text, static_cast<size_t>(length));
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			has_error_ = true;
+			return false;
+		}
+		text += written;
+		length -= static_cast<int>(written);
+		bytes_written_ += written;
+	}
+#else
+	file_.write(text, length);
+	if (file_.fail())
+	{
+		has_error_ = true;
+		return false;
+	}
+	bytes_written_ += length;
+#endif
+	return true;
+}
@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <string>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+// Write the output with write(2) where it is available.  Other platforms use the ofstream fallback.
+#define LINE_WRITER_USE_POSIX
+#endif
+
+// The default size of the output buffer (2MB).  The buffer is written to disk in a single call whenever it fills.
+#define LINE_WRITER_DEFAULT_BUFFER_SIZE 2097152
+
+// Writes lines to a file through a large append buffer, so that many thousands of lines are written with a
+// single system call.  If a predicted output size is supplied, the disk space is reserved up front on platforms
+// that support fallocate.
+class line_writer
+{
+public:
+	line_writer();
+	line_writer(int buffer_size);
+	virtual ~line_writer();
+	bool open(const std::string& file_path, long long predicted_size);
+	bool close();
+	bool is_open() const;
+	bool has_error() const;
+	// Appends the text followed by a line ending.
+	void write_line(const char * text, int length);
+	void write_line(const std::string& text);
+	// Appends the text without any leading or trailing whitespace, followed by a line ending.
+	void write_trimmed_line(const char * text, int length);
+	// Sets the line ending appended by write_line, "\n" by default.
+	void set_line_ending(const std::string& line_ending);
+	// Appends the text exactly as it is.
+	void write(const char * text, int length);
+	bool flush();
+	long long get_bytes_written() const;
+private:
+	line_writer(const line_writer &source);
+	void append(const char * text, int length);
+	bool write_to_file(const char * text, int length);
+	char * p_buffer_;
+	int buffer_size_;
+	int buffer_count_;
+	long long bytes_written_;
+	bool is_open_;
+	bool has_error_;
+	bool is_preallocated_;
+	int file_descriptor_;
+	std::ofstream file_;
+	std::string line_ending_;
+};
@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "number_formatter.h"
+#include <math.h>
+#include <stdio.h>
+#include <cmath>
+
+// Scaled values must stay well below 2^53, so that the rounded integer and the tie check are exact.
+#define NUMBER_FORMATTER_MAX_FAST_VALUE 1e15
+// The multiply is off by at most half an ulp (2^-53 relative), so anything this close to a tie is ambiguous.
+#define NUMBER_FORMATTER_TIE_TOLERANCE 1e-15
+// The fast path never writes more than a sign, 16 digits, a point and a null, nor does an unsigned long need more
+#define NUMBER_FORMATTER_FAST_LENGTH 32
+static const double powers_of_ten[NUMBER_FORMATTER_MAX_PRECISION + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+static const unsigned long long integer_powers_of_ten[NUMBER_FORMATTER_MAX_PRECISION + 1] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+number_formatter::number_formatter()
+{
+}
+
+int number_formatter::format_fixed(char * p_buffer, double value, int precision)
+{
+	if (precision < 0 || precision > NUMBER_FORMATTER_MAX_PRECISION)
+		return format_slow(p_buffer, value, precision);
+
+	const bool neg = std::signbit(value);
+	const double scaled = (neg ? -value : value) * powers_of_ten[precision];
+	// This also catches NaN and infinity
+	if (!(scaled < NUMBER_FORMATTER_MAX_FAST_VALUE))
+		return format_slow(p_buffer, value, precision);
+
+	const double whole = floor(scaled);
+	// The scaled value is below 2^53, so this is exact
+	const double fraction = scaled - whole;
+	if (fabs(fraction - 0.5) <= scaled * NUMBER_FORMATTER_TIE_TOLERANCE)
+		return format_slow(p_buffer, value, precision);
+
+	unsigned long long digits = static_cast<unsigned long long>(whole);
+	if (fraction > 0.5)
+		digits++;
+
+	// Write the digits backwards, starting with the fraction
+	char reversed[NUMBER_FORMATTER_FAST_LENGTH];
+	int length = 0;
+	for (int index = 0; index < precision; index++)
+	{
+		reversed[length++] = static_cast<char>('0' + digits % 10);
+		digits /= 10;
+	}
+	if (precision > 0)
+		reversed[length++] = '.';
+	do
+	{
+		reversed[length++] = static_cast<char>('0' + digits % 10);
+		digits /= 10;
+	} while (digits > 0);
+	// Printf keeps the sign of negative numbers that round to zero
+	if (neg)
+		reversed[length++] = '-';
+
+	for (int index = 0; index < length; index++)
+	{
+		p_buffer[index] = reversed[length - 1 - index];
+	}
+	p_buffer[length] = '\0';
+	return length;
+}
+
+void number_formatter::append_fixed(std::string& target, double value, int precision)
+{
+	char buffer[NUMBER_FORMATTER_MAX_LENGTH];
+	target.append(buffer, format_fixed(buffer, value, precision));
+}
+
+void number_formatter::append_compact(std::string& target, double value, int precision)
+{
+	char buffer[NUMBER_FORMATTER_MAX_LENGTH];
+	int end = format_fixed(buffer, value, precision);
+	if (end == 0)
+		return;
+	int start = buffer[0] == '-' ? 1 : 0;
+	bool has_point = false;
+	for (int index = start; index < end; index++)
+	{
+		if (buffer[index] == '.')
+		{
+			has_point = true;
+			break;
+		}
+	}
+	if (has_point)
+	{
+		while (buffer[end - 1] == '0')
+			end--;
+		if (buffer[end - 1] == '.')
+			end--;
+	}
+	if (end - start == 1 && buffer[start] == '0')
+	{
+		// Zero, which may have been negative
+		target.push_back('0');
+		return;
+	}
+	if (start == 1)
+		target.push_back('-');
+	if (buffer[start] == '0' && buffer[start + 1] == '.')
+		start++;
+	target.append(buffer + start, end - start);
+}
+
+void number_formatter::append_parameter(std::string& target, char name, double value, int precision, bool compact)
+{
+	if (compact)
+	{
+		target.push_back(name);
+		append_compact(target, value, precision);
+		return;
+	}
+	target.push_back(' ');
+	target.push_back(name);
+	append_fixed(target, value, precision);
+}
+
+void number_formatter::append_unsigned(std::string& target, unsigned long value)
+{
+	char reversed[NUMBER_FORMATTER_FAST_LENGTH];
+	int length = 0;
+	do
+	{
+		reversed[length++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+	while (length > 0)
+	{
+		target.push_back(reversed[--length]);
+	}
+}
+
+int number_formatter::get_parameter_precision(char parameter_name)
+{
+	if (parameter_name == 'E')
+		return GCODE_E_PRECISION;
+	if (parameter_name == 'F')
+		return GCODE_F_PRECISION;
+	return GCODE_COORDINATE_PRECISION;
+}
+
+int number_formatter::format_slow(char * p_buffer, double value, int precision)
+{
+	int length = snprintf(p_buffer, NUMBER_FORMATTER_MAX_LENGTH, "%.*f", precision, value);
+	if (length < 0)
+	{
+		p_buffer[0] = '\0';
+		return 0;
+	}
+	return length < NUMBER_FORMATTER_MAX_LENGTH ? length : NUMBER_FORMATTER_MAX_LENGTH - 1;
+}
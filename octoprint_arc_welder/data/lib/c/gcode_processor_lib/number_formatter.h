@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <string>
+
+// The number of decimal places written for each kind of gcode parameter
+#define GCODE_COORDINATE_PRECISION 3
+#define GCODE_E_PRECISION 5
+#define GCODE_F_PRECISION 0
+// The largest precision number_formatter accepts
+#define NUMBER_FORMATTER_MAX_PRECISION 9
+// The longest number format_fixed can write, including the terminating null (DBL_MAX has 309 integer digits).
+#define NUMBER_FORMATTER_MAX_LENGTH 328
+
+// Formats gcode numbers with a fixed number of decimal places.  The result is always exactly what printf("%.*f")
+// produces, but without the cost of parsing a format string or building a stream.
+//
+// The value is scaled by a power of ten and rounded to an integer, which is then written digit by digit.  Printf
+// rounds the exact binary value, so when the scaled value is too close to a tie for the rounding of the multiply to
+// be ruled out, or too large to hold as an integer, the number is handed to snprintf.
+class number_formatter
+{
+public:
+	// Writes the number and a terminating null, returning the number of characters written (without the null).
+	// The buffer must hold NUMBER_FORMATTER_MAX_LENGTH characters.
+	static int format_fixed(char * p_buffer, double value, int precision);
+	// Appends the number to the target.  Nothing is allocated unless the target has to grow.
+	static void append_fixed(std::string& target, double value, int precision);
+	// Appends the number as append_fixed would, then removes the trailing zeros, the decimal point if nothing follows
+	// it, and the zero before the point.  For example 10.500 becomes 10.5, -0.250 becomes -.25 and -0.000 becomes 0.
+	static void append_compact(std::string& target, double value, int precision);
+	// Appends a parameter, such as " X10.500".  Compact parameters have no leading space and use append_compact.
+	static void append_parameter(std::string& target, char name, double value, int precision, bool compact);
+	static void append_unsigned(std::string& target, unsigned long value);
+	// The precision used when writing the parameter (E, F, or any coordinate)
+	static int get_parameter_precision(char parameter_name);
+private:
+	number_formatter();
+	static int format_slow(char * p_buffer, double value, int precision);
+};
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "number_parser.h"
+#include <stdlib.h>
+#include <string>
+
+// The largest integer where every smaller integer is exactly representable as a double
+#define NUMBER_PARSER_MAX_EXACT_MANTISSA 9007199254740992ULL
+// The number of decimal digits that always fit into an unsigned 64 bit integer
+#define NUMBER_PARSER_MAX_DIGITS 19
+// 1e22 is the largest power of ten that is exactly representable as a double
+#define NUMBER_PARSER_MAX_EXACT_POWER 22
+static const double exact_powers_of_ten[NUMBER_PARSER_MAX_EXACT_POWER + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+number_parser::number_parser()
+{
+}
+
+bool number_parser::try_extract_double(const char ** p_p_gcode, double * p_double)
+{
+	const char * p = *p_p_gcode;
+	bool neg = false;
+	unsigned long long mantissa = 0;
+	int num_digits = 0;
+	int num_fraction_digits = 0;
+	// skip any leading whitespace
+	while (*p == ' ')
+		++p;
+	// Check for negative sign
+	if (*p == '-') {
+		neg = true;
+		++p;
+		while (*p == ' ')
+			++p;
+	}
+	else if (*p == '+') {
+		// Positive sign doesn't affect anything since we assume positive
+		++p;
+		while (*p == ' ')
+			++p;
+	}
+	const char * p_start = p;
+
+	// The mantissa will overflow if there are more than NUMBER_PARSER_MAX_DIGITS digits, but then the slow path is used.
+	while ((*p >= '0' && *p <= '9') || *p == ' ') {
+		if (*p != ' ')
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			++num_digits;
+		}
+		++p;
+	}
+	if (*p == '.') {
+		++p;
+		while ((*p >= '0' && *p <= '9') || *p == ' ') {
+			if (*p != ' ')
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				++num_fraction_digits;
+			}
+			++p;
+		}
+		num_digits += num_fraction_digits;
+	}
+	if (num_digits == 0)
+	{
+		return false;
+	}
+
+	double r;
+	if (
+		num_digits <= NUMBER_PARSER_MAX_DIGITS &&
+		mantissa <= NUMBER_PARSER_MAX_EXACT_MANTISSA &&
+		num_fraction_digits <= NUMBER_PARSER_MAX_EXACT_POWER
+	)
+	{
+		// Both values are exact, so the division is correctly rounded.
+		r = static_cast<double>(static_cast<long long>(mantissa));
+		if (num_fraction_digits > 0)
+			r /= exact_powers_of_ten[num_fraction_digits];
+		if (neg)
+			r = -r;
+	}
+	else
+	{
+		r = parse_slow(p_start, p, neg);
+	}
+	*p_double = r;
+	*p_p_gcode = p;
+	return true;
+}
+
+double number_parser::parse_slow(const char * p_start, const char * p_end, const bool neg)
+{
+	// Remove the spaces and the decimal point, and let strtod deal with the rounding.  Using an exponent
+	// rather than a decimal point keeps the result independent of the current locale.
+	std::string number;
+	number.reserve(p_end - p_start + 16);
+	if (neg)
+		number.push_back('-');
+	int exponent = 0;
+	bool is_fraction = false;
+	for (const char * p = p_start; p < p_end; p++)
+	{
+		if (*p == '.')
+			is_fraction = true;
+		else if (*p != ' ')
+		{
+			number.push_back(*p);
+			if (is_fraction)
+				exponent--;
+		}
+	}
+	number.push_back('e');
+	number.append(std::to_string(exponent));
+	return strtod(number.c_str(), NULL);
+}
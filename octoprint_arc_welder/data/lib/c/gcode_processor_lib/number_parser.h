@@ -0,0 +1,39 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// Parses gcode numbers.  Gcode allows spaces anywhere within a number (X 1 2. 5 is X12.5), so the standard
+// library functions can't be used directly.
+//
+// Digits are accumulated into a 64 bit integer.  When the integer fits in the 53 bit double mantissa and there are
+// no more than 22 decimal places (which is nearly always the case for gcode), a single divide by an exact power of
+// ten gives the correctly rounded result.  Anything else is handed to strtod.
+class number_parser
+{
+public:
+	// Extracts a double, advancing *p_p_gcode past the number (and any trailing spaces) only if one is found.
+	static bool try_extract_double(const char ** p_p_gcode, double * p_double);
+private:
+	number_parser();
+	static double parse_slow(const char * p_start, const char * p_end, bool neg);
+};
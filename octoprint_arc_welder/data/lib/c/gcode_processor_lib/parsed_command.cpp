@@ -21,84 +21,211 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "parsed_command.h"
-#include <sstream>
-#include <iomanip>
+#include "number_formatter.h"
 #include <stdlib.h>
 parsed_command::parsed_command()
 {
-	
-	command.reserve(8);
-	gcode.reserve(128);
-	comment.reserve(128);
+	line.reserve(128);
 	parameters.reserve(6);
+	source_position = 0;
+	source_length = 0;
+	id = command_id_unknown;
 	is_known_command = false;
 	is_empty = true;
 }
 
 void parsed_command::clear()
 {
-	
-	command.clear();
-	gcode.clear();
-	comment.clear();
+	line.clear();
+	source_position = 0;
+	source_length = 0;
+	command_span = text_span();
+	gcode_span = text_span();
+	comment_span = text_span();
+	appended_comment_.clear();
 	parameters.clear();
+	id = command_id_unknown;
 	is_known_command = false;
 	is_empty = true;
 }
 
-std::string parsed_command::rewrite_gcode_string()
+std::string parsed_command::get_command() const
+{
+	// Commands are upper case and contain no spaces
+	std::string command;
+	const char* p = line.c_str() + command_span.offset;
+	const char* p_end = p + command_span.length;
+	for (; p < p_end; p++)
+	{
+		if (*p == ' ')
+			continue;
+		if (*p >= 'a' && *p <= 'z')
+			command.push_back(*p - 32);
+		else
+			command.push_back(*p);
+	}
+	return command;
+}
+
+std::string parsed_command::get_gcode() const
 {
-	std::stringstream stream;
+	// The span starts and ends with a printable character.  Remove any control characters and make it upper case.
+	std::string gcode;
+	gcode.reserve(gcode_span.length);
+	const char* p = line.c_str() + gcode_span.offset;
+	const char* p_end = p + gcode_span.length;
+	for (; p < p_end; p++)
+	{
+		char cur_char = *p;
+		if (cur_char > 32 || cur_char == ' ')
+		{
+			if (cur_char >= 'a' && cur_char <= 'z')
+				gcode.push_back(cur_char - 32);
+			else
+				gcode.push_back(cur_char);
+		}
+	}
+	return gcode;
+}
+
+std::string parsed_command::get_comment() const
+{
+	std::string comment;
+	append_comment_to(comment);
+	return comment;
+}
+
+void parsed_command::append_comment_to(std::string& target) const
+{
+	const char* p = line.c_str() + comment_span.offset;
+	const char* p_end = p + comment_span.length;
+	for (; p < p_end; p++)
+	{
+		// Dont't add line breaks
+		if (*p != '\r')
+			target.push_back(*p);
+	}
+	target.append(appended_comment_);
+}
+
+std::string parsed_command::get_string_value(const parsed_command_parameter& parameter) const
+{
+	return line.substr(parameter.string_value.offset, parameter.string_value.length);
+}
+
+bool parsed_command::is_command(const char* command_name) const
+{
+	const char* p = line.c_str() + command_span.offset;
+	const char* p_end = p + command_span.length;
+	for (; p < p_end; p++)
+	{
+		if (*p == ' ')
+			continue;
+		char cur_char = *p;
+		if (cur_char >= 'a' && cur_char <= 'z')
+			cur_char -= 32;
+		if (cur_char != *command_name)
+			return false;
+		command_name++;
+	}
+	return *command_name == '\0';
+}
+
+bool parsed_command::comment_equals(const char* text) const
+{
+	if (appended_comment_.length() > 0)
+		return get_comment() == text;
+
+	const char* p = line.c_str() + comment_span.offset;
+	const char* p_end = p + comment_span.length;
+	for (; p < p_end; p++)
+	{
+		if (*p == '\r')
+			continue;
+		if (*p != *text)
+			return false;
+		text++;
+	}
+	return *text == '\0';
+}
+
+bool parsed_command::has_gcode() const
+{
+	return gcode_span.length > 0;
+}
+
+void parsed_command::append_comment(const std::string& text)
+{
+	appended_comment_.append(text);
+}
+
+bool parsed_command::is_verbatim() const
+{
+	return source_length > 0 && appended_comment_.length() == 0;
+}
+
+std::string parsed_command::rewrite_gcode_string(bool compact)
+{
+	std::string gcode;
+	gcode.reserve(line.length() + PARSED_COMMAND_REWRITE_EXTRA_LENGTH);
 	
 	// add command
-	stream << command;
-	if (parameters.size() > 0)
+	gcode.append(get_command());
+	for (unsigned int index = 0; index < parameters.size(); index++)
 	{
-		for (unsigned int index = 0; index < parameters.size(); index++)
+		const parsed_command_parameter& p = parameters[index];
+		if (p.value_type == 'F' && p.name != '\0')
 		{
-			parsed_command_parameter p = parameters[index];
-			
-			if (p.name == "E")
-			{
-				stream << std::fixed << std::setprecision(5);
-			}
-			else if (p.name == "F")
+			number_formatter::append_parameter(gcode, p.name, p.double_value, number_formatter::get_parameter_precision(p.name), compact);
+			continue;
+		}
+		// Anything but a named number keeps its separator
+		gcode.push_back(' ');
+		if (p.name != '\0')
+		{
+			gcode.push_back(p.name);
+		}
+		switch (p.value_type)
+		{
+		case 'S':
+			if (p.name == 'T' || (p.name == '\0' && id == command_id_at_octolapse))
 			{
-				stream << std::fixed << std::setprecision(0);
+				// T parameters and octolapse parameter names are upper case
+				const char* p_value = line.c_str() + p.string_value.offset;
+				for (int char_index = 0; char_index < p.string_value.length; char_index++)
+				{
+					char cur_char = p_value[char_index];
+					gcode.push_back(static_cast<char>(cur_char >= 'a' && cur_char <= 'z' ? cur_char - 32 : cur_char));
+				}
 			}
 			else
 			{
-				stream << std::fixed << std::setprecision(3);
-			}
-			
-			stream << " " << p.name;
-			switch (p.value_type)
-			{
-			case 'S':
-				stream << p.string_value;
-				break;
-			case 'F':
-				stream << p.double_value;
-				break;
-			case 'U':
-				stream << p.unsigned_long_value;
-				break;
+				gcode.append(line.c_str() + p.string_value.offset, p.string_value.length);
 			}
+			break;
+		case 'F':
+			number_formatter::append_fixed(gcode, p.double_value, number_formatter::get_parameter_precision(p.name));
+			break;
+		case 'U':
+			number_formatter::append_unsigned(gcode, p.unsigned_long_value);
+			break;
 		}
 	}
-	if (comment.size() > 0)
+	if (comment_span.length > 0 || appended_comment_.length() > 0)
 	{
-		stream << ";" << comment;
+		gcode.push_back(';');
+		append_comment_to(gcode);
 	}
-	return stream.str();
+	return gcode;
 }
 
 std::string parsed_command::to_string()
 {
-	if (comment.size() > 0)
+	std::string gcode = get_gcode();
+	if (comment_span.length > 0 || appended_comment_.length() > 0)
 	{
-		return gcode + ";" + comment;
+		gcode.push_back(';');
+		append_comment_to(gcode);
 	}
 	return gcode;
 }
-
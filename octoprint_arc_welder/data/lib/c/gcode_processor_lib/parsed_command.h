@@ -25,20 +25,87 @@
 #include <string>
 #include <vector>
 #include "parsed_command_parameter.h"
+// Room for the rewritten numbers to be longer than the source line, so the rewrite rarely grows its string
+#define PARSED_COMMAND_REWRITE_EXTRA_LENGTH 16
+
+// Commands are identified once by the parser.  Only commands that have parameters parsed have an id,
+// any other valid command is command_id_unparsed.
+enum command_id
+{
+	command_id_unknown,
+	command_id_unparsed,
+	command_id_g0,
+	command_id_g1,
+	command_id_g2,
+	command_id_g3,
+	command_id_g10,
+	command_id_g11,
+	command_id_g20,
+	command_id_g21,
+	command_id_g28,
+	command_id_g29,
+	command_id_g80,
+	command_id_g90,
+	command_id_g91,
+	command_id_g92,
+	command_id_m82,
+	command_id_m83,
+	command_id_m104,
+	command_id_m105,
+	command_id_m106,
+	command_id_m109,
+	command_id_m114,
+	command_id_m116,
+	command_id_m140,
+	command_id_m141,
+	command_id_m190,
+	command_id_m191,
+	command_id_m207,
+	command_id_m208,
+	command_id_m218,
+	command_id_m240,
+	command_id_m400,
+	command_id_m563,
+	command_id_t,
+	command_id_at_octolapse
+};
 
 struct parsed_command
 {
 public:
 	parsed_command();
-	std::string command;
-	std::string gcode;
-	std::string comment;
+	// A copy of the source line.  The command, gcode and comment are spans within this buffer,
+	// and are only normalized into strings when they are requested.
+	std::string line;
+	// Where the line came from in the source file, including its line ending.  The length is 0 if the command
+	// wasn't read from the source, for example an arc created by the welder.
+	long long source_position;
+	int source_length;
+	text_span command_span;
+	text_span gcode_span;
+	text_span comment_span;
+	command_id id;
 	bool is_empty;
 	bool is_known_command;
 	std::vector<parsed_command_parameter> parameters;
 	void clear();
+	std::string get_command() const;
+	std::string get_gcode() const;
+	std::string get_comment() const;
+	std::string get_string_value(const parsed_command_parameter& parameter) const;
+	bool is_command(const char* command_name) const;
+	bool comment_equals(const char* text) const;
+	bool has_gcode() const;
+	void append_comment(const std::string& text);
+	// True if the command can be written by copying its source line
+	bool is_verbatim() const;
 	std::string to_string();
-	std::string rewrite_gcode_string();
+	// Rebuilds the command from its parameters.  Compact commands have no spaces and use the shortest numbers.
+	std::string rewrite_gcode_string(bool compact);
+private:
+	// Text appended to the comment after parsing, for example by the arc welder.
+	std::string appended_comment_;
+	void append_comment_to(std::string& target) const;
 };
 
-#endif
\ No newline at end of file
+#endif
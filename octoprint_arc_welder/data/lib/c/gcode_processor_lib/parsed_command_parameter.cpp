@@ -24,25 +24,27 @@
 #include "parsed_command.h"
 parsed_command_parameter::parsed_command_parameter()
 {
+	name = '\0';
 	value_type = 'N';
-	name.reserve(1);
+	double_value = 0;
+	unsigned_long_value = 0;
 }
 
-parsed_command_parameter::parsed_command_parameter(const std::string name, double value) : name(name), double_value(value)
+parsed_command_parameter::parsed_command_parameter(const char name, double value) : name(name), double_value(value)
 {
 	value_type = 'F';
+	unsigned_long_value = 0;
 }
 
-parsed_command_parameter::parsed_command_parameter(const std::string name, const std::string value) : name(name), string_value(value)
+parsed_command_parameter::parsed_command_parameter(const char name, const text_span value) : name(name), string_value(value)
 {
 	value_type = 'S';
+	double_value = 0;
+	unsigned_long_value = 0;
 }
 
-parsed_command_parameter::parsed_command_parameter(const std::string name, const unsigned long value) : name(name), unsigned_long_value(value)
+parsed_command_parameter::parsed_command_parameter(const char name, const unsigned long value) : name(name), unsigned_long_value(value)
 {
 	value_type = 'U';
-}
-parsed_command_parameter::~parsed_command_parameter()
-{
-
+	double_value = 0;
 }
@@ -22,20 +22,29 @@
 
 #ifndef PARSED_COMMAND_PARAMETER_H
 #define PARSED_COMMAND_PARAMETER_H
-#include <string>
+// The location of some text within a parsed_command's line buffer.
+struct text_span
+{
+	text_span() : offset(0), length(0) {}
+	text_span(int offset, int length) : offset(offset), length(length) {}
+	int offset;
+	int length;
+};
+
 struct parsed_command_parameter
 {
 public:
 	parsed_command_parameter();
-	~parsed_command_parameter();
-	parsed_command_parameter(std::string name, double value);
-	parsed_command_parameter(std::string name, std::string value);
-	parsed_command_parameter(std::string name, unsigned long value);
-	std::string name;
+	parsed_command_parameter(char name, double value);
+	parsed_command_parameter(char name, text_span value);
+	parsed_command_parameter(char name, unsigned long value);
+	// The upper case parameter letter, or '\0' for text only parameters.
+	char name;
 	char value_type;
 	double double_value;
 	unsigned long unsigned_long_value;
-	std::string string_value;
+	// String values are not copied, use parsed_command::get_string_value to materialize them.
+	text_span string_value;
 };
 
 #endif
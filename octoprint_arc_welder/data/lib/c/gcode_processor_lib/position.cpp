@@ -24,20 +24,20 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
-std::string position::to_string(bool rewrite, bool verbose, std::string additional_comment)
+std::string position::to_string(parsed_command& command, bool rewrite, bool verbose, std::string additional_comment)
 {
 	if (verbose)
 	{
 		std::stringstream stream;
 		stream << std::fixed << std::setprecision(5);
 		stream << "," << get_current_extruder().e << "," << get_current_extruder().get_offset_e() << "," << get_current_extruder().e_relative;
-		command.comment.append(stream.str());
+		command.append_comment(stream.str());
 	}
-	command.comment.append(additional_comment);
+	command.append_comment(additional_comment);
 
 	if (rewrite)
 	{
-		return command.rewrite_gcode_string();
+		return command.rewrite_gcode_string(false);
 	}
 	
 	return command.to_string();
@@ -89,6 +89,7 @@ void position::set_units_default(const std::string&	units_default)
 	}
 }
 
+#ifndef GCODE_POSITION_LEAN
 bool position::can_take_snapshot()
 {
 	return (
@@ -99,10 +100,10 @@ bool position::can_take_snapshot()
 		!is_metric_null
 	);
 }
+#endif
 
 position::position()
 {
-	has_been_deleted = false;
 	is_empty = true;
 	feature_type_tag = 0;
 	f = 0;
@@ -128,6 +129,13 @@ position::position()
 	is_extruder_relative_null = true;
 	is_metric = true;
 	is_metric_null = true;
+	has_xy_position_changed = false;
+	has_position_changed = false;
+	file_line_number = -1;
+	gcode_number = -1;
+	file_position = -1;
+	gcode_ignored = true;
+#ifndef GCODE_POSITION_LEAN
 	last_extrusion_height = 0;
 	last_extrusion_height_null = true;
 	layer = 0;
@@ -145,23 +153,15 @@ position::position()
 	is_height_increment_change = false;
 	is_xy_travel = false;
 	is_xyz_travel = false;
-	has_xy_position_changed = false;
-	has_position_changed = false;
 	has_received_home_command = false;
-	file_line_number = -1;
-	gcode_number = -1;
-	file_position = -1;
-	gcode_ignored = true;
 	is_in_bounds = true;
+#endif
 	current_tool = -1;
-	p_extruders = NULL;
-	num_extruders = 0;
-	set_num_extruders(num_extruders);
+	num_extruders = 1;
 }
 
 position::position(int extruder_count)
 { 
-	has_been_deleted = false;
 	is_empty = true;
 	feature_type_tag = 0;
 	f = 0;
@@ -187,6 +187,13 @@ position::position(int extruder_count)
 	is_extruder_relative_null = true;
 	is_metric = true;
 	is_metric_null = true;
+	has_xy_position_changed = false;
+	has_position_changed = false;
+	file_line_number = -1;
+	gcode_number = -1;
+	file_position = -1;
+	gcode_ignored = true;
+#ifndef GCODE_POSITION_LEAN
 	last_extrusion_height = 0;
 	last_extrusion_height_null = true;
 	layer = 0;
@@ -204,23 +211,17 @@ position::position(int extruder_count)
 	is_height_increment_change = false;
 	is_xy_travel = false;
 	is_xyz_travel = false;
-	has_xy_position_changed = false;
-	has_position_changed = false;
 	has_received_home_command = false;
-	file_line_number = -1;
-	gcode_number = -1;
-	file_position = -1;
-	gcode_ignored = true;
 	is_in_bounds = true;
+#endif
 	current_tool = 0;
-	p_extruders = NULL;
+	num_extruders = 1;
 	set_num_extruders(extruder_count);
 	
 }
 
 position::position(const position &pos)
 {
-	has_been_deleted = false;
 	is_empty = pos.is_empty;
 	feature_type_tag = pos.feature_type_tag;
 	f = pos.f;
@@ -246,6 +247,13 @@ position::position(const position &pos)
 	is_extruder_relative_null = pos.is_extruder_relative_null;
 	is_metric = pos.is_metric;
 	is_metric_null = pos.is_metric_null;
+	has_xy_position_changed = pos.has_xy_position_changed;
+	has_position_changed = pos.has_position_changed;
+	file_line_number = pos.file_line_number;
+	gcode_number = pos.gcode_number;
+	file_position = pos.file_position;
+	gcode_ignored = pos.gcode_ignored;
+#ifndef GCODE_POSITION_LEAN
 	last_extrusion_height = pos.last_extrusion_height;
 	last_extrusion_height_null = pos.last_extrusion_height_null;
 	layer = pos.layer;
@@ -263,33 +271,18 @@ position::position(const position &pos)
 	is_height_increment_change = pos.is_height_increment_change;
 	is_xy_travel = pos.is_xy_travel;
 	is_xyz_travel = pos.is_xyz_travel;
-	has_xy_position_changed = pos.has_xy_position_changed;
-	has_position_changed = pos.has_position_changed;
 	has_received_home_command = pos.has_received_home_command;
-	file_line_number = pos.file_line_number;
-	gcode_number = pos.gcode_number;
-	file_position = pos.file_position;
-	gcode_ignored = pos.gcode_ignored;
 	is_in_bounds = pos.is_in_bounds;
+#endif
 	current_tool = pos.current_tool;
-	p_extruders = NULL;
-	command = pos.command;
-	num_extruders = 0;
-	set_num_extruders(pos.num_extruders);
+	num_extruders = pos.num_extruders;
+	// Only the extruders that are in use need to be copied
 	for(int index=0; index < pos.num_extruders; index++)
 	{
-		p_extruders[index] = pos.p_extruders[index];
+		extruders[index] = pos.extruders[index];
 	}
 }
 
-position::~position()
-{
-	if (has_been_deleted)
-		return;
-	has_been_deleted = true;
-	delete_extruders();
-}
-
 position& position::operator=(const position& pos) {
 	is_empty = pos.is_empty;
 	feature_type_tag = pos.feature_type_tag;
@@ -316,6 +309,13 @@ position& position::operator=(const position& pos) {
 	is_extruder_relative_null = pos.is_extruder_relative_null;
 	is_metric = pos.is_metric;
 	is_metric_null = pos.is_metric_null;
+	has_xy_position_changed = pos.has_xy_position_changed;
+	has_position_changed = pos.has_position_changed;
+	file_line_number = pos.file_line_number;
+	file_position = pos.file_position;
+	gcode_number = pos.gcode_number;
+	gcode_ignored = pos.gcode_ignored;
+#ifndef GCODE_POSITION_LEAN
 	last_extrusion_height = pos.last_extrusion_height;
 	last_extrusion_height_null = pos.last_extrusion_height_null;
 	layer = pos.layer;
@@ -333,51 +333,29 @@ position& position::operator=(const position& pos) {
 	is_height_increment_change = pos.is_height_increment_change;
 	is_xy_travel = pos.is_xy_travel;
 	is_xyz_travel = pos.is_xyz_travel;
-	has_xy_position_changed = pos.has_xy_position_changed;
-	has_position_changed = pos.has_position_changed;
 	has_received_home_command = pos.has_received_home_command;
-	file_line_number = pos.file_line_number;
-	file_position = pos.file_position;
-	gcode_number = pos.gcode_number;
-	gcode_ignored = pos.gcode_ignored;
 	is_in_bounds = pos.is_in_bounds;
+#endif
 	current_tool = pos.current_tool;
-	command = pos.command;
-	if (pos.num_extruders != num_extruders)
-	{
-		set_num_extruders(pos.num_extruders);
-	}
-	
-	
+	num_extruders = pos.num_extruders;
+	// Only the extruders that are in use need to be copied
 	for (int index = 0; index < pos.num_extruders; index++)
 	{
-		p_extruders[index] = pos.p_extruders[index];
+		extruders[index] = pos.extruders[index];
 	}
 	return *this;
 }
 
 void position::set_num_extruders(int num_extruders_)
 {
-	if (num_extruders_ == num_extruders)
-		return;
-	delete_extruders();
-	num_extruders = num_extruders_;
-	if (num_extruders_ > 0)
-	{
-		p_extruders = new extruder[num_extruders_];
-	}
-	else
+	if (num_extruders_ < 1 || num_extruders_ > POSITION_MAX_EXTRUDERS)
 	{
 		throw std::exception();
 	}
-}
-
-void position::delete_extruders()
-{
-	if (p_extruders != NULL)
+	num_extruders = num_extruders_;
+	for (int index = 0; index < num_extruders; index++)
 	{
-		delete[] p_extruders;
-		p_extruders = NULL;
+		extruders[index] = extruder();
 	}
 }
 
@@ -396,39 +374,50 @@ double position::get_gcode_z() const
 	return z - z_offset + z_firmware_offset;
 }
 
-extruder& position::get_current_extruder() const
+extruder& position::get_current_extruder()
 {
-	int tool_number = current_tool;
-	if (current_tool > num_extruders-1)
-		tool_number = num_extruders - 1;
-	else if (current_tool < 0)
-		tool_number = 0;
-	return p_extruders[tool_number];
+	return get_extruder(current_tool);
 }
 
-extruder& position::get_extruder(int index) const
+const extruder& position::get_current_extruder() const
+{
+	return get_extruder(current_tool);
+}
+
+extruder& position::get_extruder(int index)
+{
+	if (index >= num_extruders)
+		index = num_extruders - 1;
+	else if (index < 0)
+		index = 0;
+	return extruders[index];
+}
+
+const extruder& position::get_extruder(int index) const
 {
 	if (index >= num_extruders)
 		index = num_extruders - 1;
 	else if (index < 0)
 		index = 0;
-	return p_extruders[index];
+	return extruders[index];
 }
 
 void position::reset_state()
 {
+	has_position_changed = false;
+	gcode_ignored = true;
+	
+	//is_in_bounds = true; // I dont' think we want to reset this every time since it's only calculated if the current position
+	// changes.
+	get_current_extruder().e_relative = 0;
+#ifndef GCODE_POSITION_LEAN
 	is_layer_change = false;
 	is_height_change = false;
 	is_height_increment_change = false;
 	is_xy_travel = false;
 	is_xyz_travel = false;
-	has_position_changed = false;
 	has_received_home_command = false;
-	gcode_ignored = true;
-	
-	//is_in_bounds = true; // I dont' think we want to reset this every time since it's only calculated if the current position
-	// changes.
-	p_extruders[current_tool].e_relative = 0;
 	z_relative = 0;
+#endif
 	feature_type_tag = 0;
 }
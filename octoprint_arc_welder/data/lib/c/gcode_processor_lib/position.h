@@ -26,17 +26,21 @@
 #include "parsed_command.h"
 #include "extruder.h"
 
+// The maximum number of extruders a position can track.  Extruders are stored inline so that copying a
+// position never allocates, define this at build time to support more tools.
+#ifndef POSITION_MAX_EXTRUDERS
+#define POSITION_MAX_EXTRUDERS 16
+#endif
 
+// The state of the printer after a gcode is processed.  The gcode itself is not stored here.
 struct position
 {
 	position();
 	position(int extruder_count);
 	position(const position &pos); // Copy Constructor
-	virtual ~position();
 	position& operator=(const position& pos);
-	std::string to_string(bool rewrite, bool verbose, std::string additional_comment);
+	std::string to_string(parsed_command& command, bool rewrite, bool verbose, std::string additional_comment);
 	void reset_state();
-	parsed_command command;
 	int feature_type_tag;
 	double f;
 	bool f_null;
@@ -57,50 +61,53 @@ struct position
 	bool z_homed;
 	bool is_metric;
 	bool is_metric_null;
-	double last_extrusion_height;
-	bool last_extrusion_height_null;
-	long layer;
-	double height;
-	int height_increment;
-	int height_increment_change_count;
-	bool is_printer_primed;
-	bool has_definite_position;
-	double z_relative;
 	bool is_relative;
 	bool is_relative_null;
 	bool is_extruder_relative;
 	bool is_extruder_relative_null;
-	bool is_layer_change;
-	bool is_height_change;
-	bool is_height_increment_change;
-	bool is_xy_travel;
-	bool is_xyz_travel;
-	bool is_zhop;
 	bool has_position_changed;
 	bool has_xy_position_changed;
-	bool has_received_home_command;
-	bool is_in_position;
-	bool in_path_position;
 	long file_line_number;
 	long gcode_number;
 	long file_position;
 	bool gcode_ignored;
-	bool is_in_bounds;
 	bool is_empty;
 	int current_tool;
 	int num_extruders;
-	bool has_been_deleted;
-	extruder * p_extruders;
-	extruder& get_current_extruder() const;
-	extruder& get_extruder(int index) const;
+	extruder extruders[POSITION_MAX_EXTRUDERS];
+	extruder& get_current_extruder();
+	const extruder& get_current_extruder() const;
+	extruder& get_extruder(int index);
+	const extruder& get_extruder(int index) const;
 	void set_num_extruders(int num_extruders_);
-	void delete_extruders();
 	double get_gcode_x() const;
 	double get_gcode_y() const;
 	double get_gcode_z() const;
 	void set_xyz_axis_mode(const std::string& xyz_axis_default_mode);
 	void set_e_axis_mode(const std::string& e_axis_default_mode);
 	void set_units_default(const std::string& units_default);
+#ifndef GCODE_POSITION_LEAN
+	// Layer, height, priming, z-hop and bounds tracking.  These are only needed by Octolapse.
+	double last_extrusion_height;
+	bool last_extrusion_height_null;
+	long layer;
+	double height;
+	int height_increment;
+	int height_increment_change_count;
+	bool is_printer_primed;
+	bool has_definite_position;
+	double z_relative;
+	bool is_layer_change;
+	bool is_height_change;
+	bool is_height_increment_change;
+	bool is_xy_travel;
+	bool is_xyz_travel;
+	bool is_zhop;
+	bool has_received_home_command;
+	bool is_in_position;
+	bool in_path_position;
+	bool is_in_bounds;
 	bool can_take_snapshot();
+#endif
 };
 #endif
\ No newline at end of file
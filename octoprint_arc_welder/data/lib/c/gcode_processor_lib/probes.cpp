@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "probes.h"
+#ifdef GCODE_PROBES
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+// The number of clock reads used to measure their cost
+#define PROBES_CALIBRATION_READS 1000
+
+// The registered sites form a list, which only grows
+static std::mutex& get_sites_mutex()
+{
+	static std::mutex sites_mutex;
+	return sites_mutex;
+}
+
+static probe_site*& get_first_site()
+{
+	static probe_site* p_first_site = NULL;
+	return p_first_site;
+}
+
+probe_site::probe_site(const char* name, bool is_counter) : name(name), is_counter(is_counter), calls(0), nanoseconds(0), p_next(NULL)
+{
+	probes::register_site(this);
+}
+
+probe_site::probe_site(const probe_site &source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+void probes::register_site(probe_site* p_site)
+{
+	std::lock_guard<std::mutex> lock(get_sites_mutex());
+	p_site->p_next = get_first_site();
+	get_first_site() = p_site;
+}
+
+void probes::reset()
+{
+	std::lock_guard<std::mutex> lock(get_sites_mutex());
+	for (probe_site* p_site = get_first_site(); p_site != NULL; p_site = p_site->p_next)
+	{
+		p_site->calls.store(0);
+		p_site->nanoseconds.store(0);
+	}
+}
+
+double probes::get_clock_overhead_nanoseconds()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point end = start;
+	for (int index = 0; index < PROBES_CALIBRATION_READS; index++)
+	{
+		end = std::chrono::steady_clock::now();
+	}
+	return 2.0 * std::chrono::duration<double, std::nano>(end - start).count() / PROBES_CALIBRATION_READS;
+}
+
+std::string probes::get_json_report()
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(3);
+	stream << "{\n\t\"clock_overhead_ns\": " << get_clock_overhead_nanoseconds() << ",\n\t\"scopes\": [";
+	std::lock_guard<std::mutex> lock(get_sites_mutex());
+	bool is_first = true;
+	for (probe_site* p_site = get_first_site(); p_site != NULL; p_site = p_site->p_next)
+	{
+		long long calls = p_site->calls.load();
+		if (p_site->is_counter || calls == 0)
+			continue;
+		long long nanoseconds = p_site->nanoseconds.load();
+		stream << (is_first ? "\n" : ",\n");
+		stream << "\t\t{ \"name\": \"" << p_site->name << "\", \"calls\": " << calls
+			<< ", \"seconds\": " << std::setprecision(6) << static_cast<double>(nanoseconds) / 1000000000.0
+			<< ", \"mean_ns\": " << std::setprecision(1) << static_cast<double>(nanoseconds) / static_cast<double>(calls)
+			<< " }";
+		is_first = false;
+	}
+	stream << "\n\t],\n\t\"counters\": {";
+	is_first = true;
+	for (probe_site* p_site = get_first_site(); p_site != NULL; p_site = p_site->p_next)
+	{
+		long long calls = p_site->calls.load();
+		if (!p_site->is_counter || calls == 0)
+			continue;
+		stream << (is_first ? "\n" : ",\n");
+		stream << "\t\t\"" << p_site->name << "\": " << calls;
+		is_first = false;
+	}
+	stream << "\n\t}\n}\n";
+	return stream.str();
+}
+
+bool probes::write_json_report(const std::string& path)
+{
+	std::ofstream report(path.c_str(), std::ios::out | std::ios::trunc);
+	if (!report.is_open())
+	{
+		return false;
+	}
+	report << get_json_report();
+	report.close();
+	return !report.fail();
+}
+#endif
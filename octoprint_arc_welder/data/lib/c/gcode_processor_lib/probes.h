@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+// Compile-time instrumentation for the hot paths.  Define GCODE_PROBES to time every GCODE_PROBE_SCOPE and count
+// every GCODE_PROBE_COUNT.  Without it the macros expand to nothing, so the probes cost nothing in a normal build.
+//
+// Probes are shared by every thread and every conversion in the process.  Scopes are inclusive, so a probed function
+// that calls another probed function (or itself) includes the callee's time.
+#ifdef GCODE_PROBES
+#include <string>
+#include <atomic>
+#include <chrono>
+
+// A probed scope or counter.  Sites are created as function statics, and register themselves the first time they run.
+class probe_site
+{
+public:
+	probe_site(const char* name, bool is_counter);
+	const char* name;
+	bool is_counter;
+	std::atomic<long long> calls;
+	std::atomic<long long> nanoseconds;
+	probe_site* p_next;
+private:
+	probe_site(const probe_site &source);
+};
+
+// Times the enclosing scope
+class probe_scope
+{
+public:
+	probe_scope(probe_site& site) : site_(site), start_(std::chrono::steady_clock::now())
+	{
+	}
+	~probe_scope()
+	{
+		long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+		site_.calls.fetch_add(1, std::memory_order_relaxed);
+		site_.nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+	}
+private:
+	probe_site& site_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+class probes
+{
+public:
+	// Clears every registered probe
+	static void reset();
+	// Returns a JSON object with every probe that has run
+	static std::string get_json_report();
+	// Returns false if the file can't be written
+	static bool write_json_report(const std::string& path);
+	static void register_site(probe_site* p_site);
+private:
+	// The time it takes to read the clock twice, which is included in every timed call
+	static double get_clock_overhead_nanoseconds();
+};
+
+#define GCODE_PROBE_CONCAT_INNER(a, b) a##b
+#define GCODE_PROBE_CONCAT(a, b) GCODE_PROBE_CONCAT_INNER(a, b)
+#define GCODE_PROBE_SCOPE(name) \
+	static probe_site GCODE_PROBE_CONCAT(probe_site_, __LINE__)(name, false); \
+	probe_scope GCODE_PROBE_CONCAT(probe_scope_, __LINE__)(GCODE_PROBE_CONCAT(probe_site_, __LINE__))
+#define GCODE_PROBE_COUNT(name) \
+	do { \
+		static probe_site probe_counter_site(name, true); \
+		probe_counter_site.calls.fetch_add(1, std::memory_order_relaxed); \
+	} while (0)
+#else
+#define GCODE_PROBE_SCOPE(name)
+#define GCODE_PROBE_COUNT(name) do { } while (0)
+#endif
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// A bounded, lock-free ring buffer for passing items from exactly one producer thread to exactly one consumer
+// thread.  try_push and try_pop never block.  push and pop wait (spinning, then yielding, then sleeping) until
+// they succeed, or until the supplied stop flag is set.
+template <typename T>
+class spsc_ring
+{
+public:
+	spsc_ring(int capacity)
+	{
+		// One slot is always left empty so that a full ring can be told apart from an empty one.
+		size_ = capacity + 1;
+		items_ = new T[size_];
+		head_.store(0);
+		tail_.store(0);
+	}
+	virtual ~spsc_ring()
+	{
+		delete[] items_;
+	}
+	// Called only from the producer thread.
+	bool try_push(const T& item)
+	{
+		int tail = tail_.load(std::memory_order_relaxed);
+		int next = tail + 1 == size_ ? 0 : tail + 1;
+		if (next == head_.load(std::memory_order_acquire))
+			return false;
+		items_[tail] = item;
+		tail_.store(next, std::memory_order_release);
+		return true;
+	}
+	// Called only from the consumer thread.
+	bool try_pop(T& item)
+	{
+		int head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return false;
+		item = items_[head];
+		head_.store(head + 1 == size_ ? 0 : head + 1, std::memory_order_release);
+		return true;
+	}
+	bool push(const T& item, const std::atomic<bool>& stop)
+	{
+		for (int attempts = 0; !try_push(item); attempts++)
+		{
+			if (stop.load(std::memory_order_relaxed))
+				return false;
+			wait(attempts);
+		}
+		return true;
+	}
+	bool pop(T& item, const std::atomic<bool>& stop)
+	{
+		for (int attempts = 0; !try_pop(item); attempts++)
+		{
+			if (stop.load(std::memory_order_relaxed))
+				return false;
+			wait(attempts);
+		}
+		return true;
+	}
+private:
+	spsc_ring(const spsc_ring& source);
+	static void wait(int attempts)
+	{
+		if (attempts < 64)
+			return;
+		if (attempts < 1024)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	T* items_;
+	int size_;
+	// Keep the consumer and producer indexes on separate cache lines
+	alignas(64) std::atomic<int> head_;
+	alignas(64) std::atomic<int> tail_;
+};
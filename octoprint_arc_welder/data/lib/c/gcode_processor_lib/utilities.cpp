@@ -23,9 +23,19 @@
 #include <math.h>
 #include <sstream>
 #include <iostream>
+#include <fstream>
+#include <ctime>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <time.h>
+#include <sys/resource.h>
+#endif
 
-// Had to increase the zero tolerance because prusa slicer doesn't always retract enough while wiping.
-const double ZERO_TOLERANCE = 0.000005;
 const std::string utilities::WHITESPACE_ = " \n\r\t\f\v";
 
 bool utilities::is_zero(double x)
@@ -140,6 +150,12 @@ std::string utilities::trim(const std::string& s)
 	return rtrim(ltrim(s));
 }
 
+bool utilities::is_whitespace(char c)
+{
+	// Must match WHITESPACE_
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
 std::istream& utilities::safe_get_line(std::istream& is, std::string& t)
 {
 	t.clear();
@@ -171,3 +187,63 @@ std::istream& utilities::safe_get_line(std::istream& is, std::string& t)
 		}
 	}
 }
+
+double utilities::get_thread_cpu_seconds()
+{
+#if defined(_WIN32)
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if (GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+	{
+		// FILETIMEs are in 100ns units
+		unsigned long long kernel = (static_cast<unsigned long long>(kernel_time.dwHighDateTime) << 32) | kernel_time.dwLowDateTime;
+		unsigned long long user = (static_cast<unsigned long long>(user_time.dwHighDateTime) << 32) | user_time.dwLowDateTime;
+		return static_cast<double>(kernel + user) / 10000000.0;
+	}
+	return 0;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+	{
+		return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1000000000.0;
+	}
+	return 0;
+#else
+	// This is the cpu time of the whole process
+	return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+long long utilities::get_peak_memory_bytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return static_cast<long long>(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#if defined(__APPLE__)
+	// Bytes on macOS
+	return static_cast<long long>(usage.ru_maxrss);
+#else
+	// Kilobytes everywhere else
+	return static_cast<long long>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+long long utilities::get_file_size(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return -1;
+	}
+	return static_cast<long long>(file.tellg());
+}
@@ -23,6 +23,9 @@
 #pragma once
 #include <string>
 
+// Had to increase the zero tolerance because prusa slicer doesn't always retract enough while wiping.
+#define ZERO_TOLERANCE 0.000005
+
 class utilities{
 public:
 	static bool is_zero(double x);
@@ -48,7 +51,14 @@ public:
 	static std::string ltrim(const std::string& s);
 	static std::string rtrim(const std::string& s);
 	static std::string trim(const std::string& s);
+	static bool is_whitespace(char c);
 	static std::istream& safe_get_line(std::istream& is, std::string& t);
+	// The cpu time used by the calling thread, in seconds
+	static double get_thread_cpu_seconds();
+	// The peak resident memory of the process in bytes, or 0 if it isn't available
+	static long long get_peak_memory_bytes();
+	// The size of a file in bytes, or -1 if it can't be opened
+	static long long get_file_size(const std::string& path);
 protected:
 	static const std::string WHITESPACE_;
 private:
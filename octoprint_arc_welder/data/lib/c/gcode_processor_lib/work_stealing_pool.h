@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a fixed set of work items on a pool of threads.  Every thread has its own queue and takes items from the front
+// of it.  A thread whose queue is empty steals from the back of another thread's queue, so no thread sits idle while
+// another still has a backlog.  All of the items are pushed before run() is called, so a thread exits once every
+// queue is empty.
+template <typename T>
+class work_stealing_pool
+{
+public:
+	work_stealing_pool(int num_threads) : queues_(num_threads < 1 ? 1 : num_threads)
+	{
+	}
+	virtual ~work_stealing_pool()
+	{
+	}
+	int get_num_threads() const
+	{
+		return static_cast<int>(queues_.size());
+	}
+	// Adds an item to the back of a thread's queue.  Call this only before run().
+	void push(int thread_index, const T& item)
+	{
+		queues_[thread_index].items.push_back(item);
+	}
+	// Calls work(thread_index, item) for every item, and returns once they are all done.  The calling thread does the
+	// work of thread 0.  work must not throw.
+	template <typename F>
+	void run(F work)
+	{
+		std::vector<std::thread> threads;
+		for (int index = 1; index < get_num_threads(); index++)
+		{
+			threads.push_back(std::thread(&work_stealing_pool::run_thread<F>, this, index, work));
+		}
+		run_thread(0, work);
+		for (unsigned int index = 0; index < threads.size(); index++)
+		{
+			threads[index].join();
+		}
+	}
+private:
+	work_stealing_pool(const work_stealing_pool& source);
+	struct work_queue
+	{
+		std::mutex mutex;
+		std::deque<T> items;
+	};
+	template <typename F>
+	void run_thread(int thread_index, F work)
+	{
+		T item;
+		while (try_pop(thread_index, item))
+		{
+			work(thread_index, item);
+		}
+	}
+	bool try_pop(int thread_index, T& item)
+	{
+		{
+			work_queue& own = queues_[thread_index];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.items.empty())
+			{
+				item = own.items.front();
+				own.items.pop_front();
+				return true;
+			}
+		}
+		// Steal, starting with the next thread so that the thieves spread out over the victims
+		const int num_threads = get_num_threads();
+		for (int offset = 1; offset < num_threads; offset++)
+		{
+			work_queue& victim = queues_[(thread_index + offset) % num_threads];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.items.empty())
+			{
+				item = victim.items.back();
+				victim.items.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+	std::vector<work_queue> queues_;
+};
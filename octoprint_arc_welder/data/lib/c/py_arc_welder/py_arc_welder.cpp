@@ -25,24 +25,78 @@
 
 bool py_arc_welder::on_progress_(double percent_complete, double seconds_elapsed, double estimated_seconds_remaining, int gcodes_processed, int current_line, int points_compressed, int arcs_created)
 {
+	// The GIL is released while welding, so hold it for every Python call made here.
+	PyGILState_STATE gstate = PyGILState_Ensure();
 	PyObject* funcArgs = Py_BuildValue("(d,d,d,i,i,i,i)", percent_complete, seconds_elapsed, estimated_seconds_remaining, gcodes_processed, current_line, points_compressed, arcs_created);
 	if (funcArgs == NULL)
 	{
+		PyGILState_Release(gstate);
 		return false;
 	}
 	
-	PyGILState_STATE gstate = PyGILState_Ensure();
+	// An exception that was logged leaves an error set.  Keep it aside for the caller, so that the callback still works.
+	PyObject* error_type = NULL;
+	PyObject* error_value = NULL;
+	PyObject* error_traceback = NULL;
+	PyErr_Fetch(&error_type, &error_value, &error_traceback);
+
+	bool continue_processing = true;
 	PyObject* pContinueProcessing = PyObject_CallObject(py_progress_callback_, funcArgs);
 	Py_DECREF(funcArgs);
-	bool continue_processing = PyLong_AsLong(pContinueProcessing) > 0;
-	Py_DECREF(pContinueProcessing);
+	if (pContinueProcessing == NULL)
+	{
+		// The callback raised.  Print the error, since there is nobody to return it to, and keep going.
+		PyErr_Print();
+	}
+	else if (pContinueProcessing != Py_None)
+	{
+		// If no return value was supplied, assume true
+		continue_processing = PyObject_IsTrue(pContinueProcessing) > 0;
+	}
+	Py_XDECREF(pContinueProcessing);
+	PyErr_Restore(error_type, error_value, error_traceback);
 	PyGILState_Release(gstate);
+	return continue_processing;
+}
 
-	if (pContinueProcessing == NULL || pContinueProcessing == Py_None)
+PyObject* py_arc_welder::get_py_results(const arc_welder_results& results)
+{
+	// The wall and cpu seconds of each stage, keyed by the stage name
+	PyObject* py_stages = PyDict_New();
+	if (py_stages == NULL)
 	{
-		// no return value was supply, assume true
-		
-		return true;
+		return NULL;
 	}
-	return continue_processing;
+	for (int index = 0; index < NUM_CONVERSION_STAGES; index++)
+	{
+		PyObject* py_stage = Py_BuildValue(
+			"{s:d,s:d}",
+			"seconds", results.stage_times.seconds[index],
+			"cpu_seconds", results.stage_times.cpu_seconds[index]
+		);
+		if (py_stage == NULL || PyDict_SetItemString(py_stages, conversion_stage_name[index].c_str(), py_stage) < 0)
+		{
+			Py_XDECREF(py_stage);
+			Py_DECREF(py_stages);
+			return NULL;
+		}
+		Py_DECREF(py_stage);
+	}
+	return Py_BuildValue(
+		"{s:N,s:s,s:N,s:L,s:L,s:i,s:i,s:i,s:i,s:d,s:d,s:d,s:L,s:N}",
+		"success", PyBool_FromLong(results.success ? 1 : 0),
+		"message", results.message.c_str(),
+		"cancelled", PyBool_FromLong(results.cancelled ? 1 : 0),
+		"source_file_size", results.source_file_size,
+		"target_file_size", results.target_file_size,
+		"lines_processed", results.lines_processed,
+		"gcodes_processed", results.gcodes_processed,
+		"points_compressed", results.points_compressed,
+		"arcs_created", results.arcs_created,
+		"compression_ratio", results.compression_ratio,
+		"seconds_elapsed", results.seconds_elapsed,
+		"cpu_seconds", results.stage_times.total_cpu_seconds,
+		"peak_memory_bytes", results.peak_memory_bytes,
+		"stages", py_stages
+	);
 }
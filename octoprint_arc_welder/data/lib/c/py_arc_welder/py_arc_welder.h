@@ -38,6 +38,8 @@ public:
 	{
 		py_progress_callback_ = py_progress_callback;
 	}
+	// Returns a new dict describing the results, or NULL with a Python error set.  Must be called with the GIL held.
+	static PyObject* get_py_results(const arc_welder_results& results);
 	virtual ~py_arc_welder() {
 		
 	}
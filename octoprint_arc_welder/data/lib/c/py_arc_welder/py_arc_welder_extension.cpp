@@ -28,6 +28,8 @@
 #include "arc_welder.h"
 #include "py_logger.h"
 #include "python_helpers.h"
+#include "py_conversion_handle.h"
+#include "py_batch_welder.h"
 
 #if PY_MAJOR_VERSION >= 3
 int main(int argc, char* argv[])
@@ -84,6 +86,8 @@ static struct module_state _state;
 // Python 2 module method definition
 static PyMethodDef PyArcWelderMethods[] = {
 	{ "ConvertFile", (PyCFunction)ConvertFile,  METH_VARARGS  ,"Converts segmented curve approximations to actual G2/G3 arcs within the supplied resolution." },
+	{ "start_conversion", (PyCFunction)StartConversion,  METH_VARARGS  ,"Starts converting on a native thread, and returns a ConversionHandle that can be polled, waited on or cancelled." },
+	{ "ConvertFiles", (PyCFunction)ConvertFiles,  METH_VARARGS  ,"Converts a list of files at once, one file per thread, and returns a list with the results of each." },
 	{ NULL, NULL, 0, NULL }
 };
 
@@ -134,6 +138,10 @@ extern "C" void initPyArcWelder(void)
 
 	if (module == NULL)
 		INITERROR;
+	if (!py_conversion_handle_add_type(module)) {
+		Py_DECREF(module);
+		INITERROR;
+	}
 	struct module_state* st = GETSTATE(module);
 
 	st->error = PyErr_NewException((char*)"PyArcWelder.Error", NULL, NULL);
@@ -178,28 +186,179 @@ extern "C"
 		
 		if (!ParseArgs(py_convert_file_args, args, &py_progress_callback))
 		{
+			Py_XDECREF(py_progress_callback);
 			return NULL;
 		}
 		p_py_logger->set_log_level_by_value(args.log_level);
-		std::stringstream stream;
-		stream << "py_gcode_arc_converter.ConvertFile - Parameters received: source_file_path: '" << 
-			args.source_file_path << "', target_file_path:'" << args.target_file_path << "' resolution_mm:" << 
-			args.resolution_mm << ", g90_91_influences_extruder: " << (args.g90_g91_influences_extruder ? "True" : "False") << "\n";
-		p_py_logger->log(GCODE_CONVERSION, INFO, stream.str());
+		LogArgs("ConvertFile", args);
 
 		std::string message = "py_gcode_arc_converter.ConvertFile - Beginning Arc Conversion.";
 		p_py_logger->log(GCODE_CONVERSION, INFO, message);
 
 		py_arc_welder arc_welder_obj(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.g90_g91_influences_extruder, 50, py_progress_callback);
-		arc_welder_obj.process();
+		arc_welder_obj.set_pipelined(args.pipelined);
+		arc_welder_obj.set_parallel_threads(args.parallel_threads);
+		arc_welder_obj.set_arc_e_mode(args.e_mode);
+		arc_welder_obj.set_compact_output(args.compact_output);
+		arc_welder_obj.set_radius_arcs(args.radius_arcs);
+		arc_welder_obj.set_helical_arcs(args.helical_arcs);
+		// Release the GIL while welding so that the rest of OctoPrint keeps running.  The progress callback and
+		// the logger reacquire it only for their own Python calls.
+		bool conversion_failed = false;
+		arc_welder_results results;
+		Py_BEGIN_ALLOW_THREADS
+		try
+		{
+			results = arc_welder_obj.process();
+		}
+		catch (...)
+		{
+			// Never let an exception unwind past the saved thread state
+			conversion_failed = true;
+		}
+		Py_END_ALLOW_THREADS
+		// Any exception that was logged while converting is still set, and is raised here
+		if (conversion_failed || PyErr_Occurred())
+		{
+			Py_XDECREF(py_progress_callback);
+			if (!PyErr_Occurred())
+			{
+				PyErr_SetString(PyExc_RuntimeError, "py_gcode_arc_converter.ConvertFile - The arc conversion failed.");
+			}
+			return NULL;
+		}
 		message = "py_gcode_arc_converter.ConvertFile - Arc Conversion Complete.";
 		p_py_logger->log(GCODE_CONVERSION, INFO, message);
 		Py_XDECREF(py_progress_callback);
-		// For now just return py_none
-		return PyTuple_Pack(1, Py_None);
+		return py_arc_welder::get_py_results(results);
+	}
+
+	static PyObject* StartConversion(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_convert_file_args;
+		if (!PyArg_ParseTuple(
+			py_args,
+			"O",
+			&py_convert_file_args
+			))
+		{
+			std::string message = "py_gcode_arc_converter.start_conversion - Cound not extract the parameters dictionary.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return NULL;
+		}
+
+		py_gcode_arc_args args;
+		PyObject* py_progress_callback = NULL;
+
+		if (!ParseArgs(py_convert_file_args, args, &py_progress_callback))
+		{
+			Py_XDECREF(py_progress_callback);
+			return NULL;
+		}
+		p_py_logger->set_log_level_by_value(args.log_level);
+		LogArgs("start_conversion", args);
+
+		py_arc_welder* p_arc_welder = new py_arc_welder(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.g90_g91_influences_extruder, 50, py_progress_callback);
+		p_arc_welder->set_pipelined(args.pipelined);
+		p_arc_welder->set_parallel_threads(args.parallel_threads);
+		p_arc_welder->set_arc_e_mode(args.e_mode);
+		p_arc_welder->set_compact_output(args.compact_output);
+		p_arc_welder->set_radius_arcs(args.radius_arcs);
+		p_arc_welder->set_helical_arcs(args.helical_arcs);
+		// The conversion owns the welder and the callback reference from here on
+		return py_conversion_handle_start(new py_conversion(p_arc_welder, py_progress_callback));
+	}
+	static PyObject* ConvertFiles(PyObject* self, PyObject* py_args)
+	{
+		PyObject* py_convert_files_args;
+		if (!PyArg_ParseTuple(
+			py_args,
+			"O",
+			&py_convert_files_args
+			))
+		{
+			std::string message = "py_gcode_arc_converter.ConvertFiles - Cound not extract the parameters dictionary.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return NULL;
+		}
+
+		py_gcode_arc_batch_args args;
+		PyObject* py_progress_callback = NULL;
+		if (!ParseBatchArgs(py_convert_files_args, args, &py_progress_callback))
+		{
+			Py_XDECREF(py_progress_callback);
+			return NULL;
+		}
+		p_py_logger->set_log_level_by_value(args.settings.log_level);
+		std::stringstream stream;
+		stream << "py_gcode_arc_converter.ConvertFiles - Beginning the conversion of " << args.jobs.size() << " files, num_threads: " << args.num_threads << ".";
+		p_py_logger->log(GCODE_CONVERSION, INFO, stream.str());
+
+		py_batch_welder batch(p_py_logger, args.settings.resolution_mm, args.settings.g90_g91_influences_extruder, 50, py_progress_callback);
+		batch.set_num_threads(args.num_threads);
+		batch.set_arc_e_mode(args.settings.e_mode);
+		batch.set_compact_output(args.settings.compact_output);
+		batch.set_radius_arcs(args.settings.radius_arcs);
+		batch.set_helical_arcs(args.settings.helical_arcs);
+		// Release the GIL while welding, as ConvertFile does
+		bool conversion_failed = false;
+		std::vector<arc_welder_results> results;
+		Py_BEGIN_ALLOW_THREADS
+		try
+		{
+			results = batch.process(args.jobs);
+		}
+		catch (...)
+		{
+			conversion_failed = true;
+		}
+		Py_END_ALLOW_THREADS
+		Py_XDECREF(py_progress_callback);
+		// A file that fails or is cancelled is reported in its own results.  Only a failure of the whole batch is raised.
+		if (conversion_failed || PyErr_Occurred())
+		{
+			if (!PyErr_Occurred())
+			{
+				PyErr_SetString(PyExc_RuntimeError, "py_gcode_arc_converter.ConvertFiles - The arc conversion failed.");
+			}
+			return NULL;
+		}
+		PyObject* py_results = PyList_New(static_cast<Py_ssize_t>(results.size()));
+		if (py_results == NULL)
+		{
+			return NULL;
+		}
+		for (unsigned int index = 0; index < results.size(); index++)
+		{
+			PyObject* py_file_results = py_arc_welder::get_py_results(results[index]);
+			if (py_file_results == NULL)
+			{
+				Py_DECREF(py_results);
+				return NULL;
+			}
+			// Steals the reference
+			PyList_SET_ITEM(py_results, index, py_file_results);
+		}
+		p_py_logger->log(GCODE_CONVERSION, INFO, batch.is_cancelled() ?
+			"py_gcode_arc_converter.ConvertFiles - Arc Conversion Cancelled." :
+			"py_gcode_arc_converter.ConvertFiles - Arc Conversion Complete.");
+		return py_results;
 	}
 }
 
+static void LogArgs(const std::string& function_name, const py_gcode_arc_args& args)
+{
+	std::stringstream stream;
+	stream << "py_gcode_arc_converter." << function_name << " - Parameters received: source_file_path: '" << 
+		args.source_file_path << "', target_file_path:'" << args.target_file_path << "' resolution_mm:" << 
+		args.resolution_mm << ", g90_91_influences_extruder: " << (args.g90_g91_influences_extruder ? "True" : "False") << 
+		", pipelined: " << (args.pipelined ? "True" : "False") << ", parallel_threads: " << args.parallel_threads <<
+		", arc_e_mode: " << arc_e_mode_name[args.e_mode] << ", compact_output: " << (args.compact_output ? "True" : "False") <<
+		", radius_arcs: " << (args.radius_arcs ? "True" : "False") <<
+		", helical_arcs: " << (args.helical_arcs ? "True" : "False") << "\n";
+	p_py_logger->log(GCODE_CONVERSION, INFO, stream.str());
+}
+
 static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_progress_callback)
 {
 	p_py_logger->log(
@@ -227,11 +386,42 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	}
 	args.target_file_path = gcode_arc_converter::PyUnicode_SafeAsString(py_target_file_path);
 
+	if (!ParseWeldingArgs(py_args, args, py_progress_callback))
+	{
+		return false;
+	}
+
+	// Extract pipelined.  This one is optional, and defaults to False.
+	PyObject* py_pipelined = PyDict_GetItemString(py_args, "pipelined");
+	if (py_pipelined != NULL)
+	{
+		args.pipelined = PyObject_IsTrue(py_pipelined) > 0;
+	}
+
+	// Extract parallel_threads.  This one is optional, and defaults to 0 (welding on a single thread).
+	PyObject* py_parallel_threads = PyDict_GetItemString(py_args, "parallel_threads");
+	if (py_parallel_threads != NULL && py_parallel_threads != Py_None)
+	{
+		if (!gcode_arc_converter::PyIntOrLong_Check(py_parallel_threads))
+		{
+			std::string message = "ParseArgs - parallel_threads must be an integer.";
+			p_py_logger->log(GCODE_CONVERSION, ERROR, message);
+			PyErr_SetString(PyExc_TypeError, message.c_str());
+			return false;
+		}
+		args.parallel_threads = static_cast<int>(gcode_arc_converter::PyIntOrLong_AsLong(py_parallel_threads));
+	}
+	
+	return true;
+}
+
+static bool ParseWeldingArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_progress_callback)
+{
 	// Extract the resolution in millimeters
 	PyObject* py_resolution_mm = PyDict_GetItemString(py_args, "resolution_mm");
 	if (py_resolution_mm == NULL)
 	{
-		std::string message = "ParseArgs - Unable to retrieve the resolution_mm parameter from the args.";
+		std::string message = "ParseWeldingArgs - Unable to retrieve the resolution_mm parameter from the args.";
 		p_py_logger->log_exception(GCODE_CONVERSION, message);
 		return false;
 	}
@@ -245,7 +435,7 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	PyObject* py_g90_g91_influences_extruder = PyDict_GetItemString(py_args, "g90_g91_influences_extruder");
 	if (py_g90_g91_influences_extruder == NULL)
 	{
-		std::string message = "ParseArgs - Unable to retrieve g90_g91_influences_extruder from the args.";
+		std::string message = "ParseWeldingArgs - Unable to retrieve g90_g91_influences_extruder from the args.";
 		p_py_logger->log_exception(GCODE_CONVERSION, message);
 		return false;
 	}
@@ -255,7 +445,7 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	PyObject* py_on_progress_received = PyDict_GetItemString(py_args, "on_progress_received");
 	if (py_on_progress_received == NULL)
 	{
-		std::string message = "ParseArgs - Unable to retrieve on_progress_received from the stabilization args.";
+		std::string message = "ParseWeldingArgs - Unable to retrieve on_progress_received from the stabilization args.";
 		p_py_logger->log_exception(GCODE_CONVERSION, message);
 		return false;
 	}
@@ -267,7 +457,7 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	PyObject* py_log_level = PyDict_GetItemString(py_args, "log_level");
 	if (py_log_level == NULL)
 	{
-		std::string message = "ParseArgs - Unable to retrieve log_level from the args.";
+		std::string message = "ParseWeldingArgs - Unable to retrieve log_level from the args.";
 		p_py_logger->log_exception(GCODE_CONVERSION, message);
 		return false;
 	}
@@ -275,7 +465,92 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	int log_level_value = static_cast<int>(PyLong_AsLong(py_log_level));
 	// determine the log level as an index rather than as a value
 	args.log_level = p_py_logger->get_log_level_for_value(log_level_value);
-	
+
+	// Extract arc_e_mode.  This one is optional, and defaults to offset.
+	PyObject* py_arc_e_mode = PyDict_GetItemString(py_args, "arc_e_mode");
+	if (py_arc_e_mode != NULL && py_arc_e_mode != Py_None)
+	{
+		std::string e_mode_name = gcode_arc_converter::PyUnicode_SafeAsString(py_arc_e_mode);
+		if (!arc_welder::try_get_arc_e_mode(e_mode_name, args.e_mode))
+		{
+			std::string message = "ParseWeldingArgs - Unknown arc_e_mode '" + e_mode_name + "'.  Use offset, g92 or preserve.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return false;
+		}
+	}
+
+	// Extract compact_output.  This one is optional, and defaults to False.
+	PyObject* py_compact_output = PyDict_GetItemString(py_args, "compact_output");
+	if (py_compact_output != NULL)
+	{
+		args.compact_output = PyObject_IsTrue(py_compact_output) > 0;
+	}
+
+	// Extract radius_arcs.  This one is optional, and defaults to False.
+	PyObject* py_radius_arcs = PyDict_GetItemString(py_args, "radius_arcs");
+	if (py_radius_arcs != NULL)
+	{
+		args.radius_arcs = PyObject_IsTrue(py_radius_arcs) > 0;
+	}
+
+	// Extract helical_arcs.  This one is optional, and defaults to False.
+	PyObject* py_helical_arcs = PyDict_GetItemString(py_args, "helical_arcs");
+	if (py_helical_arcs != NULL)
+	{
+		args.helical_arcs = PyObject_IsTrue(py_helical_arcs) > 0;
+	}
 	return true;
 }
 
+static bool ParseBatchArgs(PyObject* py_args, py_gcode_arc_batch_args& args, PyObject** py_progress_callback)
+{
+	p_py_logger->log(
+		GCODE_CONVERSION, INFO,
+		"Parsing GCode Batch Conversion Args."
+		);
+
+	// Extract the files, a list of dicts with a source_file_path and a target_file_path
+	PyObject* py_files = PyDict_GetItemString(py_args, "files");
+	if (py_files == NULL || !PyList_Check(py_files))
+	{
+		std::string message = "ParseBatchArgs - Unable to retrieve the files list from the args.";
+		p_py_logger->log_exception(GCODE_CONVERSION, message);
+		return false;
+	}
+	for (Py_ssize_t index = 0; index < PyList_Size(py_files); index++)
+	{
+		PyObject* py_file = PyList_GetItem(py_files, index);
+		PyObject* py_source_file_path = PyDict_Check(py_file) ? PyDict_GetItemString(py_file, "source_file_path") : NULL;
+		PyObject* py_target_file_path = PyDict_Check(py_file) ? PyDict_GetItemString(py_file, "target_file_path") : NULL;
+		if (py_source_file_path == NULL || py_target_file_path == NULL)
+		{
+			std::string message = "ParseBatchArgs - Every file needs a source_file_path and a target_file_path.";
+			p_py_logger->log_exception(GCODE_CONVERSION, message);
+			return false;
+		}
+		args.jobs.push_back(batch_welder_job(
+			gcode_arc_converter::PyUnicode_SafeAsString(py_source_file_path),
+			gcode_arc_converter::PyUnicode_SafeAsString(py_target_file_path)
+		));
+	}
+
+	if (!ParseWeldingArgs(py_args, args.settings, py_progress_callback))
+	{
+		return false;
+	}
+
+	// Extract num_threads.  This one is optional, and defaults to 0 (one thread per core).
+	PyObject* py_num_threads = PyDict_GetItemString(py_args, "num_threads");
+	if (py_num_threads != NULL && py_num_threads != Py_None)
+	{
+		if (!gcode_arc_converter::PyIntOrLong_Check(py_num_threads))
+		{
+			std::string message = "ParseBatchArgs - num_threads must be an integer.";
+			p_py_logger->log(GCODE_CONVERSION, ERROR, message);
+			PyErr_SetString(PyExc_TypeError, message.c_str());
+			return false;
+		}
+		args.num_threads = static_cast<int>(gcode_arc_converter::PyIntOrLong_AsLong(py_num_threads));
+	}
+	return true;
+}
@@ -29,7 +29,9 @@
 #include <Python.h>
 #endif
 #include <string>
+#include <vector>
 #include "py_logger.h"
+#include "batch_welder.h"
 extern "C"
 {
 #if PY_MAJOR_VERSION >= 3
@@ -38,6 +40,8 @@ extern "C"
 	extern "C" void initPyArcWelder(void);
 #endif
 	static PyObject* ConvertFile(PyObject* self, PyObject* args);
+	static PyObject* StartConversion(PyObject* self, PyObject* args);
+	static PyObject* ConvertFiles(PyObject* self, PyObject* args);
 }
 
 struct py_gcode_arc_args {
@@ -47,6 +51,12 @@ struct py_gcode_arc_args {
 		resolution_mm = 0.05;
 		g90_g91_influences_extruder = false;
 		log_level = 0;
+		pipelined = false;
+		parallel_threads = 0;
+		e_mode = arc_e_mode_offset;
+		compact_output = false;
+		radius_arcs = false;
+		helical_arcs = false;
 	}
 	py_gcode_arc_args(std::string source_file_path_, std::string target_file_path_, double resolution_mm_, bool g90_g91_influences_extruder_, int log_level_) {
 		source_file_path = source_file_path_;
@@ -54,15 +64,40 @@ struct py_gcode_arc_args {
 		resolution_mm = resolution_mm_;
 		g90_g91_influences_extruder = g90_g91_influences_extruder_;
 		log_level = log_level_;
+		pipelined = false;
+		parallel_threads = 0;
+		e_mode = arc_e_mode_offset;
+		compact_output = false;
+		radius_arcs = false;
+		helical_arcs = false;
 	}
 	std::string source_file_path;
 	std::string target_file_path;
 	double resolution_mm;
 	bool g90_g91_influences_extruder;
 	int log_level;
+	bool pipelined;
+	int parallel_threads;
+	arc_e_mode e_mode;
+	bool compact_output;
+	bool radius_arcs;
+	bool helical_arcs;
+};
+
+struct py_gcode_arc_batch_args {
+	py_gcode_arc_batch_args() {
+		num_threads = 0;
+	}
+	// Only the welding settings and the log level are used
+	py_gcode_arc_args settings;
+	std::vector<batch_welder_job> jobs;
+	int num_threads;
 };
 
 static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** p_py_progress_callback);
+static bool ParseWeldingArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** p_py_progress_callback);
+static bool ParseBatchArgs(PyObject* py_args, py_gcode_arc_batch_args& args, PyObject** p_py_progress_callback);
+static void LogArgs(const std::string& function_name, const py_gcode_arc_args& args);
 
 // global logger
 py_logger* p_py_logger = NULL;
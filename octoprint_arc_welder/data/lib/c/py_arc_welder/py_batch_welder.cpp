@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Python Extension for the OctoPrint Arc Welder plugin.
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "py_batch_welder.h"
+
+bool py_batch_welder::on_progress_(const batch_file_progress& file_progress, const batch_progress& overall_progress)
+{
+	if (py_progress_callback_ == NULL || py_progress_callback_ == Py_None)
+	{
+		return true;
+	}
+	// The GIL is released while welding, so hold it for every Python call made here.  The batch never calls this
+	// from two threads at once.
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	PyObject* funcArgs = Py_BuildValue(
+		"({s:i,s:N,s:d,s:d,s:d,s:i,s:i,s:i,s:i},{s:i,s:i,s:i,s:L,s:d,s:d,s:d,s:i,s:i,s:i,s:i})",
+		"file_index", file_progress.file_index,
+		"is_complete", PyBool_FromLong(file_progress.is_complete ? 1 : 0),
+		"percent_complete", file_progress.percent_complete,
+		"seconds_elapsed", file_progress.seconds_elapsed,
+		"estimated_seconds_remaining", file_progress.estimated_seconds_remaining,
+		"gcodes_processed", file_progress.gcodes_processed,
+		"lines_processed", file_progress.lines_processed,
+		"points_compressed", file_progress.points_compressed,
+		"arcs_created", file_progress.arcs_created,
+		"files_total", overall_progress.files_total,
+		"files_complete", overall_progress.files_complete,
+		"files_failed", overall_progress.files_failed,
+		"bytes_total", overall_progress.bytes_total,
+		"percent_complete", overall_progress.percent_complete,
+		"seconds_elapsed", overall_progress.seconds_elapsed,
+		"estimated_seconds_remaining", overall_progress.estimated_seconds_remaining,
+		"gcodes_processed", overall_progress.gcodes_processed,
+		"lines_processed", overall_progress.lines_processed,
+		"points_compressed", overall_progress.points_compressed,
+		"arcs_created", overall_progress.arcs_created
+	);
+	if (funcArgs == NULL)
+	{
+		PyGILState_Release(gstate);
+		return false;
+	}
+
+	// An exception that was logged leaves an error set.  Keep it aside for the caller, so that the callback still works.
+	PyObject* error_type = NULL;
+	PyObject* error_value = NULL;
+	PyObject* error_traceback = NULL;
+	PyErr_Fetch(&error_type, &error_value, &error_traceback);
+
+	bool continue_processing = true;
+	PyObject* pContinueProcessing = PyObject_CallObject(py_progress_callback_, funcArgs);
+	Py_DECREF(funcArgs);
+	if (pContinueProcessing == NULL)
+	{
+		// The callback raised.  Print the error, since there is nobody to return it to, and keep going.
+		PyErr_Print();
+	}
+	else if (pContinueProcessing != Py_None)
+	{
+		// If no return value was supplied, assume true
+		continue_processing = PyObject_IsTrue(pContinueProcessing) > 0;
+	}
+	Py_XDECREF(pContinueProcessing);
+	PyErr_Restore(error_type, error_value, error_traceback);
+	PyGILState_Release(gstate);
+	return continue_processing;
+}
+
+void py_batch_welder::on_file_finished_(arc_welder_results& results)
+{
+	// A file that fails logs an exception, which leaves a Python error set on this thread.  The failure belongs to the
+	// file's results, so clear the error here instead of letting it fail the whole batch.
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	if (PyErr_Occurred())
+	{
+		PyObject* error_type = NULL;
+		PyObject* error_value = NULL;
+		PyObject* error_traceback = NULL;
+		PyErr_Fetch(&error_type, &error_value, &error_traceback);
+		PyErr_NormalizeException(&error_type, &error_value, &error_traceback);
+		results.success = false;
+		if (results.message.empty() && error_value != NULL)
+		{
+			PyObject* py_message = PyObject_Str(error_value);
+			if (py_message != NULL)
+			{
+				const char* message = gcode_arc_converter::PyUnicode_SafeAsString(py_message);
+				if (message != NULL)
+					results.message = message;
+				Py_DECREF(py_message);
+			}
+			PyErr_Clear();
+		}
+		Py_XDECREF(error_type);
+		Py_XDECREF(error_value);
+		Py_XDECREF(error_traceback);
+	}
+	PyGILState_Release(gstate);
+}
@@ -0,0 +1,294 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Python Extension for the OctoPrint Arc Welder plugin.
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "py_conversion_handle.h"
+#include <chrono>
+
+py_conversion::py_conversion(py_arc_welder* p_arc_welder, PyObject* py_progress_callback)
+{
+	p_arc_welder_ = p_arc_welder;
+	py_progress_callback_ = py_progress_callback;
+	is_finished_ = false;
+	has_failed_ = false;
+	error_type_ = NULL;
+	error_value_ = NULL;
+	error_traceback_ = NULL;
+}
+
+py_conversion::py_conversion(const py_conversion &source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+py_conversion::~py_conversion()
+{
+	delete p_arc_welder_;
+	Py_XDECREF(py_progress_callback_);
+	Py_XDECREF(error_type_);
+	Py_XDECREF(error_value_);
+	Py_XDECREF(error_traceback_);
+}
+
+void py_conversion::start(PyObject* py_handle)
+{
+#if PY_VERSION_HEX < 0x03070000
+	// Older versions only support PyGILState_Ensure from other threads once threading is initialized
+	if (!PyEval_ThreadsInitialized())
+	{
+		PyEval_InitThreads();
+	}
+#endif
+	thread_ = std::thread(&py_conversion::run, this, py_handle);
+	// The worker can't release this reference before we do, since it needs the GIL to do so.
+	Py_INCREF(py_handle);
+}
+
+void py_conversion::run(py_conversion* p_conversion, PyObject* py_handle)
+{
+	// Keep a thread state for the whole conversion, so that an error set while logging an exception survives
+	// until the end, when it is saved for result() to raise.  This is how ConvertFile behaves.
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	bool failed = false;
+	arc_welder_results results;
+	Py_BEGIN_ALLOW_THREADS
+	try
+	{
+		results = p_conversion->p_arc_welder_->process();
+	}
+	catch (...)
+	{
+		failed = true;
+	}
+	Py_END_ALLOW_THREADS
+	PyObject* error_type = NULL;
+	PyObject* error_value = NULL;
+	PyObject* error_traceback = NULL;
+	PyErr_Fetch(&error_type, &error_value, &error_traceback);
+	{
+		std::lock_guard<std::mutex> lock(p_conversion->mutex_);
+		p_conversion->error_type_ = error_type;
+		p_conversion->error_value_ = error_value;
+		p_conversion->error_traceback_ = error_traceback;
+		p_conversion->has_failed_ = failed || error_type != NULL;
+		p_conversion->results_ = results;
+		p_conversion->is_finished_ = true;
+	}
+	p_conversion->finished_.notify_all();
+
+	// Release the handle.  If this is the last reference, the conversion is deleted here, so don't touch it again.
+	Py_DECREF(py_handle);
+	PyGILState_Release(gstate);
+}
+
+void py_conversion::cancel()
+{
+	p_arc_welder_->cancel();
+}
+
+bool py_conversion::is_finished()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return is_finished_;
+}
+
+bool py_conversion::wait(double timeout_seconds)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (timeout_seconds < 0)
+	{
+		finished_.wait(lock, [this]() { return is_finished_; });
+		return true;
+	}
+	return finished_.wait_for(lock, std::chrono::duration<double>(timeout_seconds), [this]() { return is_finished_; });
+}
+
+void py_conversion::join()
+{
+	if (thread_.joinable())
+	{
+		if (is_worker_thread())
+		{
+			// The worker released the final reference to the handle, and is about to exit
+			thread_.detach();
+		}
+		else
+		{
+			thread_.join();
+		}
+	}
+}
+
+bool py_conversion::is_worker_thread() const
+{
+	return std::this_thread::get_id() == thread_.get_id();
+}
+
+bool py_conversion::has_failed() const
+{
+	return has_failed_;
+}
+
+bool py_conversion::restore_error() const
+{
+	if (error_type_ == NULL)
+	{
+		return false;
+	}
+	// PyErr_Restore steals the references, and the error may be raised again by the next call
+	Py_INCREF(error_type_);
+	Py_XINCREF(error_value_);
+	Py_XINCREF(error_traceback_);
+	PyErr_Restore(error_type_, error_value_, error_traceback_);
+	return true;
+}
+
+const arc_welder_results& py_conversion::get_results() const
+{
+	return results_;
+}
+
+extern "C"
+{
+	static void ConversionHandle_dealloc(py_conversion_handle* self)
+	{
+		if (self->p_conversion != NULL)
+		{
+			// The worker holds a reference until it is done, so at most it is about to exit.
+			Py_BEGIN_ALLOW_THREADS
+			self->p_conversion->join();
+			Py_END_ALLOW_THREADS
+			delete self->p_conversion;
+			self->p_conversion = NULL;
+		}
+		Py_TYPE(self)->tp_free((PyObject*)self);
+	}
+
+	static PyObject* ConversionHandle_poll(py_conversion_handle* self, PyObject* args)
+	{
+		return PyBool_FromLong(self->p_conversion->is_finished() ? 1 : 0);
+	}
+
+	static PyObject* ConversionHandle_wait(py_conversion_handle* self, PyObject* py_args)
+	{
+		PyObject* py_timeout = Py_None;
+		if (!PyArg_ParseTuple(py_args, "|O", &py_timeout))
+		{
+			return NULL;
+		}
+		double timeout_seconds = -1;
+		if (py_timeout != Py_None)
+		{
+			timeout_seconds = PyFloat_AsDouble(py_timeout);
+			if (timeout_seconds == -1 && PyErr_Occurred())
+			{
+				return NULL;
+			}
+			if (timeout_seconds < 0)
+			{
+				timeout_seconds = 0;
+			}
+		}
+		bool is_finished;
+		Py_BEGIN_ALLOW_THREADS
+		is_finished = self->p_conversion->wait(timeout_seconds);
+		Py_END_ALLOW_THREADS
+		return PyBool_FromLong(is_finished ? 1 : 0);
+	}
+
+	static PyObject* ConversionHandle_cancel(py_conversion_handle* self, PyObject* args)
+	{
+		self->p_conversion->cancel();
+		Py_RETURN_NONE;
+	}
+
+	static PyObject* ConversionHandle_result(py_conversion_handle* self, PyObject* args)
+	{
+		Py_BEGIN_ALLOW_THREADS
+		self->p_conversion->wait(-1);
+		Py_END_ALLOW_THREADS
+		if (self->p_conversion->has_failed())
+		{
+			if (!self->p_conversion->restore_error())
+			{
+				PyErr_SetString(PyExc_RuntimeError, "PyArcWelder.ConversionHandle - The arc conversion failed.");
+			}
+			return NULL;
+		}
+		return py_arc_welder::get_py_results(self->p_conversion->get_results());
+	}
+}
+
+static PyMethodDef ConversionHandleMethods[] = {
+	{ "poll", (PyCFunction)ConversionHandle_poll, METH_NOARGS, "Returns True if the conversion has finished." },
+	{ "wait", (PyCFunction)ConversionHandle_wait, METH_VARARGS, "Waits up to timeout seconds (forever if None) for the conversion to finish.  Returns True if it finished." },
+	{ "cancel", (PyCFunction)ConversionHandle_cancel, METH_NOARGS, "Asks the conversion to stop as soon as possible." },
+	{ "result", (PyCFunction)ConversionHandle_result, METH_NOARGS, "Waits for the conversion to finish and returns its result.  Raises the conversion's error if it failed." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject ConversionHandleType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"PyArcWelder.ConversionHandle",            /* tp_name */
+	sizeof(py_conversion_handle),              /* tp_basicsize */
+	0,                                         /* tp_itemsize */
+	(destructor)ConversionHandle_dealloc,      /* tp_dealloc */
+};
+
+bool py_conversion_handle_add_type(PyObject* module)
+{
+	ConversionHandleType.tp_flags = Py_TPFLAGS_DEFAULT;
+	ConversionHandleType.tp_doc = "A conversion running on a native thread, returned by start_conversion.";
+	ConversionHandleType.tp_methods = ConversionHandleMethods;
+	if (PyType_Ready(&ConversionHandleType) < 0)
+	{
+		return false;
+	}
+	Py_INCREF(&ConversionHandleType);
+	if (PyModule_AddObject(module, "ConversionHandle", (PyObject*)&ConversionHandleType) < 0)
+	{
+		Py_DECREF(&ConversionHandleType);
+		return false;
+	}
+	return true;
+}
+
+PyObject* py_conversion_handle_start(py_conversion* p_conversion)
+{
+	py_conversion_handle* self = PyObject_New(py_conversion_handle, &ConversionHandleType);
+	if (self == NULL)
+	{
+		delete p_conversion;
+		return NULL;
+	}
+	self->p_conversion = p_conversion;
+	try
+	{
+		p_conversion->start((PyObject*)self);
+	}
+	catch (...)
+	{
+		Py_DECREF(self);
+		PyErr_SetString(PyExc_RuntimeError, "PyArcWelder.start_conversion - Unable to start the conversion thread.");
+		return NULL;
+	}
+	return (PyObject*)self;
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Python Extension for the OctoPrint Arc Welder plugin.
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "py_arc_welder.h"
+
+// A conversion running on its own native thread.  The thread holds a reference to the Python handle until it
+// finishes, so dropping the handle never stops or frees a running conversion.
+class py_conversion
+{
+public:
+	// Takes ownership of the welder and of the reference to the progress callback
+	py_conversion(py_arc_welder* p_arc_welder, PyObject* py_progress_callback);
+	~py_conversion();
+	// Starts the worker thread.  Must be called with the GIL held.
+	void start(PyObject* py_handle);
+	void cancel();
+	bool is_finished();
+	// Waits for the conversion to finish, returning true if it did.  A negative timeout waits forever.
+	// Must be called without the GIL, since the worker needs it for progress callbacks and logging.
+	bool wait(double timeout_seconds);
+	void join();
+	bool is_worker_thread() const;
+	// These are only valid once the conversion has finished
+	bool has_failed() const;
+	// Sets the Python error raised during the conversion, if there was one.  Must be called with the GIL held.
+	bool restore_error() const;
+	const arc_welder_results& get_results() const;
+private:
+	py_conversion(const py_conversion &source);
+	static void run(py_conversion* p_conversion, PyObject* py_handle);
+	py_arc_welder* p_arc_welder_;
+	PyObject* py_progress_callback_;
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable finished_;
+	bool is_finished_;
+	bool has_failed_;
+	arc_welder_results results_;
+	PyObject* error_type_;
+	PyObject* error_value_;
+	PyObject* error_traceback_;
+};
+
+// PyArcWelder.ConversionHandle, returned by PyArcWelder.start_conversion
+struct py_conversion_handle
+{
+	PyObject_HEAD
+	py_conversion* p_conversion;
+};
+
+// Adds the ConversionHandle type to the module.  Returns false, with a Python error set, on failure.
+bool py_conversion_handle_add_type(PyObject* module);
+// Creates a handle for the conversion and starts it.  Takes ownership of the conversion, even on failure.
+PyObject* py_conversion_handle_start(py_conversion* p_conversion);
@@ -145,10 +145,14 @@ void py_logger::log(const int logger_type, const int log_level, const std::strin
 		current_log_level = gcode_conversion_log_level;
 		break;
 	default:
+	{
 		std::cout << "Logging.arc_welder_log - unknown logger_type.\r\n";
+		PyGILState_STATE state = PyGILState_Ensure();
 		PyErr_SetString(PyExc_ValueError, "Logging.arc_welder_log - unknown logger_type.");
+		PyGILState_Release(state);
 		return;
 	}
+	}
 
 	if (!check_log_levels_real_time)
 	{
@@ -160,6 +164,8 @@ void py_logger::log(const int logger_type, const int log_level, const std::strin
 		}
 	}
 
+	// The GIL may have been released by the caller, so hold it from here on, where everything is a Python call.
+	PyGILState_STATE state = PyGILState_Ensure();
 	PyObject* pyFunctionName = NULL;
 
 	PyObject* error_type = NULL;
@@ -207,13 +213,17 @@ void py_logger::log(const int logger_type, const int log_level, const std::strin
 		std::cout << "Unable to convert the log message '" << message.c_str() << "' to a PyString/Unicode message.\r\n";
 		PyErr_Format(PyExc_ValueError,
 			"Unable to convert the log message '%s' to a PyString/Unicode message.", message.c_str());
+		PyGILState_Release(state);
 		return;
 	}
-	PyGILState_STATE state = PyGILState_Ensure();
+	if (!is_exception)
+	{
+		// Keep any error that is already set aside, so that the call works and the error still reaches the caller
+		PyErr_Fetch(&error_type, &error_value, &error_traceback);
+	}
 	PyObject* ret_val = PyObject_CallMethodObjArgs(py_logger, pyFunctionName, pyMessage, NULL);
 	// We need to decref our message so that the GC can remove it.  Maybe?
 	Py_DECREF(pyMessage);
-	PyGILState_Release(state);
 	if (ret_val == NULL)
 	{
 		if (!PyErr_Occurred())
@@ -243,4 +253,9 @@ void py_logger::log(const int logger_type, const int log_level, const std::strin
 		}
 	}
 	Py_XDECREF(ret_val);
+	if (!is_exception)
+	{
+		PyErr_Restore(error_type, error_value, error_traceback);
+	}
+	PyGILState_Release(state);
 }
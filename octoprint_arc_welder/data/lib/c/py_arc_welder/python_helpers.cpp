@@ -113,4 +113,14 @@ namespace gcode_arc_converter {
 			);
 
 	}
+
+	bool PyIntOrLong_Check(PyObject* py_object)
+	{
+		return (
+			PyLong_Check(py_object)
+#if PY_MAJOR_VERSION < 3
+			|| PyInt_Check(py_object)
+#endif
+			);
+	}
 }
\ No newline at end of file
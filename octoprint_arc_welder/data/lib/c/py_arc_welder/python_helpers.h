@@ -37,4 +37,5 @@ namespace gcode_arc_converter {
 	double PyFloatOrInt_AsDouble(PyObject* py_double_or_int);
 	long PyIntOrLong_AsLong(PyObject* value);
 	bool PyFloatLongOrInt_Check(PyObject* value);
+	bool PyIntOrLong_Check(PyObject* value);
 }
\ No newline at end of file
@@ -0,0 +1,379 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Converts a generated file serially, pipelined and on 2 to 8 parallel threads, in every arc E mode, and checks that
+// the output of each threaded conversion is byte for byte the same as the serial output.  The threads are used even on
+// one core.  Copies of a smaller file with CRLF line endings, and without a line ending after the final line, check
+// that unchanged lines are copied exactly and that generated lines use the source's line ending.
+//
+// Usage: conversion_modes_test [work directory]
+
+#include "arc_welder.h"
+#include "logger.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define TEST_RESOLUTION_MM 0.05
+#define TEST_BUFFER_SIZE 50
+#define TEST_SEED 20200801
+#define TEST_LAYERS 160
+// The layers in each of the line ending files
+#define TEST_LINE_ENDING_LAYERS 40
+// Small chunks (16KB), so that a parallel conversion of the 3.7MB file has from about 16 to 64 chunks depending on the
+// number of threads, and the chunks start at different layers each time.
+#define TEST_PARALLEL_MIN_CHUNK_SIZE 16384
+
+// xorshift64*, so that the file doesn't depend on the standard library's distributions
+class test_random
+{
+public:
+	test_random(unsigned long long seed)
+	{
+		state_ = seed != 0 ? seed : 1;
+	}
+	unsigned long long next()
+	{
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return state_ * 2685821657736338717ULL;
+	}
+	// A value in [min, max)
+	double next_double(double min, double max)
+	{
+		return min + (max - min) * (static_cast<double>(next() >> 11) / 9007199254740992.0);
+	}
+private:
+	unsigned long long state_;
+};
+
+// How a conversion is run.  The first mode is the serial conversion that the others are compared to.
+struct conversion_mode
+{
+	const char* name;
+	bool pipelined;
+	int parallel_threads;
+};
+
+static const conversion_mode conversion_modes[] = {
+	{ "serial", false, 0 },
+	{ "pipelined", true, 0 },
+	{ "2 threads", false, 2 },
+	{ "3 threads", false, 3 },
+	{ "4 threads", false, 4 },
+	{ "5 threads", false, 5 },
+	{ "6 threads", false, 6 },
+	{ "7 threads", false, 7 },
+	{ "8 threads", false, 8 }
+};
+
+static void append_line(std::string& text, const char* line)
+{
+	text.append(line);
+	text.push_back('\n');
+}
+
+// Noisy circles and straight infill on every layer.  The first half of the layers use absolute E, with a G92 E0 every
+// few layers, and the second half use relative E, so that the E offset changes from layer to layer.
+static std::string generate_gcode(int num_layers)
+{
+	test_random random(TEST_SEED);
+	std::string text;
+	char buffer[128];
+	append_line(text, "; generated by conversion_modes_test");
+	append_line(text, "M82");
+	append_line(text, "G90");
+	append_line(text, "G28");
+	append_line(text, "G92 E0");
+	double e = 0;
+	for (int layer = 0; layer < num_layers; layer++)
+	{
+		const bool is_relative = layer >= num_layers / 2;
+		snprintf(buffer, sizeof(buffer), ";LAYER:%d", layer);
+		append_line(text, buffer);
+		if (layer == num_layers / 2)
+		{
+			append_line(text, "M83");
+		}
+		else if (!is_relative && layer % 7 == 0)
+		{
+			append_line(text, "G92 E0");
+			e = 0;
+		}
+		snprintf(buffer, sizeof(buffer), "G1 Z%.3f F7800", 0.2 + layer * 0.2);
+		append_line(text, buffer);
+		for (int circle = 0; circle < 4; circle++)
+		{
+			double cx = random.next_double(60, 140);
+			double cy = random.next_double(60, 140);
+			double r = random.next_double(2, 20);
+			int segments = static_cast<int>(2 * PI_DOUBLE * r / 0.4) + 16;
+			snprintf(buffer, sizeof(buffer), "G0 X%.3f Y%.3f F9000", cx + r, cy);
+			append_line(text, buffer);
+			append_line(text, ";TYPE:External perimeter");
+			for (int index = 1; index <= segments; index++)
+			{
+				double angle = 2 * PI_DOUBLE * index / segments;
+				double length = 2 * PI_DOUBLE * r / segments * 0.0333;
+				e += length;
+				snprintf(buffer, sizeof(buffer), "G1 X%.3f Y%.3f E%.5f",
+					cx + r * cos(angle) + random.next_double(-0.003, 0.003),
+					cy + r * sin(angle) + random.next_double(-0.003, 0.003),
+					is_relative ? length : e);
+				append_line(text, buffer);
+			}
+		}
+		append_line(text, ";TYPE:Solid infill");
+		for (int index = 0; index < 40; index++)
+		{
+			double length = 80 * 0.0333;
+			e += length;
+			snprintf(buffer, sizeof(buffer), "G1 X%.3f Y%.3f E%.5f ; infill", index % 2 == 0 ? 140.0 : 60.0, 60 + index * 0.45, is_relative ? length : e);
+			append_line(text, buffer);
+		}
+	}
+	append_line(text, "M104 S0 ; turn off the hotend");
+	return text;
+}
+
+// Lines that are never welded or rewritten, with the odd spacing and comments of hand edited files
+static std::string generate_unchanged_gcode()
+{
+	std::string text;
+	append_line(text, "; nothing here can be welded");
+	append_line(text, "M82");
+	append_line(text, "G90");
+	append_line(text, "  G28   ; home  ");
+	append_line(text, "");
+	append_line(text, "M104 S215");
+	append_line(text, "G1 X10 Y10 E1.5");
+	append_line(text, "g1 x20   y10 e2.5 ;lower case");
+	append_line(text, "G1 X20 Y20 E3.5\t; tab");
+	append_line(text, ";TYPE:Custom");
+	append_line(text, "M117 Printing...");
+	return text;
+}
+
+static std::string to_crlf(const std::string& text)
+{
+	std::string crlf_text;
+	for (unsigned int index = 0; index < text.length(); index++)
+	{
+		if (text[index] == '\n')
+			crlf_text.push_back('\r');
+		crlf_text.push_back(text[index]);
+	}
+	return crlf_text;
+}
+
+static std::string remove_carriage_returns(const std::string& text)
+{
+	std::string lf_text;
+	for (unsigned int index = 0; index < text.length(); index++)
+	{
+		if (text[index] != '\r')
+			lf_text.push_back(text[index]);
+	}
+	return lf_text;
+}
+
+// Returns the text without the line ending after its final line
+static std::string remove_final_line_ending(const std::string& text)
+{
+	std::string::size_type length = text.length();
+	if (length > 0 && text[length - 1] == '\n')
+		length--;
+	if (length > 0 && text[length - 1] == '\r')
+		length--;
+	return text.substr(0, length);
+}
+
+static bool has_only_crlf_line_endings(const std::string& text)
+{
+	for (unsigned int index = 0; index < text.length(); index++)
+	{
+		if (text[index] == '\n' && (index == 0 || text[index - 1] != '\r'))
+			return false;
+		if (text[index] == '\r' && (index + 1 == text.length() || text[index + 1] != '\n'))
+			return false;
+	}
+	return true;
+}
+
+static bool write_file(const std::string& path, const std::string& text)
+{
+	std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(text.c_str(), text.length());
+	return file.good();
+}
+
+static bool read_file(const std::string& path, std::string& text)
+{
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+	text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+static bool convert(const std::string& source_path, const std::string& target_path, logger& log, arc_e_mode e_mode, const conversion_mode& mode, std::string& output)
+{
+	arc_welder welder(source_path, target_path, &log, TEST_RESOLUTION_MM, false, TEST_BUFFER_SIZE);
+	welder.set_arc_e_mode(e_mode);
+	welder.set_pipelined(mode.pipelined);
+	welder.set_parallel_threads(mode.parallel_threads);
+	welder.set_threaded_min_file_size(0);
+	welder.set_parallel_min_chunk_size(TEST_PARALLEL_MIN_CHUNK_SIZE);
+	arc_welder_results results = welder.process();
+	if (!results.success)
+	{
+		fprintf(stderr, "The %s %s conversion failed.\n", mode.name, arc_e_mode_name[e_mode].c_str());
+		return false;
+	}
+	if (!read_file(target_path, output))
+	{
+		fprintf(stderr, "Unable to read %s.\n", target_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Converts the text in every mode, returning the number of modes whose output differs from the serial output.  The
+// serial output is returned in serial_output.
+static int check_modes(const std::string& text, const std::string& work_directory, logger& log, arc_e_mode e_mode, std::string& serial_output)
+{
+	std::string source_path = work_directory + "/conversion_modes_test.gcode";
+	std::string target_path = work_directory + "/conversion_modes_test.aw.gcode";
+	if (!write_file(source_path, text))
+	{
+		fprintf(stderr, "Unable to write %s.\n", source_path.c_str());
+		return 1;
+	}
+	int failures = 0;
+	serial_output.clear();
+	for (unsigned int mode_index = 0; mode_index < sizeof(conversion_modes) / sizeof(conversion_modes[0]); mode_index++)
+	{
+		const conversion_mode& mode = conversion_modes[mode_index];
+		std::string output;
+		if (!convert(source_path, target_path, log, e_mode, mode, output))
+		{
+			failures++;
+			continue;
+		}
+		if (mode_index == 0)
+		{
+			serial_output.swap(output);
+		}
+		else if (output != serial_output)
+		{
+			fprintf(stderr, "The %s %s output differs from the serial output.\n", mode.name, arc_e_mode_name[e_mode].c_str());
+			failures++;
+		}
+	}
+	std::remove(source_path.c_str());
+	std::remove(target_path.c_str());
+	return failures;
+}
+
+// Returns the number of failed checks
+static int check_line_endings(const std::string& work_directory, logger& log)
+{
+	int failures = 0;
+	const std::string lf_text = generate_gcode(TEST_LINE_ENDING_LAYERS);
+	const std::string crlf_text = to_crlf(lf_text);
+	std::string lf_output;
+	std::string crlf_output;
+	std::string output;
+	failures += check_modes(lf_text, work_directory, log, arc_e_mode_offset, lf_output);
+	failures += check_modes(crlf_text, work_directory, log, arc_e_mode_offset, crlf_output);
+	if (!has_only_crlf_line_endings(crlf_output))
+	{
+		fprintf(stderr, "The output of the CRLF file has other line endings.\n");
+		failures++;
+	}
+	if (remove_carriage_returns(crlf_output) != lf_output)
+	{
+		fprintf(stderr, "The output of the CRLF file differs from the output of the LF file.\n");
+		failures++;
+	}
+	// The final line is completed with the source's line ending
+	failures += check_modes(remove_final_line_ending(lf_text), work_directory, log, arc_e_mode_offset, output);
+	if (output != lf_output)
+	{
+		fprintf(stderr, "The output of the LF file without a final line ending differs from the output with one.\n");
+		failures++;
+	}
+	failures += check_modes(remove_final_line_ending(crlf_text), work_directory, log, arc_e_mode_offset, output);
+	if (output != crlf_output)
+	{
+		fprintf(stderr, "The output of the CRLF file without a final line ending differs from the output with one.\n");
+		failures++;
+	}
+
+	// Lines that aren't welded are copied exactly
+	const std::string unchanged_text = generate_unchanged_gcode();
+	const std::string sources[] = {
+		unchanged_text, to_crlf(unchanged_text), remove_final_line_ending(unchanged_text), remove_final_line_ending(to_crlf(unchanged_text))
+	};
+	const std::string expected_outputs[] = { unchanged_text, to_crlf(unchanged_text), unchanged_text, to_crlf(unchanged_text) };
+	for (unsigned int index = 0; index < sizeof(sources) / sizeof(sources[0]); index++)
+	{
+		failures += check_modes(sources[index], work_directory, log, arc_e_mode_offset, output);
+		if (output != expected_outputs[index])
+		{
+			fprintf(stderr, "Unchanged file %d wasn't copied exactly.\n", index);
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string work_directory = argc > 1 ? argv[1] : ".";
+	std::vector<std::string> logger_names;
+	logger_names.push_back("arc_welder.gcode_conversion");
+	std::vector<int> logger_levels;
+	logger_levels.push_back(ERROR);
+	logger log(logger_names, logger_levels);
+	log.set_log_level(ERROR);
+
+	const std::string text = generate_gcode(TEST_LAYERS);
+	std::string serial_output;
+	int failures = 0;
+	for (int e_mode = 0; e_mode < NUM_ARC_E_MODES; e_mode++)
+	{
+		failures += check_modes(text, work_directory, log, static_cast<arc_e_mode>(e_mode), serial_output);
+	}
+	printf("Compared %d conversion modes of %.2fMB in %d arc E modes, %d failed.\n",
+		static_cast<int>(sizeof(conversion_modes) / sizeof(conversion_modes[0])), text.length() / 1048576.0, NUM_ARC_E_MODES, failures);
+	int line_ending_failures = check_line_endings(work_directory, log);
+	printf("Checked the line endings and unchanged lines, %d failed.\n", line_ending_failures);
+	return failures == 0 && line_ending_failures == 0 ? 0 : 1;
+}
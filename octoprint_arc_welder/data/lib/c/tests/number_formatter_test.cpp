@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Checks that number_formatter writes exactly what snprintf("%.*f") writes, at every precision, for values on and
+// next to the ties where the rounding of the scaled value could go either way, and for random gcode sized values.
+//
+// Usage: number_formatter_test [values per precision]
+
+#include "number_formatter.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define TEST_DEFAULT_VALUES 20000
+#define TEST_SEED 20200801
+// Only the first few mismatches are printed
+#define TEST_MAX_REPORTED_MISMATCHES 10
+
+// xorshift64*, so that the values don't depend on the standard library's distributions
+class test_random
+{
+public:
+	test_random(unsigned long long seed)
+	{
+		state_ = seed != 0 ? seed : 1;
+	}
+	unsigned long long next()
+	{
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return state_ * 2685821657736338717ULL;
+	}
+	// A value in [min, max)
+	double next_double(double min, double max)
+	{
+		return min + (max - min) * (static_cast<double>(next() >> 11) / 9007199254740992.0);
+	}
+private:
+	unsigned long long state_;
+};
+
+// Values that are hard to round, or that printf writes in an unusual way
+static const double edge_values[] = {
+	0.0, -0.0, 0.0005, 1.0005, 2.5, 0.5, -0.5, 1.5, 0.00005, 0.000015, 1e-320, -1e-7, 123456.0005,
+	999.9995, 9.9999999, 1e14, 1e15, -1e15, 1e300, 4503599627370495.5
+};
+
+static int checked = 0;
+static int mismatches = 0;
+
+// Formats the value with format_fixed and append_fixed, and compares both with snprintf
+static void check(double value, int precision)
+{
+	char expected[NUMBER_FORMATTER_MAX_LENGTH];
+	char buffer[NUMBER_FORMATTER_MAX_LENGTH];
+	const int expected_length = snprintf(expected, sizeof(expected), "%.*f", precision, value);
+	const int length = number_formatter::format_fixed(buffer, value, precision);
+	std::string appended = "G1 X";
+	number_formatter::append_fixed(appended, value, precision);
+	checked++;
+	if (length != expected_length || strcmp(buffer, expected) != 0 || appended.compare(4, std::string::npos, expected) != 0)
+	{
+		if (mismatches < TEST_MAX_REPORTED_MISMATCHES)
+		{
+			fprintf(stderr, "Mismatch: %.17g at precision %d is %s, but was written as %s and appended as %s\n",
+				value, precision, expected, buffer, appended.c_str() + 4);
+		}
+		mismatches++;
+	}
+}
+
+// Checks the value and the doubles either side of it
+static void check_neighbours(double value, int precision)
+{
+	check(value, precision);
+	check(nextafter(value, HUGE_VAL), precision);
+	check(nextafter(value, -HUGE_VAL), precision);
+}
+
+int main(int argc, char* argv[])
+{
+	int values_per_precision = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_VALUES;
+	test_random random(TEST_SEED);
+	for (unsigned int index = 0; index < sizeof(edge_values) / sizeof(edge_values[0]); index++)
+	{
+		for (int precision = 0; precision <= NUMBER_FORMATTER_MAX_PRECISION; precision++)
+		{
+			check_neighbours(edge_values[index], precision);
+			check_neighbours(-edge_values[index], precision);
+		}
+	}
+	for (int precision = 0; precision <= NUMBER_FORMATTER_MAX_PRECISION; precision++)
+	{
+		const double scale = pow(10.0, precision);
+		for (int index = 0; index < values_per_precision; index++)
+		{
+			// The closest doubles to a tie at this precision, with integer parts from 0 up to about 10^15
+			const double magnitude = pow(10.0, random.next_double(0, 15 - precision));
+			const double tie = (floor(random.next_double(0, magnitude * scale)) + 0.5) / scale;
+			check_neighbours(random.next() % 2 == 0 ? tie : -tie, precision);
+			// A coordinate, E or F value that isn't near a tie
+			check(random.next_double(-10000, 10000), precision);
+		}
+	}
+	printf("Checked %d values, %d differ from snprintf.\n", checked, mismatches);
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Checks that number_parser reads gcode numbers to exactly the same double that strtod reads once the spaces are
+// removed, both for numbers that take the fast path and for long numbers that are handed to strtod.
+//
+// Usage: number_parser_test [numbers]
+
+#include "number_parser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define TEST_DEFAULT_NUMBERS 200000
+#define TEST_SEED 20200802
+// Long enough for both the mantissa and the number of decimal places to overflow the fast path
+#define TEST_MAX_INTEGER_DIGITS 24
+#define TEST_MAX_FRACTION_DIGITS 30
+// Only the first few mismatches are printed
+#define TEST_MAX_REPORTED_MISMATCHES 10
+
+// xorshift64*, so that the numbers don't depend on the standard library's distributions
+class test_random
+{
+public:
+	test_random(unsigned long long seed)
+	{
+		state_ = seed != 0 ? seed : 1;
+	}
+	unsigned long long next()
+	{
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return state_ * 2685821657736338717ULL;
+	}
+	// A value in [0, max)
+	int next_int(int max)
+	{
+		return static_cast<int>(next() % static_cast<unsigned long long>(max));
+	}
+private:
+	unsigned long long state_;
+};
+
+// Numbers either side of the fast path's limits, and other unusual ways of writing a number
+static const char * edge_numbers[] = {
+	"0", "-0", "+0", "0.", ".0", "-.5", "000123.4500", "1 2. 5", " - 1.5 ", "9007199254740992", "9007199254740993",
+	"-9007199254740993", "900719925474099.3", "9999999999999999999", "18446744073709551615", "18446744073709551616",
+	"0.0000000000000000000001", "0.00000000000000000000001", "1.0000000000000000000000000001",
+	"0.30000000000000004", "2.2250738585072014", "123456789012345678901234567890.5"
+};
+
+static int checked = 0;
+static int mismatches = 0;
+
+// Parses the number, and compares it with strtod.  The whole string should be consumed.
+static void check(const std::string& number)
+{
+	std::string cleaned;
+	for (std::string::const_iterator c = number.begin(); c != number.end(); ++c)
+	{
+		if (*c != ' ')
+			cleaned.push_back(*c);
+	}
+	const double expected = strtod(cleaned.c_str(), NULL);
+	const char * p = number.c_str();
+	double value = 0;
+	const bool extracted = number_parser::try_extract_double(&p, &value);
+	checked++;
+	if (!extracted || *p != '\0' || std::memcmp(&value, &expected, sizeof(double)) != 0)
+	{
+		if (mismatches < TEST_MAX_REPORTED_MISMATCHES)
+		{
+			fprintf(stderr, "Mismatch: '%s' is %.17g, but was parsed as %.17g%s\n", number.c_str(), expected, value,
+				!extracted ? " (not extracted)" : (*p != '\0' ? " (not fully consumed)" : ""));
+		}
+		mismatches++;
+	}
+}
+
+// Appends random digits, with the occasional space
+static void append_digits(test_random& random, std::string& number, int num_digits)
+{
+	for (int index = 0; index < num_digits; index++)
+	{
+		if (random.next_int(16) == 0)
+			number.push_back(' ');
+		number.push_back(static_cast<char>('0' + random.next_int(10)));
+	}
+}
+
+static std::string random_number(test_random& random)
+{
+	std::string number;
+	if (random.next_int(8) == 0)
+		number.push_back(' ');
+	const int sign = random.next_int(4);
+	if (sign == 0)
+		number.push_back('-');
+	else if (sign == 1)
+		number.push_back('+');
+	if (random.next_int(8) == 0)
+		number.append("00");
+	// Most numbers are gcode sized, a few are long enough for strtod
+	const bool is_long = random.next_int(4) == 0;
+	const int integer_digits = random.next_int(is_long ? TEST_MAX_INTEGER_DIGITS + 1 : 6);
+	const int fraction_digits = random.next_int(is_long ? TEST_MAX_FRACTION_DIGITS + 1 : 7);
+	append_digits(random, number, integer_digits);
+	if (fraction_digits > 0 || integer_digits == 0 || random.next_int(2) == 0)
+		number.push_back('.');
+	// There must be at least one digit
+	append_digits(random, number, integer_digits == 0 && fraction_digits == 0 ? 1 : fraction_digits);
+	if (random.next_int(8) == 0)
+		number.push_back(' ');
+	return number;
+}
+
+int main(int argc, char* argv[])
+{
+	int numbers = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_NUMBERS;
+	test_random random(TEST_SEED);
+	for (unsigned int index = 0; index < sizeof(edge_numbers) / sizeof(edge_numbers[0]); index++)
+	{
+		check(edge_numbers[index]);
+	}
+	for (int index = 0; index < numbers; index++)
+	{
+		check(random_number(random));
+	}
+	printf("Checked %d numbers, %d differ from strtod.\n", checked, mismatches);
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Welds noisy, rounded points from random circles, the way a slicer writes them, and checks that firmware would
+// accept every arc.  Firmware finds the center from the start point and I/J, and then checks that the end point is
+// the same distance from it (Grbl, for example, rejects arcs where the radii differ by more than 0.005mm and 0.1%).
+//
+// Usage: segmented_arc_test [arcs]
+
+#include "segmented_arc.h"
+#include "gcode_parser.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#define TEST_DEFAULT_ARCS 2000
+#define TEST_RESOLUTION_MM 0.05
+#define TEST_MAX_SEGMENTS 45
+#define TEST_SEED 20200801
+// Slicers write points with 3 places, and we do not expect them to be exactly on a circle
+#define TEST_NOISE_MM 0.01
+// X, Y, I and J are each written within 0.0005mm, so the two radii can't differ by much more than 0.0015mm.
+#define TEST_MAX_RADIUS_DIFFERENCE_MM 0.002
+
+// xorshift64*, so that the points don't depend on the standard library's distributions
+class test_random
+{
+public:
+	test_random(unsigned long long seed)
+	{
+		state_ = seed != 0 ? seed : 1;
+	}
+	unsigned long long next()
+	{
+		state_ ^= state_ >> 12;
+		state_ ^= state_ << 25;
+		state_ ^= state_ >> 27;
+		return state_ * 2685821657736338717ULL;
+	}
+	// A value in [min, max)
+	double next_double(double min, double max)
+	{
+		return min + (max - min) * (static_cast<double>(next() >> 11) / 9007199254740992.0);
+	}
+private:
+	unsigned long long state_;
+};
+
+static double round_to_gcode(double value)
+{
+	return floor(value * 1000.0 + 0.5) / 1000.0;
+}
+
+static bool try_get_parameter(const parsed_command& command, char name, double& value)
+{
+	for (unsigned int index = 0; index < command.parameters.size(); index++)
+	{
+		if (command.parameters[index].name == name)
+		{
+			value = command.parameters[index].double_value;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Returns false if the written arc's end point is not on the circle that starts at the start point.
+static bool check_arc(segmented_arc& shape, double& worst_difference)
+{
+	arc fitted_arc;
+	shape.try_get_arc(fitted_arc);
+	point start = fitted_arc.start_point;
+	std::string gcode = shape.get_shape_gcode_absolute(0, 0, false);
+	gcode_parser parser;
+	parsed_command command;
+	double x, y, i, j;
+	if (
+		!parser.try_parse_gcode(gcode.c_str(), command) ||
+		!try_get_parameter(command, 'X', x) || !try_get_parameter(command, 'Y', y) ||
+		!try_get_parameter(command, 'I', i) || !try_get_parameter(command, 'J', j)
+	)
+	{
+		fprintf(stderr, "Unable to read the arc '%s'\n", gcode.c_str());
+		return false;
+	}
+	double center_x = start.x + i;
+	double center_y = start.y + j;
+	double start_radius = sqrt(i * i + j * j);
+	double end_radius = sqrt((x - center_x) * (x - center_x) + (y - center_y) * (y - center_y));
+	double difference = fabs(end_radius - start_radius);
+	if (difference > worst_difference)
+		worst_difference = difference;
+	if (difference > TEST_MAX_RADIUS_DIFFERENCE_MM)
+	{
+		fprintf(stderr, "The radius at the end of '%s' differs from the radius at the start (%.4f) by %.4fmm\n", gcode.c_str(), start_radius, difference);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	int num_arcs = argc > 1 ? atoi(argv[1]) : TEST_DEFAULT_ARCS;
+	test_random random(TEST_SEED);
+	segmented_arc arc(TEST_MAX_SEGMENTS, TEST_RESOLUTION_MM);
+	int arcs_checked = 0;
+	int failures = 0;
+	double worst_difference = 0;
+	for (int index = 0; index < num_arcs; index++)
+	{
+		double center_x = random.next_double(50, 150);
+		double center_y = random.next_double(50, 150);
+		double radius = random.next_double(2, 100);
+		double start_angle = random.next_double(0, 2 * PI_DOUBLE);
+		double sweep = random.next_double(0.3, 5.5) * (random.next() % 2 == 0 ? 1.0 : -1.0);
+		double segment_length = random.next_double(0.3, 3);
+		int segments = static_cast<int>(fabs(sweep) * radius / segment_length) + 2;
+		arc.clear();
+		point previous;
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			double angle = start_angle + sweep * segment / segments;
+			point p(
+				round_to_gcode(center_x + radius * cos(angle) + random.next_double(-TEST_NOISE_MM, TEST_NOISE_MM)),
+				round_to_gcode(center_y + radius * sin(angle) + random.next_double(-TEST_NOISE_MM, TEST_NOISE_MM)),
+				0.2,
+				segment == 0 ? 0 : 0.05
+			);
+			if (!arc.try_add_point(p, p.e_relative))
+			{
+				// The welder writes the arc that could be made, and starts the next one from where it ended
+				if (arc.is_shape())
+				{
+					arcs_checked++;
+					if (!check_arc(arc, worst_difference))
+						failures++;
+				}
+				arc.clear();
+				arc.try_add_point(previous, 0);
+				arc.try_add_point(p, p.e_relative);
+			}
+			previous = p;
+		}
+		if (arc.is_shape())
+		{
+			arcs_checked++;
+			if (!check_arc(arc, worst_difference))
+				failures++;
+		}
+	}
+	printf("Checked %d arcs, the largest radius difference was %.4fmm, %d failed.\n", arcs_checked, worst_difference, failures);
+	if (arcs_checked == 0)
+	{
+		fprintf(stderr, "No arcs were created.\n");
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
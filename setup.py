@@ -35,6 +35,7 @@ from distutils.version import LooseVersion
 from distutils.sysconfig import customize_compiler
 from octoprint_arc_welder_setuptools import NumberedVersion
 import sys
+import os
 import versioneer
 
 ########################################################################################################################
@@ -120,8 +121,8 @@ compiler_opts = {
         "define_macros": [],
     },
     UnixCCompiler.compiler_type: {
-        "extra_compile_args": ["-O3", "-std=c++11", "-Wno-unknown-pragmas", '-v'],
-        "extra_link_args": [],
+        "extra_compile_args": ["-O3", "-std=c++11", "-Wno-unknown-pragmas", '-v', "-pthread"],
+        "extra_link_args": ["-pthread"],
         "define_macros": [],
     },
     BCPPCompiler.compiler_type: {
@@ -149,8 +150,8 @@ if DEBUG:
             "define_macros": [],
         },
         UnixCCompiler.compiler_type: {
-            "extra_compile_args": ["-g"],
-            "extra_link_args": ["-g"],
+            "extra_compile_args": ["-g", "-pthread"],
+            "extra_link_args": ["-g", "-pthread"],
             "define_macros": [],
         },
         BCPPCompiler.compiler_type: {
@@ -211,14 +212,28 @@ plugin_ext_sources = [
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/position.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/utilities.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/logger.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/line_reader.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/line_writer.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/number_parser.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/number_formatter.cpp",
+    "octoprint_arc_welder/data/lib/c/gcode_processor_lib/probes.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/arc_welder.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/batch_welder.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/circle_tolerance.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/segmented_arc.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/segmented_shape.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/stage_timer.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_logger.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_arc_welder.cpp",
+    "octoprint_arc_welder/data/lib/c/py_arc_welder/py_batch_welder.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_arc_welder_extension.cpp",
+    "octoprint_arc_welder/data/lib/c/py_arc_welder/py_conversion_handle.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/python_helpers.cpp",
 ]
+plugin_ext_macros = [("GCODE_POSITION_LEAN", None)]
+# Set ARC_WELDER_PROBES=1 to build with the hot path probes, which write a JSON report next to each converted file
+if os.environ.get("ARC_WELDER_PROBES"):
+    plugin_ext_macros.append(("GCODE_PROBES", None))
 cpp_gcode_parser = Extension(
     "PyArcWelder",
     sources=plugin_ext_sources,
@@ -228,6 +243,7 @@ cpp_gcode_parser = Extension(
         "octoprint_arc_welder/data/lib/c/gcode_processor_lib",
         "octoprint_arc_welder/data/lib/c/py_arc_welder",
     ],
+    define_macros=plugin_ext_macros,
 )
 
 